@@ -8,18 +8,68 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "include/Shader.h"
 #include "include/Model.h"
+#include "include/Scene.h"
 #include "include/Camera.h"
 #include "include/State.h"
+#include "include/ModalAnalysis.h"
+#include "include/SensorBuffer.h"
+#include "include/FrameArena.h"
+#include "include/AudioSystem.h"
+#include "include/TaskGraph.h"
+#include "include/LatencyMonitor.h"
+#include "include/InputLog.h"
+#include "include/FrameProfile.h"
+#include "include/DynamicResolution.h"
+#include "include/FrameCapture.h"
+#include "include/SensorHistory.h"
+#include "include/SensorPyramid.h"
+#include "include/LineChart.h"
+#include "include/SensorLayout.h"
+#include "include/LayoutWatcher.h"
+#include "include/TextRenderer.h"
+#include "include/SensorReceiver.h"
+#include "include/View.h"
+#include "include/GLState.h"
+#include "include/RenderQueue.h"
+
+#define ALLOC_TRACKER_IMPLEMENTATION
+#include "include/AllocTracker.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+
+const float SENSOR_RATE = 50.0f;		// Sensor sample rate (Hz)
+const int SENSOR_MAX_CATCHUP = 10;		// Simulated sensor frames per render frame at most (a stall skips the rest)
+const char* LAYOUT_PATH = "repos/sensor_layout.txt";	// Sensor layout of the bridge (watched for changes)
+const float MODE_ANIM_RATE = 0.5f;		// Mode shape animation rate (Hz). Slower than the real mode so it can be seen
+const float MODE_SCALE = 0.5f;			// Mode shape displacement at unit amplitude
+const int BENCH_WARMUP_FRAMES = 120;	// Frames before steady state (caches and scratch buffers fill up)
+const int BENCH_DEFAULT_FRAMES = 600;	// Steady-state frames in a benchmark run
+const int LOW_LATENCY_QUEUE = 1;		// Frames the GPU may be behind in low latency mode
+const float MODEL_PASS_TARGET_MS = 8.0f;	// GPU time for the model pass. Its resolution scales to fit (leaves room for the GUI at 60 Hz)
+const float MODEL_PASS_MIN_SCALE = 0.5f;	// Lowest model pass resolution (per axis)
+const float LAYOUT_WIDTH = 3840.0f;		// Width the button layout is designed at (pixels)
+const int PICK_NEAREST = 3;				// Sensors listed when the model is clicked
+const float HISTORY_SECONDS = 10.0f;	// Sensor history kept for clicked points (s)
+const float CHART_SECONDS = 10.0f;		// Sensor history shown by the live chart (s)
+const char* const TEXT_FONT = "repos/SourceCodePro-Regular.ttf";	// Font for sensor labels (monospace, so numbers don't jitter)
+const int TEXT_SIZE = 16;				// Font size (pixels)
+const int NUM_STATES = 20;				// Number of states
+const size_t PAGE_BUDGET = 96 * 1024 * 1024;	// Texture memory for GUI pages (bytes). Least recently shown pages are evicted past this
+
 
 // Process State Input
-int processStateInput(SDL_Event event, State temp_state) {
+// layout_scale = window pixels to layout pixels (buttons are placed at the startup window size)
+int processStateInput(SDL_Event& event, State& temp_state, glm::vec2 layout_scale) {
 
 	// If person hits key on keyboard
 	if (event.type == SDL_KEYDOWN) {
@@ -29,19 +79,34 @@ int processStateInput(SDL_Event event, State temp_state) {
 			return -1;
 		}
 
-	// Mouse movement
+	// Mouse movement (in layout pixels, so buttons line up at any window size)
 	} else {
-		return temp_state.handle_events(event);
+		SDL_Event layout_event = event;
+		if (event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP) {
+			layout_event.button.x = (Sint32)(event.button.x * layout_scale.x);
+			layout_event.button.y = (Sint32)(event.button.y * layout_scale.y);
+		}
+		return temp_state.handle_events(layout_event);
 	}
 
 	return -2;
 }
 
 
-// Process Input to Change Camera. (Updates and then returns Camera)
-Camera processCamInput(float deltaTime, Camera camera) {
+// Queue the pages of every state reachable from a state's buttons for background loading
+void prefetchLinkedStates(vector<State>& states, int state_num, PageCache& pages) {
+	const vector<Button>& buttons = states[state_num].getButtons();
+	for (unsigned int i = 0; i < buttons.size(); i++) {
+		if (buttons[i].state_num >= 0 && buttons[i].state_num < (int)states.size()) {
+			states[buttons[i].state_num].prefetch(pages);
+		}
+	}
+}
+
 
-	const Uint8* keystates = SDL_GetKeyboardState(NULL);  // Get keys that are currently pressed down
+// Process Input to Change Camera. (Updates and then returns Camera)
+// keystates = keys that are currently pressed down (SDL_GetKeyboardState layout)
+Camera processCamInput(float deltaTime, Camera camera, const Uint8* keystates) {
 
 	/// Move Position
 	// If key is W, then move forward
@@ -94,122 +159,313 @@ Camera processCamInput(float deltaTime, Camera camera) {
 
 
 
-// Main
-int main(int argc, char* args[]) {
+// Create artificial sensor data for one sample time for every instance of the bridge (two vertical bending modes plus noise)
+void sensorSample(float t, vector<glm::vec3>& sensor_pos, const vector<ModelInstance>& instances, vector<float>& frame) {
+	const float PI = 3.14159265f;
+	for (unsigned int n = 0; n < instances.size(); n++) {
+		for (int i = 0; i < (int)sensor_pos.size(); i++) {
+			float s = (sensor_pos.at(i).x + 12.0f) / 24.0f;		// Position along the span (0 to 1)
+			float mode1 = sin(PI * s);							// First bending shape
+			float mode2 = sin(2.0f * PI * s);					// Second bending shape
+			float noise = rand() / (float)RAND_MAX - 0.5f;		// Ambient excitation
+			frame.at(instances[n].sensorOffset + i) = 0.6f * sin(2.0f * PI * 1.9f * t) * mode1 + 0.3f * sin(2.0f * PI * 4.7f * t) * mode2 + 0.2f * noise;
+		}
+	}
+}
 
-	// Use OpenGL 3.3
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
-	
-	/// Initialize Everything
-	// Check if SDL_Init is okay. Should be equal to 0.
-	if (SDL_Init(SDL_INIT_VIDEO) > 0) {
-		printf("HEY.. SDL_Init HAS FAILED. SDL_ERROR: %s\n", SDL_GetError());
-		//exit(1);
+
+// Feed one sensor frame to the modal analysis, the history kept for picking and the charts
+void consumeSensorFrame(const vector<float>& frame, ModalAnalysis& modal, SensorHistory& history, SensorPyramid& pyramid, LineChart& chart) {
+	modal.pushSamples(frame);
+	history.push(frame);
+	pyramid.push(frame);
+	chart.push(frame);
+}
+
+
+
+// Print what's at a clicked point on the model: the interpolated sensor value and the nearest sensors with their history
+void printPick(Scene& scene, const PickHit& hit, vector<float>& data, SensorHistory& history, SensorPyramid& pyramid, double pick_us) {
+	Model* model = scene.getModel(hit.model);
+	printf("Picked model %d instance %d mesh %d triangle %d at (%.2f, %.2f, %.2f), %.2f from the camera (%.1f us)\n", hit.model, hit.instance,
+		hit.mesh, hit.triangle, hit.position.x, hit.position.y, hit.position.z, hit.distance, pick_us);
+
+	// Value the heatmap shows there
+	glm::ivec2 interp_index;
+	glm::vec2 interp_weight;
+	model->sensorInterp(hit.objectPosition, interp_index, interp_weight);
+	float value = 0.0f;
+	if (interp_index.x >= 0) {
+		value += data[hit.sensorOffset + interp_index.x] * interp_weight.x;
+	}
+	if (interp_index.y >= 0) {
+		value += data[hit.sensorOffset + interp_index.y] * interp_weight.y;
 	}
+	printf("  Interpolated value %.3f (sensors %d and %d)\n", value, interp_index.x, interp_index.y);
+
+	// Nearest sensors
+	int nearest[PICK_NEAREST];
+	int count = model->nearestSensors(hit.objectPosition, nearest, PICK_NEAREST);
+	for (int i = 0; i < count; i++) {
+		int sensor = hit.sensorOffset + nearest[i];
+		float min, max, mean;
+		history.stats(sensor, min, max, mean);
+		printf("  Sensor %d: %.2f away, now %.3f, last %.1f s min %.3f max %.3f mean %.3f\n", nearest[i],
+			glm::length(model->sensorPosition(nearest[i]) - hit.objectPosition), data[sensor], history.size() / SENSOR_RATE, min, max, mean);
+
+		// Whole history, as one chart pixel
+		ChartBucket all;
+		pyramid.query(sensor, 0.0, pyramid.duration(), 1, &all);
+		printf("    all %.2f h: min %.3f max %.3f mean %.3f\n", pyramid.duration() / 3600.0, all.min, all.max, all.mean);
+	}
+}
+
+
 
-	// Initialize SDL Mixer
-	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-		printf("SDL Mixer could not initialize! SDL Error: %s\n", SDL_GetError());
-		//exit(1);
+// Lay out a label with the current value at each sensor's spot on screen, for every instance of the bridge
+// view_projection = last model pass's camera. width, height = drawable size (pixels)
+void addSensorLabels(TextRenderer& text, const SensorLayout& layout, const vector<ModelInstance>& instances, vector<float>& data, const glm::mat4& view_projection, int width, int height) {
+	for (unsigned int n = 0; n < instances.size(); n++) {
+		glm::mat4 transform = view_projection * instances[n].transform;
+		for (int i = 0; i < layout.channels(); i++) {
+			if (!layout.hasSensor(i)) {
+				continue;  // Channel not placed on the bridge
+			}
+			glm::vec4 clip = transform * glm::vec4(layout.position(i), 1.0f);
+			if (clip.w <= 0.0f) {
+				continue;  // Behind the camera
+			}
+			int sensor = instances[n].sensorOffset + i;
+			float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+			float y = (0.5f - clip.y / clip.w * 0.5f) * height;
+			glm::vec4 color = data[sensor] >= 0.0f ? glm::vec4(1.0f, 0.85f, 0.6f, 1.0f) : glm::vec4(0.6f, 0.85f, 1.0f, 1.0f);
+			text.addf(x + 4.0f, y - text.lineSpacing() * 0.5f, color, "%d: %+.3f", sensor, data[sensor]);
+		}
 	}
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-		printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
-		//exit(1);
+}
+
+
+
+// Main
+int main(int argc, char* args[]) {
+
+	// Benchmark mode (-benchmark [frames]). Runs a fixed number of steady-state frames, then fails if any of them allocated
+	// Low latency mode (-lowlatency). Bounds the frame queue, reads camera input as late as possible, and tears late frames
+	// Input logs (-record file, -replay file) and frame time profiles (-profile file.csv) for comparing builds on the same input
+	// Extra views (-window display state, repeatable). Each covers a monitor and has its own camera and state
+	int benchmarkFrames = 0;
+	bool lowLatency = false;
+	const char* recordPath = NULL;
+	const char* replayPath = NULL;
+	const char* profilePath = NULL;
+	const char* historyPath = NULL;	// Long-term sensor history, loaded at startup and saved on exit
+	int udpPort = 0;				// Receive sensor packets on this port instead of simulating them (0 = simulate)
+	vector<View> views(1);			// Windows (the first is the main one)
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(args[i], "-benchmark") == 0) {
+			benchmarkFrames = (i + 1 < argc) ? atoi(args[i + 1]) : 0;
+			if (benchmarkFrames <= 0) {
+				benchmarkFrames = BENCH_DEFAULT_FRAMES;
+			}
+		} else if (strcmp(args[i], "-lowlatency") == 0) {
+			lowLatency = true;
+		} else if (strcmp(args[i], "-record") == 0 && i + 1 < argc) {
+			recordPath = args[++i];
+		} else if (strcmp(args[i], "-replay") == 0 && i + 1 < argc) {
+			replayPath = args[++i];
+		} else if (strcmp(args[i], "-profile") == 0 && i + 1 < argc) {
+			profilePath = args[++i];
+		} else if (strcmp(args[i], "-history") == 0 && i + 1 < argc) {
+			historyPath = args[++i];
+		} else if (strcmp(args[i], "-udp") == 0 && i + 1 < argc) {
+			udpPort = atoi(args[++i]);
+		} else if (strcmp(args[i], "-window") == 0 && i + 2 < argc) {
+			int display = atoi(args[i + 1]);
+			int state = atoi(args[i + 2]);
+			i += 2;
+			views.push_back(View(state >= 0 && state < NUM_STATES ? state : 0, display));
+		}
 	}
 
+	// tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
+	stbi_set_flip_vertically_on_load(true);
+
 
 	/// Create Window
 	int windowWidth = 960;
 	int windowHeight = 540;
-	float scale_factor = 3840 / windowWidth;
+	float scale_factor = LAYOUT_WIDTH / windowWidth;	// Design pixels per window pixel at the startup size (buttons are given in design pixels)
+	int layoutWidth = windowWidth;		// Window size buttons are placed for
+	int layoutHeight = windowHeight;
+	SDL_GLContext gContext = NULL;	// OpenGL context (one for every view, created by the startup tasks)
 
-	// Creates a window with title, position (currently undefined), a size (width and height), and will be shown
-	SDL_Window* gwindow = SDL_CreateWindow("sMaRT bRidGe", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, windowWidth, windowHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
 
-	// If window fails to create, then produce error message
-	if (gwindow == NULL) {
-		printf("Window failed to init. Error: %s\n", SDL_GetError());
-		//exit(2);
+	// Sensor layout (channel count is fixed from here on, positions can be edited while running)
+	SensorLayout layout;
+	if (!layout.load(LAYOUT_PATH)) {
+		printf("Sensor layout: using the built-in layout\n");
+		layout.loadDefault();
 	}
+	vector<glm::vec3> sensor_pos_p = layout.positions();	// Sensor position per channel (for the simulated data)
 
-	// Create OpenGL context for window
-	SDL_GLContext gContext = SDL_GL_CreateContext(gwindow);
-	if (gContext == NULL) {
-		printf("OpenGL context could not be created! Error: %s\n", SDL_GetError());
-		//exit(3);
-	}
 
-	// Check if Glew can be initialized
-	glewExperimental = GL_TRUE;  // Want the latest features of GLEW
-	GLenum err = glewInit();
-	if (GLEW_OK != err) {
-		// GLEW failed!
-		printf("Glew_init has failed. Error: %s\n", glewGetErrorString(err));
-		//exit(4);
-	}
+	/// Startup
+	// Startup work runs as a task graph: CPU tasks on a worker pool, GL tasks on this thread (which owns the
+	// context) as soon as their inputs are ready. The model is parsed and processed while the window opens.
+	TaskGraph startup;
 
-	// Use Vsync
-	if (SDL_GL_SetSwapInterval(1) < 0) {
-		printf("Warning: Unable to set Vsync! Error: %s\n", SDL_GetError());
-		//exit(5);
-	}
+	// Audio (sounds are loaded on the audio thread, so nothing here waits on them)
+	AudioSystem audio;
+	int sfxTentacle = audio.addEffect("repos/tentacle_flop.mp3");		// Sound Effects
+	audio.setMusic("repos/nights_like_this.mp3", MIX_MAX_VOLUME / 15);	// Mix music
 
-	// Set openGL viewport
-	glViewport(0, 0, windowWidth, windowHeight);
+	// Scene
+	// More spans share the bridge geometry, e.g. scene.addInstance(bridge, glm::translate(glm::mat4(1.0f), glm::vec3(24.0f, 0.0f, 0.0f)));
+	Scene scene;
+	Model* bridgeModel = new Model(layout);		// Loaded by the tasks, then owned by the scene
 
-	glEnable(GL_DEPTH_TEST);  // Enable depth testing with z buffers
+	// Shader programs (compiled by the tasks)
+	Shader modelShader;
+	Shader guiShader;
 
+	// Text (glyph atlas rasterized by the tasks)
+	TextRenderer text;
 
-	// tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-	stbi_set_flip_vertically_on_load(true);
+	// Window and OpenGL context (every GL task waits for it)
+	int windowTask = startup.add("window + GL context", TASK_GL, [&]() {
+		// Use OpenGL 3.3
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	
+		/// Initialize Everything
+		// Check if SDL_Init is okay. Should be equal to 0.
+		if (SDL_Init(SDL_INIT_VIDEO) > 0) {
+			printf("HEY.. SDL_Init HAS FAILED. SDL_ERROR: %s\n", SDL_GetError());
+			//exit(1);
+		}
+
+		// Create Windows
+		// The main window has a title, position (currently undefined), a size (width and height), and will be shown.
+		// Extra views cover their monitors. Open failures are printed by open()
+		for (int i = 0; i < (int)views.size(); i++) {
+			views[i].open("sMaRT bRidGe", windowWidth, windowHeight);
+		}
+
+		// Create OpenGL context for the main window (every view is drawn with it)
+		gContext = SDL_GL_CreateContext(views[0].window);
+		if (gContext == NULL) {
+			printf("OpenGL context could not be created! Error: %s\n", SDL_GetError());
+			//exit(3);
+		}
+
+		// Check if Glew can be initialized
+		glewExperimental = GL_TRUE;  // Want the latest features of GLEW
+		GLenum err = glewInit();
+		if (GLEW_OK != err) {
+			// GLEW failed!
+			printf("Glew_init has failed. Error: %s\n", glewGetErrorString(err));
+			//exit(4);
+		}
+
+		// Use Vsync
+		if (SDL_GL_SetSwapInterval(1) < 0) {
+			printf("Warning: Unable to set Vsync! Error: %s\n", SDL_GetError());
+			//exit(5);
+		}
+
+		// Set openGL viewport (the drawable can be larger than the window on high DPI displays)
+		glViewport(0, 0, views[0].drawableWidth, views[0].drawableHeight);
+
+		GLState::enable(GL_DEPTH_TEST);  // Enable depth testing with z buffers
+	});
+
+	// Audio (the mixer is opened on this thread after SDL_Init. Effects are decoded on the audio thread)
+	startup.add("start audio", TASK_GL, [&]() {
+		audio.start();
+	}, { windowTask });
+
+	// Bridge model. Parsing, sensor interpolation, optimization and LODs on the workers, buffers on the GL thread
+	int bridgeLoad = startup.add("load bridge model", TASK_CPU, [&]() {
+		bridgeModel->load("repos/bridge5.obj", &startup);
+	});
+	startup.add("upload bridge model", TASK_GL, [&]() {
+		bridgeModel->upload();
+		int bridge = scene.addModel("repos/bridge5.obj", bridgeModel);
+		scene.addInstance(bridge, glm::mat4(1.0f));
+	}, { windowTask, bridgeLoad });
+
+	// Glyph atlas for sensor labels. Rasterized on a worker (after SDL_Init), uploaded on the GL thread
+	int fontLoad = startup.add("rasterize font", TASK_CPU, [&]() {
+		if (!text.load(TEXT_FONT, TEXT_SIZE)) {
+			printf("Sensor labels are off\n");
+		}
+	}, { windowTask });
+	startup.add("upload font atlas", TASK_GL, [&]() {
+		if (text.isLoaded()) {
+			text.upload();
+		}
+	}, { windowTask, fontLoad });
+
+	// Shaders
+	startup.add("compile shaders", TASK_GL, [&]() {
+		modelShader = Shader("repos/shaders/model_vshader.vs", "repos/shaders/model_fshader.fs");  // Create shader program
+		guiShader = Shader("repos/shaders/gui_vshader.vs", "repos/shaders/gui_fshader.fs");  // Create shader program
+
+		// Sensor buffer texture units for the model shader
+		modelShader.use();
+		modelShader.setInt("sensorValues", 1);
+		modelShader.setInt("modeShapes", 2);
+
+		// GUI texture units (the chart ring must not share unit 0 with the page textures, or every GUI draw fails)
+		guiShader.use();
+		guiShader.setInt("texture0", 0);
+		guiShader.setInt("chartValues", 1);
+	}, { windowTask });
+
+	// Run, then report when each task ran
+	startup.run();
+	startup.printTimeline();
+
+	// Pick up sensor layout edits (re-interpolated on the watcher's thread)
+	LayoutWatcher layoutWatcher;
+	layoutWatcher.start(LAYOUT_PATH, bridgeModel);
+
+	// Low latency mode swaps late frames right away (adaptive vsync tears instead of waiting a whole refresh)
+	int swapInterval = 1;		// Swap interval of the main window
+	if (lowLatency && SDL_GL_SetSwapInterval(-1) < 0) {
+		printf("Warning: Adaptive vsync (swap control tear) not supported, keeping vsync. Error: %s\n", SDL_GetError());
+	} else if (lowLatency) {
+		swapInterval = -1;
+	}
+
+
+	// Start operational modal analysis (runs on its own thread). It analyses the first bridge span's channels
+	// (the first layout.channels() values of each frame); the spans are copies of one structure, so the modes
+	// it finds are shown on every span
+	ModalAnalysis modal(layout.channels(), SENSOR_RATE);
+	vector<ModeShape> modes;				// Latest identified mode shapes
+	unsigned int modesVersion = 0;			// Version of modes
+	int modeIndex = 0;						// Mode being animated
+	int shownMode = -1;						// Mode currently in modeShapes (-1 = none)
+	unsigned int shownVersion = 0;			// Version of modes currently in modeShapes
 
+	// Sensor buffer textures (read by the model shader with texelFetch)
+	// Every instance reads its own range (starting at its sensor offset)
+	SensorBuffer sensorValues(scene.numSensors());			// Latest value per sensor
+	SensorBuffer modeShapes(scene.numSensors(), 2);			// Amplitude and phase per sensor of the animated mode
 
-	// Sensor positions
-	vector<glm::vec3> sensor_pos_p;
-
-	// West sensors
-	sensor_pos_p.push_back(glm::vec3(7.3316, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(5.215, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(3.1434, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(1.0121, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-1.0337, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-3.1213, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-5.2075, -2.2241, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-9.3968, -2.2241, -0.2));
-
-	// Roof sensors
-	sensor_pos_p.push_back(glm::vec3(7.3032, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(5.1952, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(3.1156, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(1.0298, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(-1.0592, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(-3.15, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(-5.2528, 0.16036, 3.70));
-	sensor_pos_p.push_back(glm::vec3(-7.3376, 0.16036, 3.70));
-
-	// East sensors
-	sensor_pos_p.push_back(glm::vec3(9.5568, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(7.2941, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(5.1225, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(2.9113, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(0.98272, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-1.0439, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-3.1877, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-5.3186, 2.3272, -0.2));
-	sensor_pos_p.push_back(glm::vec3(-7.4455, 2.3272, -0.2));
-
-
-	// Load model
-	Model ourModel("repos/bridge5.obj", sensor_pos_p);
+	// Page textures (loaded when a state is first shown, or prefetched from the states linked to the current one)
+	PageCache pages(PAGE_BUDGET);
+
+	// Live chart of every sensor (a lane each) for the structural dynamics page
+	LineChart liveChart(scene.numSensors(), (int)(CHART_SECONDS * SENSOR_RATE), glm::vec2(0.0f, 0.35f), glm::vec2(0.9f, 0.5f), -1.0f, 1.0f);
 
 	// States
 	vector<State> states;		// States vector
-	int num_states = 20;			// Number of states
-
-	for (int i = 0; i < num_states; i++) {
+	for (int i = 0; i < NUM_STATES; i++) {
 		states.push_back(State(i, "repos"));
 	}
 
@@ -253,6 +509,7 @@ int main(int argc, char* args[]) {
 
 	// Structural Dynamics
 	states[2].loadMaterialTextures("repos/dyn_1.png", glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f));
+	states[2].addChart(&liveChart);
 	states[2].addButton(0, glm::vec4(65.0f, 1965.0f, 420.0f, 150.0f) / scale_factor);
 	states[2].addButton(2, glm::vec4(590.0f, 1920.0f, 535.0f, 190.0f) / scale_factor);
 	states[2].addButton(15, glm::vec4(1235.0f, 1920.0f, 535.0f, 190.0f) / scale_factor);
@@ -296,36 +553,9 @@ int main(int argc, char* args[]) {
 	states[12].addButton(0, glm::vec4(65.0f, 1965.0f, 420.0f, 150.0f) / scale_factor);
 
 
-	// Mix music
-	Mix_Music* gMusic = Mix_LoadMUS("repos/nights_like_this.mp3");
-	if (!gMusic) {
-		printf("Mix_LoadMUS music Error: %s\n", Mix_GetError());
-		//exit(1);
-	}
+	// Cameras, view and projection matrices are per view
+	// Model matrices (From object coords to world coords) are per instance in the scene
 	
-	Mix_PlayMusic(gMusic, -1);
-	Mix_VolumeMusic(MIX_MAX_VOLUME / 15);
-
-	// Sound Effects
-	Mix_Chunk* gTentacle = Mix_LoadWAV("repos/tentacle_flop.mp3");
-	if (!gTentacle) {
-		printf("Mix_LoadMUS drum Error: %s\n", Mix_GetError());
-		//exit(1);
-	}
-
-
-	// Camera
-	Camera camera(glm::vec3(0.0f, 0.0f, 50.0f));  // Create camera
-
-	// Model Matrix (From object coords to world coords)
-	glm::mat4 model = glm::mat4(1.0f);  // Model Matrix (From object coords to world coords)
-	glm::mat4 view;						// View matrix
-	glm::mat4 projection;				// Projection matrix
-	
-
-	// Make Shader Program
-	Shader modelShader("repos/shaders/model_vshader.vs", "repos/shaders/model_fshader.fs");  // Create shader program
-	Shader guiShader("repos/shaders/gui_vshader.vs", "repos/shaders/gui_fshader.fs");  // Create shader program
 
 	// Wireframe mode
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -339,105 +569,362 @@ int main(int argc, char* args[]) {
 
 
 	/// Main Game Loop
-	int currState = 0;  // Current game state. -1 = quit.
+	bool quit = false;	// Escape pressed in any view
+	int focusView = 0;	// View the keyboard moves the camera of (the last one an event was for)
 	SDL_Event event;	// Person-computer interaction
 
-	State temp_state = states[0];  // Set temp state to first state
+	// Every view's first state, its pages and its model pass target
+	for (int i = 0; i < (int)views.size(); i++) {
+		states[views[i].currState].prefetch(pages);
+		prefetchLinkedStates(states, views[i].currState, pages);
+		views[i].createTarget(MODEL_PASS_TARGET_MS, MODEL_PASS_MIN_SCALE);
+	}
+
+	FrameArena frameArena;		// Scratch memory for one frame
+	RenderQueue renderQueue;	// Draws of the view being drawn (recorded, sorted once, then submitted)
+	LatencyMonitor latency(lowLatency ? LOW_LATENCY_QUEUE : 0);		// Input to display timing
+	FrameCapture frameCapture;	// Screenshots and recordings (F12 = screenshot, F9 = PNG sequence, F10 = raw video)
+	int frameCount = 0;			// Frames rendered
+	long lastFrameAllocs = 0;	// Heap allocations in the last frame
+	long steadyAllocs = 0;		// Heap allocations after warm-up
+	int allocFrames = 0;		// Frames after warm-up that allocated
+	long lastGLIssued = 0;		// GL state calls issued in the last frame
+	long lastGLSkipped = 0;		// GL state calls skipped in the last frame (state already set)
+	long steadyGLIssued = 0;	// GL state calls issued after warm-up
+	long steadyGLSkipped = 0;	// GL state calls skipped after warm-up
 
 	float deltaTime = 0.0f;  // Time between current frame and last frame
 	float prevTime = 0.0f;   // Previous time
-	float updateTime = -30.0f;  // Time since last update
+	float sampleTime = 0.0f;	// Time of the next sensor sample
+	float statsTime = 0.0f;		// Time the culling counters were last shown
+
+	vector<float> data(scene.numSensors(), 0.0f);  // Latest sensor values (each instance's sensors from its sensor offset)
+	const vector<ModelInstance>& bridgeInstances = scene.instancesOf(bridgeModel);	// Bridge spans (simulated data and labels)
+	bool showLabels = text.isLoaded();	// Draw live sensor values next to the sensors (L toggles. Off if the font didn't load)
+	SensorHistory history(scene.numSensors(), (int)(HISTORY_SECONDS * SENSOR_RATE));	// Recent sensor frames for clicked points
+	SensorPyramid pyramid(scene.numSensors(), SENSOR_RATE);	// Sensor history, summarized for history charts (fixed size)
+
+	// Long-term history file, appended to as frames arrive. Beside the recording unless a file was given
+	if (historyPath != NULL) {
+		pyramid.open(historyPath, true);
+	} else if (recordPath != NULL) {
+		pyramid.open((std::string(recordPath) + ".pyramid").c_str(), false);
+	}
+
+	// Sensor packets from the acquisition nodes (frames aligned in a jitter buffer on the receive thread)
+	SensorReceiver receiver(scene.numSensors(), SENSOR_RATE);
+	if (udpPort > 0 && replayPath == NULL) {
+		receiver.start(udpPort);
+	}
+
+	// Input log. Replay runs on the recorded clock, events, keys and sensor frames
+	InputLog inputLog;
+	if (replayPath != NULL) {
+		inputLog.replay(replayPath, scene.numSensors());
+	} else if (recordPath != NULL) {
+		inputLog.record(recordPath, scene.numSensors());
+	}
+	FrameProfile profile;		// Frame times
+	if (profilePath != NULL) {
+		profile.open(profilePath);
+	}
 
 	float fov = 45.0f;
 
 	while (1) {
 
 		// Calculate current time and delta time
+		profile.beginFrame();
 		float currTime = SDL_GetTicks() * 0.001f;   // Current time in sec
+		if (!inputLog.beginFrame(currTime)) {		// Recorded time when replaying
+			break;
+		}
 		deltaTime = currTime - prevTime;			// Update delta time
 		prevTime = currTime;						// Update last frame
 
+		// Start of frame. Free last frame's scratch and count this frame's heap allocations and GL state calls
+		frameArena.reset();
+		AllocTracker::beginFrame();
+		GLState::beginFrame();
+
+		// Collect finished frames' latencies (waits for the GPU here in low latency mode)
+		latency.beginFrame();
+
+		// Upload loaded pages and keep page textures under budget
+		pages.update();
+
+		// Pick each view's model pass resolution from its recent GPU times
+		for (int i = 0; i < (int)views.size(); i++) {
+			views[i].sceneTarget->update();
+		}
+
 		//printf("curr time: %f\n", currTime);
 
 
 		// Check for input (single click / press)
-		while (SDL_PollEvent(&event)) {
-			//printf("Curr state: %d\n", currState);
+		while (inputLog.pollEvent(event)) {
+			latency.inputEvent(event);			// Time the event through to the GPU
+
+			// View the event is for (events without a window go to the last view one was for)
+			for (int i = 0; i < (int)views.size(); i++) {
+				if (views[i].owns(event)) {
+					focusView = i;
+				}
+			}
+			View& eventView = views[focusView];
+
 			int temp_num;						// Temp number
-			temp_num = processStateInput(event, temp_state);  // Process exiting the program
+			temp_num = processStateInput(event, states[eventView.currState], glm::vec2((float)layoutWidth / eventView.width, (float)layoutHeight / eventView.height));  // Process exiting the program
 			//printf("temp state: %d\n", temp_num);
 			// If temp num is == -2, then no event happened,
 			// so if it's != -2, then an event happened
-			if (temp_num != -2) {
-				currState = temp_num;
-				Mix_PlayChannel(-1, gTentacle, 0);
+			if (temp_num == -1) {
+				quit = true;
+			} else if (temp_num != -2) {
+				eventView.currState = temp_num;
+				audio.play(sfxTentacle);  // Queued for the audio thread
+			}
+			// Clicked the model (not a button). Cast a ray through the view's last frame's camera
+			else if (eventView.currState == 0 && event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+				glm::vec2 ndc(2.0f * event.button.x / eventView.width - 1.0f, 1.0f - 2.0f * event.button.y / eventView.height);
+				PickHit hit;
+				Uint64 pick_start = SDL_GetPerformanceCounter();
+				bool picked = scene.pick(Ray::fromScreen(glm::inverse(eventView.projection * eventView.viewMatrix), ndc), hit);
+				double pick_us = (SDL_GetPerformanceCounter() - pick_start) * 1000000.0 / SDL_GetPerformanceFrequency();
+				if (picked) {
+					printPick(scene, hit, data, history, pyramid, pick_us);
+				}
+			}
+			// Window resized. Resize its model pass target (the viewport is set when the view is drawn)
+			if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+				eventView.resize();
+				if (focusView == 0) {
+					frameCapture.stop();	// Frames are read at the size the capture started with
+				}
+			}
+			// Extra view closed. Stop drawing it (the main window stays until escape)
+			if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE && focusView > 0) {
+				eventView.hide();
+			}
+			// Screenshot, or start / stop recording (of the main window)
+			if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+				SDL_Scancode key = event.key.keysym.scancode;
+				if (key == SDL_SCANCODE_F12) {
+					frameCapture.snapshot(views[0].drawableWidth, views[0].drawableHeight);
+				} else if ((key == SDL_SCANCODE_F9 || key == SDL_SCANCODE_F10) && frameCapture.isRecording()) {
+					frameCapture.stop();
+				} else if (key == SDL_SCANCODE_F9 || key == SDL_SCANCODE_F10) {
+					frameCapture.start(key == SDL_SCANCODE_F9 ? CAPTURE_PNG : CAPTURE_RAW, views[0].drawableWidth, views[0].drawableHeight);
+				}
+			}
+			// If key is L, then show or hide the sensor labels
+			if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_L) {
+				showLabels = !showLabels && text.isLoaded();
+			}
+			// If key is M, then animate the next identified mode
+			if (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_M) {
+				modeIndex++;
 			}
 		}
 
 		// Check if we need to exit
-		if (currState == -1) {
+		if (quit) {
 			break;
 		}
 
-		// Update temp state
-		temp_state = states[currState];
+		// A view entered a new state. Start loading the pages its buttons lead to
+		bool showModel = false;		// Does any view show the model?
+		for (int i = 0; i < (int)views.size(); i++) {
+			if (views[i].currState != views[i].shownState) {
+				prefetchLinkedStates(states, views[i].currState, pages);
+				views[i].shownState = views[i].currState;
+			}
+			showModel = showModel || (views[i].isShown() && views[i].currState == 0);
+		}
+
+		// Switch to an edited sensor layout once its interpolation is ready (uploads only the vertices that changed)
+		if (layoutWatcher.apply()) {
+			sensor_pos_p = bridgeModel->sensorLayout().positions();
+			sensor_pos_p.resize(bridgeModel->numSensors(), glm::vec3(0.0f));
+		}
 
-		// Process Input for Camera
-		camera = processCamInput(deltaTime, camera);
+		// Sample sensors at their own rate and feed the modal analysis. Received frames are used as they
+		// arrive. Replay feeds exactly the frames the recorded frame consumed, whether they were received or simulated
+		if (inputLog.replaying()) {
+			for (int i = 0; i < inputLog.recordedSamples(); i++) {
+				inputLog.sensorFrame(data);		// Replaced by the recorded frame
+				consumeSensorFrame(data, modal, history, pyramid, liveChart);
+			}
+		} else if (receiver.isRunning()) {
+			while (receiver.pop(data)) {
+				inputLog.sensorFrame(data);		// Recorded
+				consumeSensorFrame(data, modal, history, pyramid, liveChart);
+			}
+		} else {
+			int samples = 0;
+			while (sampleTime <= currTime && samples < SENSOR_MAX_CATCHUP) {
+				sensorSample(sampleTime, sensor_pos_p, bridgeInstances, data);
+				inputLog.sensorFrame(data);		// Recorded
+				consumeSensorFrame(data, modal, history, pyramid, liveChart);
+				sampleTime += 1.0f / SENSOR_RATE;
+				samples++;
+			}
 
-		// Rendering commands
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			// After a stall the missed samples are skipped rather than simulated over the next frames
+			if (sampleTime <= currTime) {
+				sampleTime = currTime + 1.0f / SENSOR_RATE;
+			}
+		}
 
-		// Only need model for main menu
-		if (currState == 0) {
-			// Use Model shader program and set model matrix
-			modelShader.use();  // Now every shader and rendering call will use shaderProgram
-			modelShader.setMat4("model", model);
+		// Pick up new mode shapes (only copies when the analysis published new ones)
+		if (modal.getModes(modes, modesVersion) && !modes.empty()) {
+			printf("Modes identified:");
+			for (int i = 0; i < (int)modes.size(); i++) {
+				printf(" %.2f Hz", modes[i].frequency);
+			}
+			printf("\n");
+		}
 
-			// Update View Matrix
-			view = camera.GetViewMatrix();
-			modelShader.setMat4("view", view);
+		// Process Input for Camera of the focused view (read right before it's used. Low latency mode fetches keys again first)
+		if (lowLatency) {
+			SDL_PumpEvents();
+		}
+		views[focusView].camera = processCamInput(deltaTime, views[focusView].camera, inputLog.keyboardState());
+		latency.inputSampled();
+
+		// Per-frame sensor data. Uploaded once, then read by every view that shows the model
+		if (showModel) {
+			// Sensor values for the heatmap (only the channels that changed are uploaded)
+			sensorValues.setAll(data);
+			sensorValues.upload();
+
+			// Copy the selected mode into the buffer only when the selection or the analysis changed
+			if (!modes.empty()) {
+				int selected = modeIndex % modes.size();
+				if (selected != shownMode || modesVersion != shownVersion) {
+					ModeShape& mode = modes[selected];
+					for (unsigned int s = 0; s < bridgeInstances.size(); s++) {
+						int offset = bridgeInstances[s].sensorOffset;	// The shader reads each span's sensors from its offset
+						for (int i = 0; i < (int)mode.amplitude.size() && offset + i < modeShapes.size(); i++) {
+							float shape[2] = { mode.amplitude[i], mode.phase[i] };
+							modeShapes.set(offset + i, shape);
+						}
+					}
+					modeShapes.upload();
+					shownMode = selected;
+					shownVersion = modesVersion;
+				}
+			}
+		}
 
-			// Update Projection Matrix
-			projection = glm::perspective(glm::radians(camera.Fov), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
-			modelShader.setMat4("projection", projection);
+		// Chart rows added this frame (once, however many views draw the chart)
+		liveChart.upload();
 
-			// Create data
-			std::vector<float> data;
-			for (int i = 0; i < 25; i++) {
-				float temp_val = sin(currTime + i / 25.0f);
-				data.push_back(temp_val);
-				//printf("data: %f\n", data.at(i));
+		// Draw every view with the one context. Only the main window waits for vsync (each extra wait would cost a refresh)
+		bool showStats = currTime - statsTime > 1.0f;
+		for (int v = 0; v < (int)views.size(); v++) {
+			View& currView = views[v];
+			if (!currView.isShown()) {
+				continue;
 			}
+			currView.begin(gContext, v == 0 ? swapInterval : 0);
 
-			// Actually render
-			int update_bool = 0;	// Do we need to update the mesh? 0 = no. 1 = yes
+			// Record the view's draws. Only need model for main menu
+			renderQueue.clear();
+			if (currView.currState == 0) {
+				// Update View and Projection Matrices
+				currView.updateMatrices();
 
-			// If over 30 sec has passed, then update mesh and updateTime
-			if (currTime - updateTime > 30.0f) {
-				update_bool = 1;
-				updateTime = currTime;
+				// Visible meshes (pixels per world unit at distance 1 picks each mesh's level of detail)
+				float pixels_per_unit = currView.sceneTarget->height() / (2.0f * tan(glm::radians(currView.camera.Fov) * 0.5f));
+				scene.addDraws(renderQueue, modelShader, currView.projection * currView.viewMatrix, currView.camera.Position, pixels_per_unit, frameArena);
 			}
 
-			ourModel.Draw(modelShader, data, update_bool);
+			// Pages and charts
+			states[currView.currState].addDraws(renderQueue, guiShader, pages);
 
-			glUseProgram(0);  // Reset shader program
+			// Live sensor values next to each sensor on the model (every label in one draw)
+			text.begin(currView.drawableWidth, currView.drawableHeight);
+			if (currView.currState == 0 && showLabels) {
+				addSensorLabels(text, bridgeModel->sensorLayout(), bridgeInstances, data, currView.projection * currView.viewMatrix, currView.drawableWidth, currView.drawableHeight);
+			}
+			text.addDraws(renderQueue, guiShader);
+
+			// Sort once (groups draws by program, texture and vertex array within each pass)
+			renderQueue.sort();
+
+			// Rendering commands
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// Model pass
+			if (currView.currState == 0) {
+				// Render into the view's dynamic resolution target
+				DynamicResolution& sceneTarget = *currView.sceneTarget;
+				sceneTarget.begin(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+
+				// Use Model shader program (model matrices come from the instance buffer)
+				modelShader.use();  // Now every shader and rendering call will use shaderProgram
+				modelShader.setMat4("view", currView.viewMatrix);
+				modelShader.setMat4("projection", currView.projection);
+
+				// Sensor values for the heatmap (uploaded above)
+				sensorValues.bind(1);
+				modelShader.setInt("showHeatmap", 1);
+				modelShader.setFloat("minValue", -1.0f);
+				modelShader.setFloat("maxValue", 1.0f);
+
+				// Animate the selected mode shape
+				if (!modes.empty()) {
+					modeShapes.bind(2);
+					modelShader.setInt("animateMode", 1);
+					modelShader.setFloat("modePhase", 2.0f * 3.14159265f * MODE_ANIM_RATE * currTime);
+					modelShader.setFloat("modeScale", MODE_SCALE);
+					modelShader.setVec3("modeAxis", glm::vec3(0.0f, 0.0f, 1.0f));  // Vertical
+				} else {
+					modelShader.setInt("animateMode", 0);
+				}
+
+				// Actually render
+				renderQueue.submit(RENDER_PASS_MODEL, RENDER_PASS_MODEL);
+
+				// Upscale under the GUI (which stays at native resolution)
+				sceneTarget.end();
+				sceneTarget.composite();
+
+				// Show culling, allocation, GL call and model pass switch counters in the title bar once a second
+				if (showStats) {
+					char title[384];
+					snprintf(title, sizeof(title), "sMaRT bRidGe - %ld triangles drawn, %ld culled (%d meshes drawn, %d culled), %ld allocs last frame, %ld GL state calls (%ld skipped), %d model draws (%d program switches), %.1f ms input to GPU, %dx%d model pass (%.1f ms)",
+						scene.stats.trianglesDrawn, scene.stats.trianglesCulled, scene.stats.meshesDrawn, scene.stats.meshesCulled, lastFrameAllocs,
+						lastGLIssued, lastGLSkipped, renderQueue.stats.items, renderQueue.stats.programChanges, latency.median(LATENCY_SAMPLE_TO_GPU), sceneTarget.width(), sceneTarget.height(), sceneTarget.passMs());
+					SDL_SetWindowTitle(currView.window, title);
+				}
 
-		}
-		
+			}
 
-		// Gui shader
-		guiShader.use();
 
-		temp_state.draw(guiShader);
+			// GUI passes (pages, then charts, then text) with the Gui shader
+			renderQueue.submit(RENDER_PASS_GUI, RENDER_PASS_TEXT);
 
-		glUseProgram(0);  // Reset shader program
 
 
+			// Read the main window's finished frame for capture (doesn't wait for the GPU)
+			if (v == 0) {
+				frameCapture.capture();
+			}
 
-		// Swap buffer
-		SDL_GL_SwapWindow(gwindow);
+			// Swap buffer (the time it blocks on vsync isn't counted in the frame profile)
+			profile.beforeSwap();
+			currView.swap();
+			profile.afterSwap();
+		}
+		if (showStats) {
+			statsTime = currTime;
+		}
+		latency.swapped();
+		inputLog.endFrame(views[focusView].camera);		// Write the frame's input (or check the replay)
+		profile.endFrame(currTime);
 
 		// Delay time
 		int frameTicks = SDL_GetTicks() * 0.001f - currTime;  // Amount of time to complete the frame
@@ -449,17 +936,75 @@ int main(int argc, char* args[]) {
 		//	SDL_Delay(1000 / 60 - frameTicks);  // Delay game time (ms)
 		//}
 
+		// End of frame. Steady-state frames shouldn't allocate
+		lastFrameAllocs = AllocTracker::endFrame();
+		lastGLIssued = GLState::issued();
+		lastGLSkipped = GLState::skipped();
+		frameCount++;
+		if (frameCount > BENCH_WARMUP_FRAMES && lastFrameAllocs > 0) {
+			steadyAllocs += lastFrameAllocs;
+			allocFrames++;
+		}
+		if (frameCount > BENCH_WARMUP_FRAMES) {
+			steadyGLIssued += lastGLIssued;
+			steadyGLSkipped += lastGLSkipped;
+		}
+		if (benchmarkFrames > 0 && frameCount >= BENCH_WARMUP_FRAMES + benchmarkFrames) {
+			break;
+		}
+
 	}
 
+	AllocTracker::endFrame();		// Stop counting (escape leaves mid frame)
+	SDL_GL_MakeCurrent(views[0].window, gContext);		// Clean up with the main window current
+
+	// Input to display latency, sensor packets, input log and frame profile
+	latency.print();
+	if (receiver.isRunning()) {
+		receiver.printStats();
+	}
+	inputLog.close();
+	profile.close();
+	pyramid.close();
+
 	// De-allocate all resources (Like buffers, arrays, shaderProgram)
+	latency.clearFences();			// Delete frame fences
+	for (int i = 0; i < (int)views.size(); i++) {
+		views[i].clearTarget();		// Delete model pass targets
+	}
+	frameCapture.clearCapture();	// Write frames in flight, stop encoder thread and delete pixel buffers
+	receiver.stop();				// Stop receive thread and close the socket
+	modal.stop();					// Stop modal analysis thread
 	modelShader.deleteProgram();		// Delete shader program
 	guiShader.deleteProgram();		// Delete shader program
-	ourModel.clearModel();			// Clear memory in model
-
-	// Free window and quit SDL
-	SDL_DestroyWindow(gwindow);	// Destroy window
+	text.clearText();				// Delete glyph atlas and buffers
+	sensorValues.clearBuffer();		// Delete sensor buffer textures
+	modeShapes.clearBuffer();
+	liveChart.clearChart();			// Delete chart ring buffer
+	layoutWatcher.stop();			// Stop layout watcher thread
+	scene.clearScene();				// Clear memory in models
+	pages.clearPages();				// Stop page loader and delete page textures
+	audio.stop();					// Stop audio thread and close the mixer
+
+	// Free windows and quit SDL
+	for (int i = 0; i < (int)views.size(); i++) {
+		views[i].closeWindow();	// Destroy window
+	}
 	SDL_Quit();					// Quit SDL
 
+	// Benchmark result. Fail if steady state allocated
+	if (benchmarkFrames > 0) {
+		int steadyFrames = std::max(frameCount - BENCH_WARMUP_FRAMES, 1);
+		printf("Benchmark: %d frames after %d warm-up, %ld heap allocations in %d frames\n",
+			frameCount - BENCH_WARMUP_FRAMES, BENCH_WARMUP_FRAMES, steadyAllocs, allocFrames);
+		printf("Benchmark: %.1f GL state calls issued and %.1f skipped per frame\n",
+			(double)steadyGLIssued / steadyFrames, (double)steadyGLSkipped / steadyFrames);
+		printf("Benchmark: frame arena grew %d times, to %lu bytes\n", frameArena.growths(), (unsigned long)frameArena.capacity());
+		if (steadyAllocs > 0) {
+			printf("Benchmark FAILED: steady-state frames allocated\n");
+			return 1;
+		}
+	}
 	
 	return 0;
 }
\ No newline at end of file
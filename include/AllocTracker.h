@@ -0,0 +1,145 @@
+#pragma once
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+#ifdef _MSC_VER
+#include <malloc.h>  // _aligned_malloc
+#endif
+
+
+// Allocation Tracker
+// Counts heap allocations made through operator new by threads that turned tracking on (the render
+// loop), so frames can be checked for allocations. Worker threads are not counted.
+// Define ALLOC_TRACKER_IMPLEMENTATION in exactly one source file before including this header to
+// replace the global operator new / delete with counting versions (plain, array and, when the compiler
+// has them, aligned). Direct malloc / realloc calls aren't seen: that's C libraries (SDL, stb_image,
+// the driver), and none of the render loop's own code calls them.
+class AllocTracker {
+public:
+	// Start counting this thread's allocations from zero
+	static void beginFrame() {
+		count() = 0;
+		bytes() = 0;
+		enabled() = true;
+	};
+
+	// Stop counting and return the number of allocations since beginFrame
+	static long endFrame() {
+		enabled() = false;
+		return count();
+	};
+
+	// Bytes allocated since beginFrame
+	static size_t frameBytes() {
+		return bytes();
+	};
+
+	// Called by operator new
+	static void record(size_t size) {
+		if (enabled()) {
+			count()++;
+			bytes() += size;
+		}
+	};
+
+
+private:
+	// Per-thread counters
+	static bool& enabled() {
+		static thread_local bool value = false;
+		return value;
+	};
+
+	static long& count() {
+		static thread_local long value = 0;
+		return value;
+	};
+
+	static size_t& bytes() {
+		static thread_local size_t value = 0;
+		return value;
+	};
+};
+
+
+#ifdef ALLOC_TRACKER_IMPLEMENTATION
+
+// Counting global operator new / delete (nothrow and array versions forward to these)
+void* operator new(size_t size) {
+	AllocTracker::record(size);
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+#ifdef __cpp_aligned_new
+
+// Aligned versions (types with alignas larger than the default)
+void* operator new(size_t size, std::align_val_t align) {
+	AllocTracker::record(size);
+	size_t alignment = (size_t)align;
+#ifdef _MSC_VER
+	void* ptr = _aligned_malloc(size > 0 ? size : 1, alignment);
+#else
+	void* ptr = aligned_alloc(alignment, ((size > 0 ? size : 1) + alignment - 1) & ~(alignment - 1));  // Size must be a multiple
+#endif
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+	return operator new(size, align);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+void operator delete[](void* ptr, std::align_val_t align) noexcept {
+	operator delete(ptr, align);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept {
+	operator delete(ptr, align);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept {
+	operator delete(ptr, align);
+}
+
+#endif
+
+#endif
+
+#endif
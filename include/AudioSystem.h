@@ -0,0 +1,319 @@
+#pragma once
+#ifndef AUDIO_SYSTEM_H
+#define AUDIO_SYSTEM_H
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+#include "RingQueue.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+
+const int AUDIO_FREQUENCY = 44100;		// Output sample rate (Hz)
+const int AUDIO_CHANNELS = 2;			// Output channels
+const int AUDIO_CHUNK_SIZE = 2048;		// Mixer buffer (samples)
+const Uint32 AUDIO_POLL_MS = 2;			// How often the audio thread checks for commands (ms)
+const char* const AUDIO_CACHE_ORG = "BRIDGE_GUI";	// PCM cache folder (SDL_GetPrefPath organization and application)
+const char* const AUDIO_CACHE_APP = "audio_cache";
+
+// Audio command types
+enum Audio_Command {
+	AUDIO_PLAY_EFFECT,		// Play an effect on a free channel
+	AUDIO_MUSIC_VOLUME		// Change the music volume
+};
+
+// Audio command (sent from the render loop to the audio thread)
+struct AudioCommand {
+	Audio_Command type;		// Command type
+	int value;				// Effect id or volume
+};
+
+// Sound effect
+struct SoundEffect {
+	std::string path;			// Source file (MP3, WAV, ...)
+	Mix_Chunk* chunk;			// Mixer chunk (NULL until loaded)
+	std::vector<Uint8> pcm;		// Samples in the output format (when loaded from the PCM cache)
+};
+
+// Header of a cached effect (samples already in the output format)
+struct PCMCacheHeader {
+	char magic[4];			// "PCM2"
+	int frequency;			// Output sample rate the samples are for
+	Uint16 format;			// SDL audio format
+	Uint16 channels;		// Output channels
+	Uint32 bytes;			// Bytes of samples after the header
+	long long sourceSize;		// Size of the source file decoded (a replaced source is decoded again)
+	long long sourceModified;	// Modified time of the source file decoded
+};
+
+
+// Audio System
+// SDL audio and the mixer are opened and closed on the main thread (SDL initialization isn't thread safe).
+// Decoding effects, starting the music and playing happen on the audio thread, so decoding can't hold up
+// startup or a frame. Effects are decoded once into the output format and cached as .pcm files in the
+// user's SDL preference folder (the install may be read-only), so later runs skip the MP3 decode. A cache
+// is only used while the source file has the size and modified time it was decoded from. Music is
+// streamed by SDL_mixer. The render loop sends commands through a lock-free queue. Commands sent before
+// loading finishes are run once it has.
+class AudioSystem {
+public:
+	// Constructor
+	AudioSystem() {
+		music = NULL;
+		musicVolume = MIX_MAX_VOLUME;
+		opened = false;
+		running = false;
+		loaded = false;
+	};
+
+	// Destructor
+	~AudioSystem() {
+		stop();
+	};
+
+
+	// Register an effect (before start). Returns its id for play()
+	int addEffect(std::string path) {
+		SoundEffect effect;
+		effect.path = path;
+		effect.chunk = NULL;
+		effects.push_back(effect);
+		return (int)effects.size() - 1;
+	};
+
+
+	// Set the looping music (before start)
+	void setMusic(std::string path, int volume) {
+		musicPath = path;
+		musicVolume = volume;
+	};
+
+
+	// Open the mixer, then start the audio thread to load and play (main thread, after SDL_Init)
+	void start() {
+		opened = open();
+		if (!opened) {
+			loaded = true;  // Nothing to load. Commands are dropped
+			return;
+		}
+		running = true;
+		worker = std::thread(&AudioSystem::run, this);
+	};
+
+
+	// Play an effect. Never blocks. Returns false if the command queue is full
+	bool play(int effect) {
+		AudioCommand command;
+		command.type = AUDIO_PLAY_EFFECT;
+		command.value = effect;
+		return commands.push(command);
+	};
+
+
+	// Set the music volume (0 to MIX_MAX_VOLUME). Never blocks
+	bool setMusicVolume(int volume) {
+		AudioCommand command;
+		command.type = AUDIO_MUSIC_VOLUME;
+		command.value = volume;
+		return commands.push(command);
+	};
+
+
+	// Has loading finished?
+	bool isLoaded() {
+		return loaded;
+	};
+
+
+	// Stop the audio thread and close the device (main thread)
+	void stop() {
+		running = false;
+		if (worker.joinable()) {
+			worker.join();
+		}
+		if (opened) {
+			Mix_CloseAudio();
+			SDL_QuitSubSystem(SDL_INIT_AUDIO);
+			opened = false;
+		}
+	};
+
+
+private:
+	std::vector<SoundEffect> effects;			// Effects (only touched by the audio thread after start)
+	std::string musicPath;						// Music file
+	Mix_Music* music;							// Streamed music
+	int musicVolume;							// Music volume
+	std::string cacheDir;						// PCM cache folder (empty = no cache)
+	bool opened;								// Is the mixer open?
+	RingQueue<AudioCommand, 64> commands;		// Commands from the render loop
+	std::thread worker;							// Audio thread
+	std::atomic<bool> running;					// Is the audio thread running?
+	std::atomic<bool> loaded;					// Has loading finished?
+
+
+	// Audio thread
+	void run() {
+		load();
+		loaded = true;
+
+		// Run commands until stopped
+		while (running) {
+			AudioCommand command;
+			while (commands.pop(command)) {
+				execute(command);
+			}
+			SDL_Delay(AUDIO_POLL_MS);
+		}
+
+		// Free what it loaded (the main thread closes the mixer after this)
+		Mix_HaltMusic();
+		if (music) {
+			Mix_FreeMusic(music);
+			music = NULL;
+		}
+		for (unsigned int i = 0; i < effects.size(); i++) {
+			if (effects[i].chunk) {
+				Mix_FreeChunk(effects[i].chunk);  // Doesn't free pcm (QuickLoad chunks don't own their samples)
+				effects[i].chunk = NULL;
+			}
+		}
+	};
+
+
+	// Initialize SDL audio, open the mixer and find the cache folder (main thread)
+	bool open() {
+		// Initialize SDL Mixer
+		if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+			printf("SDL Mixer could not initialize! SDL Error: %s\n", SDL_GetError());
+			return false;
+		}
+		if (Mix_OpenAudio(AUDIO_FREQUENCY, MIX_DEFAULT_FORMAT, AUDIO_CHANNELS, AUDIO_CHUNK_SIZE) < 0) {
+			printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+			SDL_QuitSubSystem(SDL_INIT_AUDIO);
+			return false;
+		}
+
+		// Per-user writable folder (created by SDL, ends in a separator)
+		char* pref = SDL_GetPrefPath(AUDIO_CACHE_ORG, AUDIO_CACHE_APP);
+		if (pref != NULL) {
+			cacheDir = pref;
+			SDL_free(pref);
+		} else {
+			printf("Audio: no cache folder, effects are decoded every run. Error: %s\n", SDL_GetError());
+		}
+		return true;
+	};
+
+
+	// Cache file of an effect (the source path with separators replaced, so effects don't collide)
+	std::string cachePath(const std::string& path) {
+		std::string name = path;
+		for (unsigned int i = 0; i < name.size(); i++) {
+			if (name[i] == '/' || name[i] == '\\' || name[i] == ':') {
+				name[i] = '_';
+			}
+		}
+		return cacheDir + name + ".pcm";
+	};
+
+
+	// Load effects and start the music
+	void load() {
+		// Output format (effects are cached in it)
+		int frequency;
+		Uint16 format;
+		int channels;
+		Mix_QuerySpec(&frequency, &format, &channels);
+
+		for (unsigned int i = 0; i < effects.size(); i++) {
+			loadEffect(effects[i], frequency, format, channels);
+		}
+
+		// Music is streamed (decoded a buffer at a time while it plays)
+		if (!musicPath.empty()) {
+			music = Mix_LoadMUS(musicPath.c_str());
+			if (!music) {
+				printf("Mix_LoadMUS music Error: %s\n", Mix_GetError());
+			} else {
+				Mix_PlayMusic(music, -1);
+				Mix_VolumeMusic(musicVolume);
+			}
+		}
+	};
+
+
+	// Load an effect from its PCM cache, or decode it and write the cache
+	void loadEffect(SoundEffect& effect, int frequency, Uint16 format, int channels) {
+		std::string cache_path = cachePath(effect.path);
+
+		// Source file the cache must match (no cache if it can't be read)
+		struct stat info;
+		bool source_known = stat(effect.path.c_str(), &info) == 0;
+		long long source_size = source_known ? (long long)info.st_size : 0;
+		long long source_modified = source_known ? (long long)info.st_mtime : 0;
+
+		// Cached samples in the same output format, decoded from the same source
+		FILE* file = cacheDir.empty() || !source_known ? NULL : fopen(cache_path.c_str(), "rb");
+		if (file) {
+			PCMCacheHeader header;
+			bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "PCM2", 4) == 0
+				&& header.frequency == frequency && header.format == format && header.channels == channels && header.bytes > 0
+				&& header.sourceSize == source_size && header.sourceModified == source_modified;
+			if (valid) {
+				effect.pcm.resize(header.bytes);
+				valid = fread(&effect.pcm[0], 1, header.bytes, file) == header.bytes;
+			}
+			fclose(file);
+			if (valid) {
+				effect.chunk = Mix_QuickLoad_RAW(&effect.pcm[0], (Uint32)effect.pcm.size());
+				return;
+			}
+			effect.pcm.clear();
+		}
+
+		// Decode (SDL_mixer converts to the output format)
+		effect.chunk = Mix_LoadWAV(effect.path.c_str());
+		if (!effect.chunk) {
+			printf("Mix_LoadWAV Error: %s\n", Mix_GetError());
+			return;
+		}
+
+		// Write the cache for next time (not being able to is fine)
+		file = cacheDir.empty() || !source_known ? NULL : fopen(cache_path.c_str(), "wb");
+		if (file) {
+			PCMCacheHeader header;
+			memcpy(header.magic, "PCM2", 4);
+			header.frequency = frequency;
+			header.format = format;
+			header.channels = (Uint16)channels;
+			header.bytes = effect.chunk->alen;
+			header.sourceSize = source_size;
+			header.sourceModified = source_modified;
+			fwrite(&header, sizeof(header), 1, file);
+			fwrite(effect.chunk->abuf, 1, effect.chunk->alen, file);
+			fclose(file);
+		}
+	};
+
+
+	// Run a command
+	void execute(const AudioCommand& command) {
+		if (command.type == AUDIO_PLAY_EFFECT) {
+			if (command.value >= 0 && command.value < (int)effects.size() && effects[command.value].chunk) {
+				Mix_PlayChannel(-1, effects[command.value].chunk, 0);
+			}
+		} else if (command.type == AUDIO_MUSIC_VOLUME) {
+			Mix_VolumeMusic(command.value);
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,423 @@
+#pragma once
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <float.h>
+#include <utility>
+#include <vector>
+
+
+// Ray (origin + t * direction). Direction doesn't have to be unit length, so a ray moved into object
+// space by an instance's inverse transform keeps the same t along it
+struct Ray {
+	glm::vec3 origin;			// Start point
+	glm::vec3 direction;		// Direction
+	glm::vec3 invDirection;		// 1 / direction (for box tests)
+
+	Ray(glm::vec3 aorigin, glm::vec3 adirection) : origin(aorigin), direction(adirection), invDirection(glm::vec3(1.0f) / adirection) {};
+
+	// Ray through a point on screen. inv_view_projection = inverse(projection * view). ndc = point in [-1, 1]
+	static Ray fromScreen(const glm::mat4& inv_view_projection, glm::vec2 ndc) {
+		glm::vec4 near_point = inv_view_projection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+		glm::vec4 far_point = inv_view_projection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+		glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+		return Ray(origin, glm::normalize(glm::vec3(far_point) / far_point.w - origin));
+	};
+
+	// Same ray in another space (e.g. world to object with an instance's inverse transform)
+	Ray transformed(const glm::mat4& m) const {
+		return Ray(glm::vec3(m * glm::vec4(origin, 1.0f)), glm::vec3(m * glm::vec4(direction, 0.0f)));
+	};
+};
+
+
+// Distance along a ray to a triangle (Moller-Trumbore). Returns false if it misses (or is behind the origin)
+inline bool rayTriangle(const Ray& ray, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, float& t) {
+	glm::vec3 edge1 = p1 - p0;
+	glm::vec3 edge2 = p2 - p0;
+	glm::vec3 p = glm::cross(ray.direction, edge2);
+	float det = glm::dot(edge1, p);
+	if (std::abs(det) < 1e-12f) {
+		return false;  // Parallel to the triangle
+	}
+	float inv_det = 1.0f / det;
+	glm::vec3 s = ray.origin - p0;
+	float u = glm::dot(s, p) * inv_det;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	glm::vec3 q = glm::cross(s, edge1);
+	float v = glm::dot(ray.direction, q) * inv_det;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	t = glm::dot(edge2, q) * inv_det;
+	return t >= 0.0f;
+}
+
+
+// Axis aligned bounding box
+struct AABB {
+	glm::vec3 min;		// Min corner
+	glm::vec3 max;		// Max corner
+
+	// Empty box (expanding it by anything gives that thing's bounds)
+	AABB() : min(glm::vec3(FLT_MAX)), max(glm::vec3(-FLT_MAX)) {};
+
+	AABB(glm::vec3 amin, glm::vec3 amax) : min(amin), max(amax) {};
+
+	// Grow to hold a point
+	void expand(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	};
+
+	// Grow to hold another box
+	void expand(const AABB& b) {
+		min = glm::min(min, b.min);
+		max = glm::max(max, b.max);
+	};
+
+	glm::vec3 center() const {
+		return (min + max) * 0.5f;
+	};
+
+	// Does a ray hit the box before max_t? entry = distance where it enters (0 if it starts inside)
+	bool intersect(const Ray& ray, float max_t, float& entry) const {
+		glm::vec3 t0 = (min - ray.origin) * ray.invDirection;
+		glm::vec3 t1 = (max - ray.origin) * ray.invDirection;
+		glm::vec3 near_t = glm::min(t0, t1);
+		glm::vec3 far_t = glm::max(t0, t1);
+		entry = std::max(std::max(near_t.x, near_t.y), std::max(near_t.z, 0.0f));
+		float exit = std::min(std::min(far_t.x, far_t.y), std::min(far_t.z, max_t));
+		return entry <= exit;
+	};
+
+	// Surface area (for the SAH)
+	float area() const {
+		glm::vec3 d = max - min;
+		if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f) {
+			return 0.0f;
+		}
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	};
+};
+
+
+// Frustum culling results
+enum Frustum_Test {
+	FRUSTUM_OUTSIDE,	// Box is completely outside
+	FRUSTUM_INTERSECT,	// Box crosses a plane
+	FRUSTUM_INSIDE		// Box is completely inside
+};
+
+
+// View frustum as 6 planes (ax + by + cz + d >= 0 inside)
+struct Frustum {
+	glm::vec4 planes[6];	// Left, right, bottom, top, near, far
+
+	// Extract planes from a view-projection matrix (Gribb & Hartmann)
+	Frustum(const glm::mat4& m) {
+		// Rows of the matrix (glm is column major)
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		planes[0] = row3 + row0;
+		planes[1] = row3 - row0;
+		planes[2] = row3 + row1;
+		planes[3] = row3 - row1;
+		planes[4] = row3 + row2;
+		planes[5] = row3 - row2;
+
+		// Normalize so distances are in world units
+		for (int i = 0; i < 6; i++) {
+			float length = glm::length(glm::vec3(planes[i]));
+			if (length > 0.0f) {
+				planes[i] = planes[i] / length;
+			}
+		}
+	};
+
+	// Test a box against the frustum
+	Frustum_Test test(const AABB& box) const {
+		Frustum_Test result = FRUSTUM_INSIDE;
+		for (int i = 0; i < 6; i++) {
+			glm::vec3 n = glm::vec3(planes[i]);
+
+			// Corner farthest along the plane normal (p-vertex) and nearest (n-vertex)
+			glm::vec3 p(n.x >= 0.0f ? box.max.x : box.min.x, n.y >= 0.0f ? box.max.y : box.min.y, n.z >= 0.0f ? box.max.z : box.min.z);
+			glm::vec3 q(n.x >= 0.0f ? box.min.x : box.max.x, n.y >= 0.0f ? box.min.y : box.max.y, n.z >= 0.0f ? box.min.z : box.max.z);
+
+			if (glm::dot(n, p) + planes[i].w < 0.0f) {
+				return FRUSTUM_OUTSIDE;
+			}
+			if (glm::dot(n, q) + planes[i].w < 0.0f) {
+				result = FRUSTUM_INTERSECT;
+			}
+		}
+		return result;
+	};
+};
+
+
+// BVH node
+struct BVHNode {
+	AABB bounds;		// Bounds of everything below
+	int left;			// Index of the left child (right child is left + 1). -1 = leaf
+	int first;			// Leaf: first item in BVH::items
+	int count;			// Leaf: number of items
+};
+
+
+// Bounding Volume Hierarchy
+// Built over a list of item boxes (meshes, triangles, ...) with a binned surface area heuristic.
+// Leaves reference ranges of the reordered items list.
+class BVH {
+public:
+	std::vector<BVHNode> nodes;		// Nodes. 0 = root
+	std::vector<int> items;			// Item indices, ordered so every leaf is a contiguous range
+
+	// Build over item bounds. max_leaf = largest number of items in a leaf
+	void build(const std::vector<AABB>& item_bounds, int max_leaf = 4) {
+		nodes.clear();
+		items.resize(item_bounds.size());
+		for (int i = 0; i < (int)items.size(); i++) {
+			items[i] = i;
+		}
+		if (items.empty()) {
+			return;
+		}
+
+		// Item centers
+		centers.resize(item_bounds.size());
+		for (int i = 0; i < (int)item_bounds.size(); i++) {
+			centers[i] = item_bounds[i].center();
+		}
+
+		nodes.reserve(2 * items.size());
+		BVHNode root;
+		root.left = -1;
+		root.first = 0;
+		root.count = (int)items.size();
+		nodes.push_back(root);
+		split(0, item_bounds, max_leaf);
+
+		centers.clear();
+		centers.shrink_to_fit();
+	};
+
+
+	// Collect every item whose node is not outside the frustum
+	// Items in nodes fully inside are added without testing their children
+	void query(const Frustum& frustum, std::vector<int>& visible) {
+		visible.clear();
+		if (nodes.empty()) {
+			return;
+		}
+
+		// Nodes to visit, and whether each is known to be fully inside
+		stack.clear();
+		stack.push_back(std::make_pair(0, false));
+		while (!stack.empty()) {
+			const BVHNode& node = nodes[stack.back().first];
+			bool node_inside = stack.back().second;
+			stack.pop_back();
+
+			// Test node (unless its parent was fully inside)
+			if (!node_inside) {
+				Frustum_Test result = frustum.test(node.bounds);
+				if (result == FRUSTUM_OUTSIDE) {
+					continue;
+				}
+				node_inside = (result == FRUSTUM_INSIDE);
+			}
+
+			// Leaf: add items
+			if (node.left < 0) {
+				for (int i = 0; i < node.count; i++) {
+					visible.push_back(items[node.first + i]);
+				}
+				continue;
+			}
+
+			// Visit children
+			stack.push_back(std::make_pair(node.left, node_inside));
+			stack.push_back(std::make_pair(node.left + 1, node_inside));
+		}
+	};
+
+
+	// Closest item hit by a ray. Nodes are visited nearest first and skipped once they start past the closest hit.
+	// hit_item(item, t) tests one item and returns true (lowering t) if the ray hits it closer than t.
+	// t = farthest distance to look (in), distance to the hit (out). Returns the item hit (-1 = none)
+	template <typename HitFunction>
+	int raycast(const Ray& ray, float& t, HitFunction hit_item) {
+		int hit = -1;
+		if (nodes.empty()) {
+			return hit;
+		}
+		float entry;
+		if (!nodes[0].bounds.intersect(ray, t, entry)) {
+			return hit;
+		}
+
+		// Nodes to visit and where the ray enters them
+		rayStack.clear();
+		rayStack.push_back(std::make_pair(0, entry));
+		while (!rayStack.empty()) {
+			int node_index = rayStack.back().first;
+			float node_entry = rayStack.back().second;
+			rayStack.pop_back();
+			if (node_entry > t) {
+				continue;  // Starts past the closest hit found since it was pushed
+			}
+			const BVHNode& node = nodes[node_index];
+
+			// Leaf: test items
+			if (node.left < 0) {
+				for (int i = 0; i < node.count; i++) {
+					if (hit_item(items[node.first + i], t)) {
+						hit = items[node.first + i];
+					}
+				}
+				continue;
+			}
+
+			// Visit children the ray hits, nearer one first (pushed last)
+			float left_entry, right_entry;
+			bool left_hit = nodes[node.left].bounds.intersect(ray, t, left_entry);
+			bool right_hit = nodes[node.left + 1].bounds.intersect(ray, t, right_entry);
+			if (left_hit && right_hit) {
+				bool left_first = left_entry <= right_entry;
+				rayStack.push_back(left_first ? std::make_pair(node.left + 1, right_entry) : std::make_pair(node.left, left_entry));
+				rayStack.push_back(left_first ? std::make_pair(node.left, left_entry) : std::make_pair(node.left + 1, right_entry));
+			} else if (left_hit) {
+				rayStack.push_back(std::make_pair(node.left, left_entry));
+			} else if (right_hit) {
+				rayStack.push_back(std::make_pair(node.left + 1, right_entry));
+			}
+		}
+		return hit;
+	};
+
+
+	// Bytes held by the nodes and item list
+	size_t bytes() {
+		return nodes.capacity() * sizeof(BVHNode) + items.capacity() * sizeof(int);
+	};
+
+
+private:
+	std::vector<glm::vec3> centers;					// Item centers (only during build)
+	std::vector<std::pair<int, bool>> stack;		// Traversal stack (kept between queries)
+	std::vector<std::pair<int, float>> rayStack;	// Ray traversal stack (kept between raycasts)
+
+	// Number of SAH bins per axis
+	static const int NUM_BINS = 12;
+
+
+	// Split a node with the binned surface area heuristic, then recurse into its children
+	void split(int node_index, const std::vector<AABB>& item_bounds, int max_leaf) {
+		// Bounds of the node and of its item centers
+		AABB bounds, center_bounds;
+		int first = nodes[node_index].first;
+		int count = nodes[node_index].count;
+		for (int i = first; i < first + count; i++) {
+			bounds.expand(item_bounds[items[i]]);
+			center_bounds.expand(centers[items[i]]);
+		}
+		nodes[node_index].bounds = bounds;
+		if (count <= max_leaf) {
+			return;
+		}
+
+		// Find the cheapest split over every axis
+		float best_cost = FLT_MAX;
+		int best_axis = -1;
+		int best_bin = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			float lo = center_bounds.min[axis];
+			float extent = center_bounds.max[axis] - lo;
+			if (extent <= 0.0f) {
+				continue;
+			}
+
+			// Fill bins
+			AABB bin_bounds[NUM_BINS];
+			int bin_count[NUM_BINS] = { 0 };
+			for (int i = first; i < first + count; i++) {
+				int b = std::min(NUM_BINS - 1, (int)((centers[items[i]][axis] - lo) / extent * NUM_BINS));
+				bin_bounds[b].expand(item_bounds[items[i]]);
+				bin_count[b]++;
+			}
+
+			// Sweep from the right, then evaluate from the left
+			float right_area[NUM_BINS];
+			int right_count[NUM_BINS];
+			AABB right_box;
+			int right_sum = 0;
+			for (int b = NUM_BINS - 1; b > 0; b--) {
+				right_box.expand(bin_bounds[b]);
+				right_sum += bin_count[b];
+				right_area[b] = right_box.area();
+				right_count[b] = right_sum;
+			}
+			AABB left_box;
+			int left_sum = 0;
+			for (int b = 0; b < NUM_BINS - 1; b++) {
+				left_box.expand(bin_bounds[b]);
+				left_sum += bin_count[b];
+				if (left_sum == 0 || right_count[b + 1] == 0) {
+					continue;
+				}
+				float cost = left_box.area() * left_sum + right_area[b + 1] * right_count[b + 1];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_bin = b;
+				}
+			}
+		}
+
+		// Leaf if every center is in the same spot, or if splitting costs more than a leaf (unless the leaf would be too big)
+		if (best_axis < 0 || (best_cost >= bounds.area() * count && count <= 4 * max_leaf)) {
+			return;
+		}
+
+		// Partition items around the split
+		float lo = center_bounds.min[best_axis];
+		float extent = center_bounds.max[best_axis] - lo;
+		int* mid = std::partition(&items[first], &items[first] + count, [&](int item) {
+			int b = std::min(NUM_BINS - 1, (int)((centers[item][best_axis] - lo) / extent * NUM_BINS));
+			return b <= best_bin;
+		});
+		int left_count = (int)(mid - &items[first]);
+		if (left_count == 0 || left_count == count) {
+			return;
+		}
+
+		// Create children (next to each other so right = left + 1)
+		int left = (int)nodes.size();
+		BVHNode child;
+		child.left = -1;
+		child.first = first;
+		child.count = left_count;
+		nodes.push_back(child);
+		child.first = first + left_count;
+		child.count = count - left_count;
+		nodes.push_back(child);
+
+		nodes[node_index].left = left;
+		nodes[node_index].count = 0;
+		split(left, item_bounds, max_leaf);
+		split(left + 1, item_bounds, max_leaf);
+	};
+};
+
+#endif
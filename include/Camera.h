@@ -34,6 +34,8 @@ const float PITCH = 0.0f;
 const float SPEED = 20.0f;
 const float SENSITIVITY = 1.0f;
 const float FOV = 45.0f;		// Aka zoom
+const float NEAR_PLANE = 0.1f;	// Projection near plane
+const float FAR_PLANE = 100.0f;	// Projection far plane (also the distance the render queue's depth keys span)
 
 
 // An abstract camera class that processes input and calculates the
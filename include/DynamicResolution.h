@@ -0,0 +1,239 @@
+#pragma once
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include "GLState.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+
+const int DYNRES_QUERIES = 4;			// Timer queries in flight (results are read a few frames late so nothing stalls)
+const int DYNRES_ADJUST_FRAMES = 15;	// Frames averaged between scale changes
+const float DYNRES_HEADROOM = 0.8f;		// Scale up only when under this fraction of the target
+const float DYNRES_STEP_UP = 0.05f;		// Largest scale increase per change (slow, so it doesn't oscillate)
+const float DYNRES_STEP_DOWN = 0.25f;	// Largest scale decrease per change
+
+
+// Dynamic Resolution
+// Offscreen target for the 3D pass whose resolution follows a GPU time target. The pass renders into the
+// lower-left part of a native-size color texture and depth buffer (so changing scale never reallocates),
+// then composite() stretches that part over the window with a linear blit. The GUI is drawn on top at native
+// resolution. The pass's GPU time is measured with timer queries, averaged, and the scale (per axis) is set so
+// the pixel count fits the target.
+class DynamicResolution {
+public:
+	// Constructor
+	// target_ms = GPU time allowed for the pass. min_scale = lowest resolution scale per axis
+	DynamicResolution(float target_ms, float min_scale = 0.5f) {
+		targetMs = target_ms;
+		minScale = min_scale;
+		renderScale = 1.0f;
+		nativeWidth = nativeHeight = 0;
+		renderWidth = renderHeight = 0;
+		FBO = colorTexture = depthBuffer = 0;
+		frame = 0;
+		timing = false;
+		sumMs = 0.0;
+		sampledFrames = 0;
+		lastMs = 0.0f;
+
+		glGenQueries(DYNRES_QUERIES, queries);
+		for (int i = 0; i < DYNRES_QUERIES; i++) {
+			pending[i] = false;
+		}
+	};
+
+
+	// Set the native (drawable) size. Reallocates the target
+	void resize(int width, int height) {
+		width = std::max(width, 1);
+		height = std::max(height, 1);
+		if (width == nativeWidth && height == nativeHeight) {
+			return;
+		}
+		nativeWidth = width;
+		nativeHeight = height;
+		deleteTarget();
+
+		// Color texture (linear filtered for the upscale)
+		glGenTextures(1, &colorTexture);
+		GLState::bindTexture(0, GL_TEXTURE_2D, colorTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, nativeWidth, nativeHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+		// Depth buffer
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, nativeWidth, nativeHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		// Framebuffer
+		glGenFramebuffers(1, &FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			printf("Dynamic resolution framebuffer is incomplete\n");
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		updateRenderSize();
+	};
+
+
+	// Start the pass. Binds and clears the target at the current render size and starts timing
+	void begin(glm::vec4 clear_color) {
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glViewport(0, 0, renderWidth, renderHeight);
+		glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Time the pass (skipped if this slot's last result hasn't been read yet)
+		int slot = frame % DYNRES_QUERIES;
+		timing = !pending[slot];
+		if (timing) {
+			glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+		}
+	};
+
+
+	// End the pass. Back to the default framebuffer at native size
+	void end() {
+		if (timing) {
+			glEndQuery(GL_TIME_ELAPSED);
+			pending[frame % DYNRES_QUERIES] = true;
+		}
+		frame++;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, nativeWidth, nativeHeight);
+	};
+
+
+	// Stretch the rendered part over the default framebuffer (call before drawing the GUI)
+	void composite() {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, nativeWidth, nativeHeight, GL_COLOR_BUFFER_BIT,
+			(renderWidth == nativeWidth && renderHeight == nativeHeight) ? GL_NEAREST : GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	};
+
+
+	// Once per frame. Reads finished timings and adjusts the scale
+	void update() {
+		for (int i = 0; i < DYNRES_QUERIES; i++) {
+			if (!pending[i]) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+			pending[i] = false;
+			sumMs += ns / 1000000.0;
+			sampledFrames++;
+		}
+		if (sampledFrames < DYNRES_ADJUST_FRAMES) {
+			return;
+		}
+
+		// Pixel count (and roughly GPU time) goes with scale squared
+		lastMs = (float)(sumMs / sampledFrames);
+		sumMs = 0.0;
+		sampledFrames = 0;
+		float wanted = renderScale * std::sqrt(targetMs / std::max(lastMs, 0.01f));
+		float scale = renderScale;
+		if (lastMs > targetMs) {
+			scale = std::max(wanted, renderScale - DYNRES_STEP_DOWN);
+		} else if (lastMs < targetMs * DYNRES_HEADROOM) {
+			scale = std::min(wanted, renderScale + DYNRES_STEP_UP);
+		}
+		scale = std::min(std::max(scale, minScale), 1.0f);
+		if (std::abs(scale - renderScale) > 0.005f) {
+			renderScale = scale;
+			updateRenderSize();
+		}
+	};
+
+
+	// Render size (pixels)
+	int width() {
+		return renderWidth;
+	};
+
+	int height() {
+		return renderHeight;
+	};
+
+
+	// Resolution scale per axis
+	float scale() {
+		return renderScale;
+	};
+
+
+	// Last averaged GPU time of the pass (ms)
+	float passMs() {
+		return lastMs;
+	};
+
+
+	// Delete the target and timer queries
+	void clearTarget() {
+		deleteTarget();
+		glDeleteQueries(DYNRES_QUERIES, queries);
+	};
+
+
+private:
+	float targetMs;						// GPU time target for the pass (ms)
+	float minScale;						// Lowest scale
+	float renderScale;					// Current scale per axis
+	int nativeWidth, nativeHeight;		// Drawable size
+	int renderWidth, renderHeight;		// Render size
+	unsigned int FBO;					// Framebuffer
+	unsigned int colorTexture;			// Color attachment (native size)
+	unsigned int depthBuffer;			// Depth attachment (native size)
+
+	// Timing
+	unsigned int queries[DYNRES_QUERIES];	// GL_TIME_ELAPSED queries
+	bool pending[DYNRES_QUERIES];			// Query issued and not read yet
+	bool timing;							// Is this frame's pass being timed?
+	unsigned long frame;					// Passes started
+	double sumMs;							// GPU time of the frames sampled since the last change
+	int sampledFrames;						// Frames sampled since the last change
+	float lastMs;							// Last average
+
+
+	// Render size from the scale
+	void updateRenderSize() {
+		renderWidth = std::max(1, (int)(nativeWidth * renderScale + 0.5f));
+		renderHeight = std::max(1, (int)(nativeHeight * renderScale + 0.5f));
+	};
+
+
+	// Delete the framebuffer and attachments
+	void deleteTarget() {
+		if (FBO != 0) {
+			glDeleteFramebuffers(1, &FBO);
+			GLState::deleteTexture(colorTexture);
+			glDeleteRenderbuffers(1, &depthBuffer);
+			FBO = colorTexture = depthBuffer = 0;
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <algorithm>
+#include <stddef.h>
+#include <vector>
+
+
+// Span
+// Non-owning view of a contiguous array (pointer + count). Used to pass arrays through the draw API
+// without copying them or caring whether they live in a vector or in the frame arena.
+template <typename T>
+struct Span {
+	T* ptr;			// First element
+	size_t count;	// Number of elements
+
+	Span() : ptr(NULL), count(0) {};
+	Span(T* aptr, size_t acount) : ptr(aptr), count(acount) {};
+
+	// View of a vector (Span<const T> can view a const vector)
+	template <typename U>
+	Span(std::vector<U>& v) : ptr(v.empty() ? NULL : &v[0]), count(v.size()) {};
+	template <typename U>
+	Span(const std::vector<U>& v) : ptr(v.empty() ? NULL : &v[0]), count(v.size()) {};
+
+	T& operator[](size_t i) const { return ptr[i]; };
+	T* begin() const { return ptr; };
+	T* end() const { return ptr + count; };
+	size_t size() const { return count; };
+	bool empty() const { return count == 0; };
+};
+
+
+// Frame Arena
+// Linear allocator for data that only lives for one frame. Allocating bumps an offset into one
+// preallocated block and reset() frees everything at once, so steady-state frames never touch the heap.
+// Only trivially destructible types should be allocated (nothing is destroyed on reset).
+// If a frame needs more than the block holds, the extra comes from the heap and the block grows to the
+// frame's high water mark on the next reset. Growth is only counted here (reported by the caller, so the
+// frame loop doesn't print).
+class FrameArena {
+public:
+	// Constructor
+	FrameArena(size_t capacity = 1 << 20) {
+		buffer.resize(capacity);
+		offset = 0;
+		highWater = 0;
+		grown = 0;
+	};
+
+	// Destructor
+	~FrameArena() {
+		freeOverflow();
+	};
+
+
+	// Allocate count uninitialized elements of T
+	template <typename T>
+	Span<T> alloc(size_t count) {
+		size_t align = alignof(T);
+		size_t start = (offset + align - 1) & ~(align - 1);		// Round up to T's alignment
+		size_t bytes = count * sizeof(T);
+		offset = start + bytes;
+		highWater = std::max(highWater, offset);
+
+		// Out of room. Take this allocation from the heap until the block grows
+		if (offset > buffer.size()) {
+			char* block = new char[bytes + align];
+			overflow.push_back(block);
+			size_t address = ((size_t)block + align - 1) & ~(align - 1);
+			return Span<T>((T*)address, count);
+		}
+		return Span<T>((T*)&buffer[start], count);
+	};
+
+
+	// Free everything allocated this frame
+	void reset() {
+		// Grow to the last frame's high water mark so the next frame fits in the block
+		if (!overflow.empty()) {
+			freeOverflow();
+			buffer.resize(highWater);
+			grown++;
+		}
+		offset = 0;
+		highWater = 0;
+	};
+
+
+	// Bytes allocated this frame
+	size_t used() {
+		return offset;
+	};
+
+
+	// Size of the block (bytes)
+	size_t capacity() {
+		return buffer.size();
+	};
+
+
+	// Times the block has grown
+	int growths() {
+		return grown;
+	};
+
+
+private:
+	std::vector<char> buffer;		// Preallocated block
+	std::vector<char*> overflow;	// Heap blocks allocated this frame after the block ran out
+	size_t offset;					// Next free byte
+	size_t highWater;				// Most bytes needed this frame
+	int grown;						// Times the block has grown
+
+
+	// Free heap blocks
+	void freeOverflow() {
+		for (unsigned int i = 0; i < overflow.size(); i++) {
+			delete[] overflow[i];
+		}
+		overflow.clear();
+	};
+};
+
+#endif
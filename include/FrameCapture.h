@@ -0,0 +1,346 @@
+#pragma once
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include "stb_image_write.h"
+
+#include "RingQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <time.h>
+
+
+const int CAPTURE_PBOS = 4;				// Pixel buffers (read-backs in flight and mapped frames the encoder is writing)
+const int CAPTURE_POLL_MS = 1;			// How often the encoder checks for frames when idle (ms)
+
+// Capture output
+enum Capture_Format {
+	CAPTURE_PNG,		// PNG per frame
+	CAPTURE_RAW			// One file of raw RGBA frames, top row first
+};
+
+// Pixel buffer a frame is read into. Free when it has no fence and isn't mapped
+struct CaptureSlot {
+	unsigned int PBO;				// Pixel pack buffer
+	GLsync fence;					// Signaled when the read-back is done (0 = no read-back in flight)
+	const unsigned char* pixels;	// Mapped frame the encoder is writing (RGBA, bottom row first. NULL = not mapped)
+	long frame;						// Frame number in the capture
+};
+
+
+// Frame Capture
+// Records the back buffer without stalling. capture() issues glReadPixels into a pixel buffer object and
+// fences it. A few frames later, once the fence has signaled, the buffer is mapped and the mapped pointer is
+// handed to the encoder thread, which writes a PNG sequence or a raw video file straight from it. The render
+// thread unmaps the buffer once the encoder hands it back. Buffers are preallocated and passed through lock-free
+// queues; if the GPU or the encoder falls behind, there is no free buffer and the frame is dropped instead of waiting.
+class FrameCapture {
+public:
+	// Constructor. prefix = start of the file names written
+	FrameCapture(std::string prefix_p = "capture") {
+		prefix = prefix_p;
+		width = height = 0;
+		recording = false;
+		snapshotOnly = false;
+		format = CAPTURE_PNG;
+		nextFrame = 0;
+		dropped = 0;
+		captures = 0;
+		raw = NULL;
+		running = false;
+		for (int i = 0; i < CAPTURE_PBOS; i++) {
+			slots[i].PBO = 0;
+			slots[i].fence = 0;
+			slots[i].pixels = NULL;
+		}
+	};
+
+	// Destructor
+	~FrameCapture() {
+		stopEncoder();
+	};
+
+
+	// Start recording every frame at the drawable size
+	bool start(Capture_Format format_p, int width_p, int height_p) {
+		if (recording) {
+			return false;
+		}
+		format = format_p;
+		snapshotOnly = false;
+		return begin(width_p, height_p);
+	};
+
+
+	// Capture the next frame only (as a PNG)
+	bool snapshot(int width_p, int height_p) {
+		if (recording) {
+			return false;
+		}
+		format = CAPTURE_PNG;
+		snapshotOnly = true;
+		return begin(width_p, height_p);
+	};
+
+
+	// Stop capturing. Waits for the frames in flight to be written, then stops the encoder and closes the file
+	void stop() {
+		bool was_recording = recording;
+		recording = false;
+		if (running) {
+			finish();
+		}
+		if (was_recording) {
+			printf("Capture %s: %ld frames, %ld dropped\n", session.c_str(), nextFrame, dropped);
+		}
+	};
+
+
+	// Is a capture running?
+	bool isRecording() {
+		return recording;
+	};
+
+
+	// Once per frame, right before the swap. Hands finished read-backs to the encoder, then reads this frame
+	void capture() {
+		collect(false);
+		if (!recording) {
+			// A snapshot's encoder stops once its frame is written (it's idle by then, so the join doesn't wait)
+			if (running && idle()) {
+				stopEncoder();
+			}
+			return;
+		}
+
+		// Free pixel buffer (the GPU or the encoder is behind if there isn't one, so drop the frame)
+		int slot = -1;
+		for (int i = 0; i < CAPTURE_PBOS; i++) {
+			if (slots[i].fence == 0 && slots[i].pixels == NULL) {
+				slot = i;
+				break;
+			}
+		}
+		if (slot < 0) {
+			dropped++;
+			nextFrame++;
+			return;
+		}
+
+		// Read the back buffer into it (returns right away)
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[slot].PBO);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadBuffer(GL_BACK);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slots[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slots[slot].frame = nextFrame++;
+
+		if (snapshotOnly) {
+			recording = false;
+			printf("Snapshot %s\n", session.c_str());
+		}
+	};
+
+
+	// Finish frames in flight, stop the encoder and delete the pixel buffers
+	void clearCapture() {
+		stop();
+		for (int i = 0; i < CAPTURE_PBOS; i++) {
+			if (slots[i].PBO != 0) {
+				glDeleteBuffers(1, &slots[i].PBO);
+				slots[i].PBO = 0;
+			}
+		}
+	};
+
+
+private:
+	std::string prefix;						// File name prefix
+	std::string session;					// File name of this capture (prefix and start time)
+	Capture_Format format;					// Output
+	int width, height;						// Frame size
+	bool recording;							// Reading new frames?
+	bool snapshotOnly;						// Stop after one frame?
+	long nextFrame;							// Next frame number
+	long dropped;							// Frames dropped (GPU or encoder behind)
+	int captures;							// Captures started
+	CaptureSlot slots[CAPTURE_PBOS];		// Pixel buffers
+
+	// Encoder thread
+	std::thread encoder;					// Encoder thread
+	std::atomic<bool> running;				// Is the encoder running?
+	RingQueue<int, 8> encodeQueue;			// Mapped buffers to write (render thread -> encoder)
+	RingQueue<int, 8> doneQueue;			// Buffers written (encoder -> render thread, which unmaps them)
+	FILE* raw;								// Raw video file
+
+
+	// Start a capture
+	bool begin(int width_p, int height_p) {
+		// A snapshot may still be writing. Let it finish (nothing is mapped or in flight after this)
+		if (running) {
+			finish();
+		}
+
+		// Pixel buffers for this size
+		if (width_p != width || height_p != height) {
+			width = width_p;
+			height = height_p;
+			size_t bytes = (size_t)width * height * 4;
+			for (int i = 0; i < CAPTURE_PBOS; i++) {
+				if (slots[i].PBO == 0) {
+					glGenBuffers(1, &slots[i].PBO);
+				}
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].PBO);
+				glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+
+		// File names start with the time and capture number, so captures don't overwrite each other
+		char name[64];
+		snprintf(name, sizeof(name), "%s_%ld_%02d", prefix.c_str(), (long)time(NULL), captures++);
+		session = name;
+		if (format == CAPTURE_RAW) {
+			std::string path = session + ".rgba";
+			raw = fopen(path.c_str(), "wb");
+			if (!raw) {
+				printf("Capture: can't create %s\n", path.c_str());
+				return false;
+			}
+			printf("Capture %s: raw RGBA %dx%d (ffmpeg -f rawvideo -pix_fmt rgba -s %dx%d -r 60 -i %s out.mp4)\n",
+				session.c_str(), width, height, width, height, path.c_str());
+		}
+		nextFrame = 0;
+		dropped = 0;
+		recording = true;
+		running = true;
+		encoder = std::thread(&FrameCapture::run, this);
+		return true;
+	};
+
+
+	// Unmap buffers the encoder is done with, then map finished read-backs and queue them for the encoder
+	// (wait = block until every read-back is done)
+	void collect(bool wait) {
+		int index;
+		while (doneQueue.pop(index)) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[index].PBO);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slots[index].pixels = NULL;
+		}
+
+		while (true) {
+			// Oldest read-back in flight
+			int oldest = -1;
+			for (int i = 0; i < CAPTURE_PBOS; i++) {
+				if (slots[i].fence != 0 && (oldest < 0 || slots[i].frame < slots[oldest].frame)) {
+					oldest = i;
+				}
+			}
+			if (oldest < 0) {
+				return;
+			}
+			CaptureSlot& slot = slots[oldest];
+			GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				return;  // Not done yet (later ones won't be either)
+			}
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+
+			// Map it and hand the pointer to the encoder (it stays mapped until the encoder is done with it)
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO);
+			slot.pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)width * height * 4, GL_MAP_READ_BIT);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			if (slot.pixels == NULL) {
+				dropped++;
+				continue;
+			}
+			encodeQueue.push(oldest);  // Never full (there are fewer buffers than queue entries)
+		}
+	};
+
+
+	// Are all pixel buffers free?
+	bool idle() {
+		for (int i = 0; i < CAPTURE_PBOS; i++) {
+			if (slots[i].fence != 0 || slots[i].pixels != NULL) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+
+	// Write every frame in flight, then stop the encoder and unmap what it wrote
+	void finish() {
+		collect(true);
+		stopEncoder();
+		collect(false);
+	};
+
+
+	// Encoder loop
+	void run() {
+		stbi_flip_vertically_on_write(1);  // Frames are read bottom row first
+		while (true) {
+			int index;
+			if (!encodeQueue.pop(index)) {
+				if (!running) {
+					return;  // Stopped and nothing left to write
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(CAPTURE_POLL_MS));
+				continue;
+			}
+			write(slots[index]);
+			doneQueue.push(index);
+		}
+	};
+
+
+	// Write one frame from its mapped buffer
+	void write(const CaptureSlot& slot) {
+		int stride = width * 4;
+		if (raw != NULL) {
+			// Top row first
+			for (int y = height - 1; y >= 0; y--) {
+				fwrite(slot.pixels + (size_t)y * stride, 1, stride, raw);
+			}
+			return;
+		}
+		char path[128];
+		snprintf(path, sizeof(path), "%s_%05ld.png", session.c_str(), slot.frame);
+		if (!stbi_write_png(path, width, height, 4, slot.pixels, stride)) {
+			printf("Capture: can't write %s\n", path);
+		}
+	};
+
+
+	// Stop the encoder once it has written everything queued, and close the raw video file
+	void stopEncoder() {
+		if (running) {
+			running = false;
+			encoder.join();
+		}
+		closeRaw();
+	};
+
+
+	// Close the raw video file
+	void closeRaw() {
+		if (raw != NULL) {
+			fclose(raw);
+			raw = NULL;
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,192 @@
+#pragma once
+#ifndef FRAME_PROFILE_H
+#define FRAME_PROFILE_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+#include <SDL.h>
+
+#include <stdio.h>
+
+
+const int PROFILE_BINS = 200;		// Frame time histogram bins (0.25 ms each, the last one holds everything slower)
+const float PROFILE_BIN_MS = 0.25f;	// Bin width (ms)
+const int PROFILE_GPU_FRAMES = 4;	// Frames whose GPU timestamps can be in flight (rows are written once they're back)
+
+// Frame waiting for its GPU timestamps
+struct ProfileFrame {
+	unsigned int queries[2];	// GPU timestamps at the start of the frame and before its last swap
+	float time;					// Frame clock time (s)
+	double cpuMs;				// CPU time (ms)
+};
+
+
+// Frame Profile
+// Writes each frame's CPU time and GPU time to a CSV file with the frame's clock time, so profiles of the
+// same replayed input can be diffed across builds. CPU time runs from the frame start to the end of the
+// frame without the time spent in swaps, which block on vsync. GPU time runs from a timestamp at the frame
+// start to one before the last swap; rows are written a few frames later, once the timestamps are back, so
+// the GPU is never waited on. Prints a summary when closed.
+class FrameProfile {
+public:
+	// Constructor
+	FrameProfile() {
+		file = NULL;
+		frequency = (double)SDL_GetPerformanceFrequency();
+		start = 0;
+		swapStart = 0;
+		swapTicks = 0;
+		frames = 0;
+		written = 0;
+		sum = 0.0;
+		max = 0.0;
+		gpuSum = 0.0;
+		gpuMax = 0.0;
+		for (int i = 0; i < PROFILE_BINS; i++) {
+			counts[i] = 0;
+		}
+	};
+
+	// Destructor
+	~FrameProfile() {
+		close();
+	};
+
+
+	// Start writing to a CSV file (GL context current)
+	bool open(const char* path) {
+		file = fopen(path, "w");
+		if (!file) {
+			printf("Frame profile: can't create %s\n", path);
+			return false;
+		}
+		fprintf(file, "frame,time_s,cpu_ms,gpu_ms\n");
+		for (int i = 0; i < PROFILE_GPU_FRAMES; i++) {
+			glGenQueries(2, slots[i].queries);
+		}
+		return true;
+	};
+
+
+	// Start of frame
+	void beginFrame() {
+		start = SDL_GetPerformanceCounter();
+		swapTicks = 0;
+		if (file == NULL) {
+			return;
+		}
+
+		// This frame's slot must be written first (only waits if the GPU is PROFILE_GPU_FRAMES frames behind)
+		if (frames - written >= PROFILE_GPU_FRAMES) {
+			writeFrames(frames - PROFILE_GPU_FRAMES + 1, true);
+		}
+		glQueryCounter(slots[frames % PROFILE_GPU_FRAMES].queries[0], GL_TIMESTAMP);
+	};
+
+
+	// Right before a swap (the last one of the frame ends its GPU time)
+	void beforeSwap() {
+		swapStart = SDL_GetPerformanceCounter();
+		if (file != NULL) {
+			glQueryCounter(slots[frames % PROFILE_GPU_FRAMES].queries[1], GL_TIMESTAMP);
+		}
+	};
+
+
+	// Right after a swap (the time it blocked isn't CPU time)
+	void afterSwap() {
+		swapTicks += SDL_GetPerformanceCounter() - swapStart;
+	};
+
+
+	// End of frame (after the swaps). time = the frame's clock time (virtual on replay)
+	void endFrame(float time) {
+		if (file == NULL) {
+			return;
+		}
+		double ms = (SDL_GetPerformanceCounter() - start - swapTicks) * 1000.0 / frequency;
+		ProfileFrame& slot = slots[frames % PROFILE_GPU_FRAMES];
+		slot.time = time;
+		slot.cpuMs = ms;
+
+		int bin = (int)(ms / PROFILE_BIN_MS);
+		counts[bin < PROFILE_BINS ? bin : PROFILE_BINS - 1]++;
+		frames++;
+		sum += ms;
+		max = ms > max ? ms : max;
+
+		// Rows of frames whose GPU timestamps are back
+		writeFrames(frames, false);
+	};
+
+
+	// Write the last rows, close the file and print the summary
+	void close() {
+		if (file == NULL) {
+			return;
+		}
+		writeFrames(frames, true);
+		for (int i = 0; i < PROFILE_GPU_FRAMES; i++) {
+			glDeleteQueries(2, slots[i].queries);
+		}
+		fclose(file);
+		file = NULL;
+		if (frames > 0) {
+			printf("Frame profile: %ld frames, CPU mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms. GPU mean %.2f ms, max %.2f ms\n",
+				frames, sum / frames, percentile(0.5), percentile(0.95), percentile(0.99), max, gpuSum / frames, gpuMax);
+		}
+	};
+
+
+private:
+	FILE* file;						// CSV file (NULL = not profiling)
+	double frequency;				// Performance counter ticks per second
+	Uint64 start;					// Frame start
+	Uint64 swapStart;				// Start of the current swap
+	Uint64 swapTicks;				// Time spent in this frame's swaps
+	long frames;					// Frames profiled
+	long written;					// Frames written to the file
+	ProfileFrame slots[PROFILE_GPU_FRAMES];	// Frames waiting for their GPU timestamps
+	double sum;						// Sum of CPU frame times (ms)
+	double max;						// Slowest CPU frame (ms)
+	double gpuSum;					// Sum of GPU frame times (ms)
+	double gpuMax;					// Slowest GPU frame (ms)
+	long counts[PROFILE_BINS];		// CPU frame time histogram
+
+
+	// Write the rows of frames before end, in order. wait = wait for their timestamps, otherwise stop at the first that isn't back
+	void writeFrames(long end, bool wait) {
+		for (; written < end; written++) {
+			ProfileFrame& slot = slots[written % PROFILE_GPU_FRAMES];
+			if (!wait) {
+				GLint available = 0;
+				glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available) {
+					return;
+				}
+			}
+			GLuint64 begin_ns = 0, end_ns = 0;
+			glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &begin_ns);
+			glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &end_ns);
+			double gpu_ms = end_ns > begin_ns ? (end_ns - begin_ns) / 1000000.0 : 0.0;
+			fprintf(file, "%ld,%.4f,%.3f,%.3f\n", written, slot.time, slot.cpuMs, gpu_ms);
+			gpuSum += gpu_ms;
+			gpuMax = gpu_ms > gpuMax ? gpu_ms : gpuMax;
+		}
+	};
+
+
+	// Frame time below which a fraction p of frames fall (ms, to the bin)
+	double percentile(double p) {
+		long target = (long)(p * (frames - 1));
+		long seen = 0;
+		for (int b = 0; b < PROFILE_BINS; b++) {
+			seen += counts[b];
+			if (seen > target) {
+				return (b + 0.5) * PROFILE_BIN_MS;
+			}
+		}
+		return PROFILE_BINS * PROFILE_BIN_MS;
+	};
+};
+
+#endif
@@ -0,0 +1,273 @@
+#pragma once
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+
+const int GLSTATE_TEXTURE_UNITS = 8;			// Texture units tracked (binds on higher units are always issued)
+const unsigned int GLSTATE_UNKNOWN = 0xFFFFFFFF;	// Binding not known (the next call is issued)
+
+// Texture targets tracked per unit
+enum GLState_Target {
+	GLSTATE_TEXTURE_2D,
+	GLSTATE_TEXTURE_BUFFER,
+	GLSTATE_NUM_TARGETS
+};
+
+// Capabilities tracked by enable / disable
+enum GLState_Cap {
+	GLSTATE_DEPTH_TEST,
+	GLSTATE_BLEND,
+	GLSTATE_CULL_FACE,
+	GLSTATE_NUM_CAPS
+};
+
+// Last known state of the context
+struct GLStateCache {
+	unsigned int program;										// Program in use
+	unsigned int vertexArray;									// Bound vertex array
+	unsigned int activeUnit;									// Active texture unit (0 = GL_TEXTURE0)
+	unsigned int textures[GLSTATE_TEXTURE_UNITS][GLSTATE_NUM_TARGETS];	// Bound texture per unit and target
+	unsigned int caps[GLSTATE_NUM_CAPS];						// 1 = enabled, 0 = disabled
+	GLenum blendSrc, blendDst;									// Blend function
+	long issued;												// Calls passed to GL this frame
+	long skipped;												// Calls dropped this frame (state already set)
+};
+
+
+// GL State
+// Cache of the binding and enable state the draw code changes: program, vertex array, active texture unit,
+// textures per unit, depth test / blend / face culling and the blend function. Calls that would set what is
+// already set are dropped. Everything that changes this state (including deletes, which unbind) goes through
+// here, so the cache matches the context. The application draws every view with one context, so one cache
+// is enough. Vertex arrays stay bound after draws: code that binds an element buffer or sets attribute
+// pointers binds its own vertex array first.
+// Calls issued and skipped are counted per frame (beginFrame starts a frame) to keep driver traffic down.
+class GLState {
+public:
+	// Start counting a frame's calls
+	static void beginFrame() {
+		cache().issued = 0;
+		cache().skipped = 0;
+	};
+
+
+	// Calls passed to GL since beginFrame
+	static long issued() {
+		return cache().issued;
+	};
+
+
+	// Calls dropped since beginFrame
+	static long skipped() {
+		return cache().skipped;
+	};
+
+
+	// Forget everything (after GL calls made outside the cache)
+	static void invalidate() {
+		forget(cache());
+	};
+
+
+	// glUseProgram
+	static void useProgram(unsigned int program) {
+		GLStateCache& s = cache();
+		if (s.program == program) {
+			s.skipped++;
+			return;
+		}
+		glUseProgram(program);
+		s.program = program;
+		s.issued++;
+	};
+
+
+	// glBindVertexArray
+	static void bindVertexArray(unsigned int vertex_array) {
+		GLStateCache& s = cache();
+		if (s.vertexArray == vertex_array) {
+			s.skipped++;
+			return;
+		}
+		glBindVertexArray(vertex_array);
+		s.vertexArray = vertex_array;
+		s.issued++;
+	};
+
+
+	// glActiveTexture. unit = 0 for GL_TEXTURE0
+	static void activeTexture(unsigned int unit) {
+		GLStateCache& s = cache();
+		if (s.activeUnit == unit) {
+			s.skipped++;
+			return;
+		}
+		glActiveTexture(GL_TEXTURE0 + unit);
+		s.activeUnit = unit;
+		s.issued++;
+	};
+
+
+	// Bind a texture to a unit (activates the unit only if the binding changes)
+	static void bindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+		GLStateCache& s = cache();
+		int t = targetIndex(target);
+		if (t >= 0 && unit < (unsigned int)GLSTATE_TEXTURE_UNITS && s.textures[unit][t] == texture) {
+			s.skipped++;
+			return;
+		}
+		activeTexture(unit);
+		glBindTexture(target, texture);
+		if (t >= 0 && unit < (unsigned int)GLSTATE_TEXTURE_UNITS) {
+			s.textures[unit][t] = texture;
+		}
+		s.issued++;
+	};
+
+
+	// glEnable
+	static void enable(GLenum cap) {
+		setCap(cap, 1);
+	};
+
+
+	// glDisable
+	static void disable(GLenum cap) {
+		setCap(cap, 0);
+	};
+
+
+	// glBlendFunc
+	static void blendFunc(GLenum src, GLenum dst) {
+		GLStateCache& s = cache();
+		if (s.blendSrc == src && s.blendDst == dst) {
+			s.skipped++;
+			return;
+		}
+		glBlendFunc(src, dst);
+		s.blendSrc = src;
+		s.blendDst = dst;
+		s.issued++;
+	};
+
+
+	// glDeleteTextures for one texture (GL unbinds it from every unit)
+	static void deleteTexture(unsigned int texture) {
+		GLStateCache& s = cache();
+		if (texture == 0) {
+			return;
+		}
+		glDeleteTextures(1, &texture);
+		for (int u = 0; u < GLSTATE_TEXTURE_UNITS; u++) {
+			for (int t = 0; t < GLSTATE_NUM_TARGETS; t++) {
+				if (s.textures[u][t] == texture) {
+					s.textures[u][t] = 0;
+				}
+			}
+		}
+		s.issued++;
+	};
+
+
+	// glDeleteVertexArrays for one vertex array (GL unbinds it)
+	static void deleteVertexArray(unsigned int vertex_array) {
+		GLStateCache& s = cache();
+		if (vertex_array == 0) {
+			return;
+		}
+		glDeleteVertexArrays(1, &vertex_array);
+		if (s.vertexArray == vertex_array) {
+			s.vertexArray = 0;
+		}
+		s.issued++;
+	};
+
+
+	// glDeleteProgram (a program in use stays in use until another is, so the cache is left alone)
+	static void deleteProgram(unsigned int program) {
+		glDeleteProgram(program);
+		cache().issued++;
+	};
+
+
+private:
+	// The cache (starts unknown)
+	static GLStateCache& cache() {
+		static GLStateCache value = unknownState();
+		return value;
+	};
+
+
+	static GLStateCache unknownState() {
+		GLStateCache s;
+		forget(s);
+		s.issued = 0;
+		s.skipped = 0;
+		return s;
+	};
+
+
+	// Mark every binding unknown
+	static void forget(GLStateCache& s) {
+		s.program = GLSTATE_UNKNOWN;
+		s.vertexArray = GLSTATE_UNKNOWN;
+		s.activeUnit = GLSTATE_UNKNOWN;
+		for (int u = 0; u < GLSTATE_TEXTURE_UNITS; u++) {
+			for (int t = 0; t < GLSTATE_NUM_TARGETS; t++) {
+				s.textures[u][t] = GLSTATE_UNKNOWN;
+			}
+		}
+		for (int c = 0; c < GLSTATE_NUM_CAPS; c++) {
+			s.caps[c] = GLSTATE_UNKNOWN;
+		}
+		s.blendSrc = s.blendDst = GLSTATE_UNKNOWN;
+	};
+
+
+	// Cached texture target (-1 = not cached)
+	static int targetIndex(GLenum target) {
+		switch (target) {
+		case GL_TEXTURE_2D:
+			return GLSTATE_TEXTURE_2D;
+		case GL_TEXTURE_BUFFER:
+			return GLSTATE_TEXTURE_BUFFER;
+		default:
+			return -1;
+		}
+	};
+
+
+	// Enable or disable a capability. Capabilities that aren't cached are always passed on
+	static void setCap(GLenum cap, unsigned int value) {
+		GLStateCache& s = cache();
+		int c = -1;
+		switch (cap) {
+		case GL_DEPTH_TEST:
+			c = GLSTATE_DEPTH_TEST;
+			break;
+		case GL_BLEND:
+			c = GLSTATE_BLEND;
+			break;
+		case GL_CULL_FACE:
+			c = GLSTATE_CULL_FACE;
+			break;
+		}
+		if (c >= 0 && s.caps[c] == value) {
+			s.skipped++;
+			return;
+		}
+		if (value) {
+			glEnable(cap);
+		} else {
+			glDisable(cap);
+		}
+		if (c >= 0) {
+			s.caps[c] = value;
+		}
+		s.issued++;
+	};
+};
+
+#endif
@@ -0,0 +1,300 @@
+#pragma once
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <SDL.h>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+const int INPUT_LOG_VERSION = 1;				// Log format version
+const int INPUT_LOG_KEY_BYTES = SDL_NUM_SCANCODES / 8;	// Keyboard state (one bit per scancode)
+const float INPUT_LOG_CAMERA_EPSILON = 1e-4f;	// Camera difference that counts as diverged
+
+// Input log modes
+enum InputLog_Mode {
+	INPUT_LOG_OFF,			// Live input
+	INPUT_LOG_RECORD,		// Live input, written to the log
+	INPUT_LOG_REPLAY		// Input from the log
+};
+
+// Log file header
+struct InputLogHeader {
+	char magic[4];			// "BRIL"
+	int version;			// INPUT_LOG_VERSION
+	int numSensors;			// Floats per sensor frame
+	int eventSize;			// sizeof(SDL_Event) when recorded
+};
+
+// Frame record. Followed by numEvents SDL_Events and numSamples sensor frames
+struct InputLogFrame {
+	float time;								// Frame time (s). The virtual clock on replay
+	int numEvents;							// Events handled
+	int numSamples;							// Sensor frames consumed
+	Uint8 keys[INPUT_LOG_KEY_BYTES];		// Keyboard state read for the camera
+	glm::vec3 cameraPosition;				// Camera after input (checked on replay)
+	float cameraYaw, cameraPitch, cameraFov;
+};
+
+
+// Input Log
+// Records everything a frame consumes that isn't deterministic: the frame time, SDL events, the keyboard
+// state the camera reads and the sensor frames fed to the heatmap and modal analysis. Replay feeds them back
+// with the recorded times as a virtual clock, so the same camera flight and state changes run on any build.
+// The camera is compared each replayed frame to catch replays that no longer match.
+// Buffers keep their capacity between frames, so steady-state frames don't allocate.
+class InputLog {
+public:
+	// Constructor
+	InputLog() {
+		mode = INPUT_LOG_OFF;
+		file = NULL;
+		numSensors = 0;
+		frameCount = 0;
+		nextEvent = 0;
+		nextSample = 0;
+		divergedFrames = 0;
+		firstDiverged = -1;
+		frame = InputLogFrame();
+		memset(keys, 0, sizeof(keys));
+		events.reserve(64);
+	};
+
+	// Destructor
+	~InputLog() {
+		close();
+	};
+
+
+	// Start recording to a file. num_sensors = floats per sensor frame
+	bool record(const char* path, int num_sensors) {
+		file = fopen(path, "wb");
+		if (!file) {
+			printf("Input log: can't create %s\n", path);
+			return false;
+		}
+		InputLogHeader header;
+		memcpy(header.magic, "BRIL", 4);
+		header.version = INPUT_LOG_VERSION;
+		header.numSensors = num_sensors;
+		header.eventSize = (int)sizeof(SDL_Event);
+		fwrite(&header, sizeof(header), 1, file);
+
+		mode = INPUT_LOG_RECORD;
+		numSensors = num_sensors;
+		samples.reserve(num_sensors * 8);
+		return true;
+	};
+
+
+	// Start replaying a file. num_sensors must match the recording
+	bool replay(const char* path, int num_sensors) {
+		file = fopen(path, "rb");
+		if (!file) {
+			printf("Input log: can't open %s\n", path);
+			return false;
+		}
+		InputLogHeader header;
+		if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "BRIL", 4) != 0 || header.version != INPUT_LOG_VERSION
+			|| header.eventSize != (int)sizeof(SDL_Event) || header.numSensors != num_sensors) {
+			printf("Input log: %s isn't a version %d log for %d sensors\n", path, INPUT_LOG_VERSION, num_sensors);
+			fclose(file);
+			file = NULL;
+			return false;
+		}
+
+		mode = INPUT_LOG_REPLAY;
+		numSensors = num_sensors;
+		samples.reserve(num_sensors * 8);
+		return true;
+	};
+
+
+	// Is input coming from the log?
+	bool replaying() {
+		return mode == INPUT_LOG_REPLAY;
+	};
+
+
+	// Start of frame. time = live frame time, replaced by the recorded one on replay.
+	// Returns false when the replay has run out of frames
+	bool beginFrame(float& time) {
+		events.clear();
+		samples.clear();
+		nextEvent = 0;
+		nextSample = 0;
+
+		if (mode == INPUT_LOG_REPLAY) {
+			if (!readFrame()) {
+				printf("Input log: replay finished after %d frames\n", frameCount);
+				return false;
+			}
+			time = frame.time;
+			unpackKeys();
+		} else {
+			frame.time = time;
+		}
+		return true;
+	};
+
+
+	// Next event for this frame (SDL_PollEvent, or the recorded events on replay)
+	bool pollEvent(SDL_Event& event) {
+		if (mode == INPUT_LOG_REPLAY) {
+			// Live events are dropped so they can't change the run
+			SDL_Event live;
+			while (SDL_PollEvent(&live)) {
+			}
+			if (nextEvent >= (int)events.size()) {
+				return false;
+			}
+			event = events[nextEvent++];
+			event.common.timestamp = SDL_GetTicks();	// Latency is timed from when the event is injected
+			return true;
+		}
+
+		if (!SDL_PollEvent(&event)) {
+			return false;
+		}
+		if (mode == INPUT_LOG_RECORD) {
+			events.push_back(event);
+		}
+		return true;
+	};
+
+
+	// Keyboard state for the camera (SDL_GetKeyboardState, or the recorded state on replay)
+	const Uint8* keyboardState() {
+		if (mode == INPUT_LOG_REPLAY) {
+			return keys;
+		}
+		const Uint8* state = SDL_GetKeyboardState(NULL);
+		if (mode == INPUT_LOG_RECORD) {
+			memset(frame.keys, 0, sizeof(frame.keys));
+			for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+				if (state[i]) {
+					frame.keys[i / 8] |= (Uint8)(1 << (i % 8));
+				}
+			}
+		}
+		return state;
+	};
+
+
+	// Sensor frames the replayed frame consumed (replay feeds exactly these, whatever the sensor source was)
+	int recordedSamples() {
+		return mode == INPUT_LOG_REPLAY ? frame.numSamples : 0;
+	};
+
+
+	// A sensor frame is being consumed. Recorded, or replaced by the recorded one on replay
+	void sensorFrame(std::vector<float>& values) {
+		if (mode == INPUT_LOG_RECORD) {
+			samples.insert(samples.end(), values.begin(), values.begin() + numSensors);
+		} else if (mode == INPUT_LOG_REPLAY && (nextSample + 1) * numSensors <= (int)samples.size()) {
+			std::copy(samples.begin() + nextSample * numSensors, samples.begin() + (nextSample + 1) * numSensors, values.begin());
+			nextSample++;
+		}
+	};
+
+
+	// End of frame. Writes the frame, or checks the camera against the recording on replay
+	void endFrame(const Camera& camera) {
+		if (mode == INPUT_LOG_RECORD) {
+			frame.numEvents = (int)events.size();
+			frame.numSamples = (int)samples.size() / numSensors;
+			frame.cameraPosition = camera.Position;
+			frame.cameraYaw = camera.Yaw;
+			frame.cameraPitch = camera.Pitch;
+			frame.cameraFov = camera.Fov;
+			fwrite(&frame, sizeof(frame), 1, file);
+			if (!events.empty()) {
+				fwrite(&events[0], sizeof(SDL_Event), events.size(), file);
+			}
+			if (!samples.empty()) {
+				fwrite(&samples[0], sizeof(float), samples.size(), file);
+			}
+		} else if (mode == INPUT_LOG_REPLAY) {
+			glm::vec3 offset = camera.Position - frame.cameraPosition;
+			float difference = std::max(std::max(std::abs(offset.x), std::abs(offset.y)), std::abs(offset.z));
+			difference = std::max(difference, std::abs(camera.Yaw - frame.cameraYaw));
+			difference = std::max(difference, std::abs(camera.Pitch - frame.cameraPitch));
+			difference = std::max(difference, std::abs(camera.Fov - frame.cameraFov));
+			if (difference > INPUT_LOG_CAMERA_EPSILON) {
+				divergedFrames++;
+				if (firstDiverged < 0) {
+					firstDiverged = frameCount;
+				}
+			}
+		}
+		if (mode != INPUT_LOG_OFF) {
+			frameCount++;
+		}
+	};
+
+
+	// Close the log (and report how well a replay matched)
+	void close() {
+		if (file == NULL) {
+			return;
+		}
+		if (mode == INPUT_LOG_RECORD) {
+			printf("Input log: recorded %d frames\n", frameCount);
+		} else if (mode == INPUT_LOG_REPLAY && divergedFrames > 0) {
+			printf("Input log: camera diverged from the recording in %d frames (first at frame %d)\n", divergedFrames, firstDiverged);
+		}
+		fclose(file);
+		file = NULL;
+		mode = INPUT_LOG_OFF;
+	};
+
+
+private:
+	InputLog_Mode mode;					// Off, recording or replaying
+	FILE* file;							// Log file
+	int numSensors;						// Floats per sensor frame
+	int frameCount;						// Frames recorded or replayed
+	InputLogFrame frame;				// Current frame
+	std::vector<SDL_Event> events;		// Current frame's events
+	std::vector<float> samples;			// Current frame's sensor frames
+	int nextEvent;						// Next event to replay
+	int nextSample;						// Next sensor frame to replay
+	Uint8 keys[SDL_NUM_SCANCODES];		// Replayed keyboard state (SDL_GetKeyboardState layout)
+	int divergedFrames;					// Replayed frames whose camera didn't match
+	int firstDiverged;					// First of them (-1 = none)
+
+
+	// Read the next frame's record, events and sensor frames
+	bool readFrame() {
+		if (fread(&frame, sizeof(frame), 1, file) != 1 || frame.numEvents < 0 || frame.numSamples < 0) {
+			return false;
+		}
+		events.resize(frame.numEvents);
+		samples.resize((size_t)frame.numSamples * numSensors);
+		if (frame.numEvents > 0 && fread(&events[0], sizeof(SDL_Event), events.size(), file) != events.size()) {
+			return false;
+		}
+		if (!samples.empty() && fread(&samples[0], sizeof(float), samples.size(), file) != samples.size()) {
+			return false;
+		}
+		return true;
+	};
+
+
+	// Expand the recorded key bits
+	void unpackKeys() {
+		for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+			keys[i] = (frame.keys[i / 8] >> (i % 8)) & 1;
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef KTX_FORMAT_H
+#define KTX_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+
+// KTX 1.1 container (https://registry.khronos.org/KTX/specs/1.0/ktxspec_v1.html)
+// Header, key / value data, then every mip level as a 32-bit size followed by the level's data (padded to 4 bytes).
+// Shared by the runtime loader (KTXTexture.h) and tools/bake_texture.cpp (which builds without OpenGL).
+
+// File identifier
+const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+const uint32_t KTX_ENDIANNESS = 0x04030201;		// Written in the file's byte order
+
+// GL enums used in the header (numbers, so the baker builds without OpenGL headers)
+const uint32_t KTX_GL_UNSIGNED_BYTE = 0x1401;
+const uint32_t KTX_GL_RGB = 0x1907;
+const uint32_t KTX_GL_RGBA = 0x1908;
+const uint32_t KTX_GL_RGB8 = 0x8051;
+const uint32_t KTX_GL_RGBA8 = 0x8058;
+const uint32_t KTX_GL_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;	// BC1
+const uint32_t KTX_GL_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;	// BC3
+
+// Header
+struct KTXHeader {
+	unsigned char identifier[12];		// KTX_IDENTIFIER
+	uint32_t endianness;				// KTX_ENDIANNESS
+	uint32_t glType;					// Pixel type (0 = compressed)
+	uint32_t glTypeSize;				// Bytes per component (1 for compressed)
+	uint32_t glFormat;					// Pixel format (0 = compressed)
+	uint32_t glInternalFormat;			// Internal format (sized or compressed)
+	uint32_t glBaseInternalFormat;		// Base internal format
+	uint32_t pixelWidth;				// Level 0 width
+	uint32_t pixelHeight;				// Level 0 height
+	uint32_t pixelDepth;				// 0 for 2D textures
+	uint32_t numberOfArrayElements;		// 0 for non-array textures
+	uint32_t numberOfFaces;				// 1 for non-cubemaps
+	uint32_t numberOfMipmapLevels;		// Mip levels stored (0 = generate them)
+	uint32_t bytesOfKeyValueData;		// Bytes of key / value data after the header
+};
+
+// Baked version of an image path (same name with .ktx)
+inline std::string ktxPath(const std::string& path) {
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return path + ".ktx";
+	}
+	return path.substr(0, dot) + ".ktx";
+}
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef KTX_TEXTURE_H
+#define KTX_TEXTURE_H
+
+#include <GL/glew.h>
+
+#include "GLState.h"
+
+#include "KTXFormat.h"
+#include "MappedFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+
+// KTX Texture
+// Loads a baked texture by mapping the file and handing each stored mip level straight to OpenGL.
+// No decoding and no mipmap generation at load time.
+class KTXTexture {
+public:
+	// Load a 2D KTX texture. Returns the texture id, or 0 if the file is missing or can't be used
+	// (the caller falls back to the source image). gpu_bytes = bytes of texture data uploaded.
+	static unsigned int load(const std::string& path, size_t& gpu_bytes) {
+		gpu_bytes = 0;
+		MappedFile file;
+		if (!file.open(path.c_str())) {
+			return 0;
+		}
+		return upload(file.data(), file.size(), path, gpu_bytes);
+	};
+
+
+	// Create a texture from KTX data already in memory (e.g. a file mapped on another thread)
+	// path is only used in error messages
+	static unsigned int upload(const unsigned char* data, size_t size, const std::string& path, size_t& gpu_bytes) {
+		gpu_bytes = 0;
+
+		// Check header
+		if (size < sizeof(KTXHeader)) {
+			printf("KTX file is too small: %s\n", path.c_str());
+			return 0;
+		}
+		KTXHeader header;
+		memcpy(&header, data, sizeof(KTXHeader));
+		if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != KTX_ENDIANNESS) {
+			printf("Not a KTX file (or other byte order): %s\n", path.c_str());
+			return 0;
+		}
+		if (header.pixelDepth > 1 || header.numberOfArrayElements > 0 || header.numberOfFaces != 1) {
+			printf("KTX file is not a 2D texture: %s\n", path.c_str());
+			return 0;
+		}
+		bool compressed = (header.glType == 0);
+		if (compressed && !GLEW_EXT_texture_compression_s3tc) {
+			printf("S3TC not supported, using the source image instead of %s\n", path.c_str());
+			return 0;
+		}
+
+		// Upload every level straight from the mapping
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		GLState::bindTexture(0, GL_TEXTURE_2D, textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);  // KTX rows are padded to 4 bytes
+
+		size_t offset = sizeof(KTXHeader) + header.bytesOfKeyValueData;
+		uint32_t num_levels = header.numberOfMipmapLevels > 0 ? header.numberOfMipmapLevels : 1;
+		for (uint32_t level = 0; level < num_levels; level++) {
+			if (offset + sizeof(uint32_t) > size) {
+				break;
+			}
+			uint32_t image_size;
+			memcpy(&image_size, data + offset, sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+			if (offset + image_size > size) {
+				printf("KTX file is truncated at level %u: %s\n", level, path.c_str());
+				GLState::deleteTexture(textureID);
+				return 0;
+			}
+
+			GLsizei width = header.pixelWidth >> level > 0 ? header.pixelWidth >> level : 1;
+			GLsizei height = header.pixelHeight >> level > 0 ? header.pixelHeight >> level : 1;
+			if (compressed) {
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, header.glInternalFormat, width, height, 0, image_size, data + offset);
+			} else {
+				glTexImage2D(GL_TEXTURE_2D, level, header.glInternalFormat, width, height, 0, header.glFormat, header.glType, data + offset);
+			}
+			gpu_bytes += image_size;
+			offset += (image_size + 3) & ~3u;  // Mip padding
+		}
+
+		// Mip range (or generate if the file didn't store any)
+		if (header.numberOfMipmapLevels == 0) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+		} else {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+		}
+
+		// Set texture wraping / filtering options (same as images loaded with stb_image)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+
+		return textureID;
+	};
+};
+
+#endif
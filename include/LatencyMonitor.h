@@ -0,0 +1,299 @@
+#pragma once
+#ifndef LATENCY_MONITOR_H
+#define LATENCY_MONITOR_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+#include <SDL.h>
+
+#include <stdio.h>
+
+
+const int LATENCY_BINS = 100;			// Histogram bins (1 ms each, the last one holds everything slower)
+const int LATENCY_MAX_FRAMES = 8;		// Frames tracked until their GPU work finishes
+const GLuint64 LATENCY_WAIT_NS = 100000000;	// Longest wait for a frame's fence (a frame that takes longer isn't recorded)
+
+// Measured stages of a frame
+enum Latency_Stage {
+	LATENCY_EVENT_TO_SAMPLE,	// Input event until the frame read input (frames with events only)
+	LATENCY_SAMPLE_TO_SWAP,		// Input read until SDL_GL_SwapWindow returned (CPU frame)
+	LATENCY_SWAP_TO_GPU,		// Swap until the GPU finished the frame
+	LATENCY_SAMPLE_TO_GPU,		// Input read until the GPU finished (camera latency)
+	LATENCY_EVENT_TO_GPU,		// Input event until the GPU finished (frames with events only)
+	LATENCY_NUM_STAGES
+};
+
+const char* const LATENCY_STAGE_NAMES[LATENCY_NUM_STAGES] = {
+	"event -> sample", "sample -> swap", "swap -> GPU done", "sample -> GPU done", "event -> GPU done"
+};
+
+// Histogram of one stage (fixed size, so recording never allocates)
+struct LatencyHistogram {
+	long counts[LATENCY_BINS];		// Frames per 1 ms bin
+	long total;						// Frames recorded
+	double sum;						// Sum of latencies (ms)
+	double max;						// Largest latency (ms)
+};
+
+// Timestamps of one frame (ms, performance counter clock). Negative = didn't happen
+struct LatencyFrame {
+	double event;		// Earliest input event handled by the frame
+	double sample;		// Input read (keyboard state for the camera)
+	double swap;		// SDL_GL_SwapWindow returned
+	GLsync fence;		// Signaled when the GPU has finished the frame (0 = not in flight)
+};
+
+
+// Latency Monitor
+// Timestamps each frame from input to buffer swap, then puts a fence after the swap to find out when the
+// GPU finished it, and keeps per-stage histograms. GPU completion is seen when a later frame polls the fence
+// (or waits on it), so it's accurate to within a frame unless the frame queue is bounded.
+// With max_queued > 0 the CPU waits before starting a frame until at most max_queued earlier frames are
+// still on the GPU, so input isn't read several frames ahead of what's on screen. A frame waited on for
+// longer than LATENCY_WAIT_NS is dropped without being recorded (its GPU time isn't known).
+class LatencyMonitor {
+public:
+	// Constructor. max_queued = frames the GPU may be behind (0 = as many as the driver allows)
+	LatencyMonitor(int max_queued = 0) {
+		maxQueued = max_queued;
+		current = 0;
+		discarded = 0;
+		frequency = (double)SDL_GetPerformanceFrequency();
+		for (int i = 0; i < LATENCY_MAX_FRAMES; i++) {
+			frames[i].fence = 0;
+		}
+		for (int s = 0; s < LATENCY_NUM_STAGES; s++) {
+			LatencyHistogram& histogram = histograms[s];
+			for (int b = 0; b < LATENCY_BINS; b++) {
+				histogram.counts[b] = 0;
+			}
+			histogram.total = 0;
+			histogram.sum = 0.0;
+			histogram.max = 0.0;
+		}
+		resetFrame(frames[current]);
+	};
+
+
+	// Start of frame. Collects finished frames and bounds the frame queue
+	void beginFrame() {
+		poll();
+
+		// Wait for the oldest frames until few enough are queued (the ring can't hold more than its size either)
+		int limit = maxQueued > 0 ? maxQueued : LATENCY_MAX_FRAMES - 1;
+		while (inFlight() > limit) {
+			wait(frames[oldestInFlight()]);
+		}
+	};
+
+
+	// An input event was handled this frame
+	void inputEvent(const SDL_Event& event) {
+		// Event timestamps are SDL_GetTicks ms. Move them to the performance counter clock
+		double time = now() - (double)(SDL_GetTicks() - event.common.timestamp);
+		LatencyFrame& frame = frames[current];
+		if (frame.event < 0.0 || time < frame.event) {
+			frame.event = time;
+		}
+	};
+
+
+	// Input was read for the frame (call right before the state it drives is used)
+	void inputSampled() {
+		frames[current].sample = now();
+	};
+
+
+	// Buffers were swapped. Fences the frame and moves on to the next one
+	void swapped() {
+		LatencyFrame& frame = frames[current];
+		frame.swap = now();
+		if (frame.sample < 0.0) {
+			frame.sample = frame.swap;  // No input read this frame (e.g. a GUI page)
+		}
+		frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		current = (current + 1) % LATENCY_MAX_FRAMES;
+		if (frames[current].fence != 0) {
+			wait(frames[current]);  // Ring full. Shouldn't happen after beginFrame
+		}
+		resetFrame(frames[current]);
+	};
+
+
+	// Median latency of a stage (ms)
+	double median(Latency_Stage stage) {
+		return percentile(histograms[stage], 0.5);
+	};
+
+
+	// Print every stage's percentiles and histogram
+	void print() {
+		printf("Latency (%s frame queue, GPU completion seen within a frame unless bounded)\n", maxQueued > 0 ? "bounded" : "unbounded");
+		if (discarded > 0) {
+			printf("  %ld frames not recorded (GPU took over %d ms)\n", discarded, (int)(LATENCY_WAIT_NS / 1000000));
+		}
+		for (int s = 0; s < LATENCY_NUM_STAGES; s++) {
+			LatencyHistogram& histogram = histograms[s];
+			if (histogram.total == 0) {
+				continue;
+			}
+			printf("  %-20s n %6ld  mean %6.2f  p50 %6.2f  p95 %6.2f  p99 %6.2f  max %6.2f ms\n", LATENCY_STAGE_NAMES[s], histogram.total,
+				histogram.sum / histogram.total, percentile(histogram, 0.5), percentile(histogram, 0.95), percentile(histogram, 0.99), histogram.max);
+
+			// Bars for the non-empty range of bins
+			int first = 0;
+			int last = LATENCY_BINS - 1;
+			long largest = 0;
+			while (histogram.counts[first] == 0) {
+				first++;
+			}
+			while (histogram.counts[last] == 0) {
+				last--;
+			}
+			for (int b = first; b <= last; b++) {
+				largest = histogram.counts[b] > largest ? histogram.counts[b] : largest;
+			}
+			for (int b = first; b <= last; b++) {
+				char bar[41];
+				int length = (int)(histogram.counts[b] * 40 / largest);
+				for (int c = 0; c < 40; c++) {
+					bar[c] = c < length ? '#' : ' ';
+				}
+				bar[40] = '\0';
+				printf("    %3d%s ms |%s| %ld\n", b, b == LATENCY_BINS - 1 ? "+" : " ", bar, histogram.counts[b]);
+			}
+		}
+	};
+
+
+	// Delete fences still in flight
+	void clearFences() {
+		for (int i = 0; i < LATENCY_MAX_FRAMES; i++) {
+			if (frames[i].fence != 0) {
+				glDeleteSync(frames[i].fence);
+				frames[i].fence = 0;
+			}
+		}
+	};
+
+
+private:
+	LatencyFrame frames[LATENCY_MAX_FRAMES];				// Frames in flight (ring)
+	int current;											// Frame being built
+	int maxQueued;											// Frames the GPU may be behind (0 = unbounded)
+	long discarded;											// Frames whose fence wait timed out
+	double frequency;										// Performance counter ticks per second
+	LatencyHistogram histograms[LATENCY_NUM_STAGES];		// Histogram per stage
+
+
+	// Current time (ms)
+	double now() {
+		return SDL_GetPerformanceCounter() * 1000.0 / frequency;
+	};
+
+
+	// Clear a frame's timestamps
+	void resetFrame(LatencyFrame& frame) {
+		frame.event = -1.0;
+		frame.sample = -1.0;
+		frame.swap = -1.0;
+		frame.fence = 0;
+	};
+
+
+	// Record frames whose fences have signaled
+	void poll() {
+		for (int i = 0; i < LATENCY_MAX_FRAMES; i++) {
+			if (frames[i].fence != 0) {
+				GLenum status = glClientWaitSync(frames[i].fence, 0, 0);
+				if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+					finish(frames[i]);
+				}
+			}
+		}
+	};
+
+
+	// Wait for a frame's fence and record it. Frees the fence either way (a wait that times out drops the frame)
+	void wait(LatencyFrame& frame) {
+		GLenum status = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, LATENCY_WAIT_NS);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			finish(frame);
+			return;
+		}
+		glDeleteSync(frame.fence);  // GL_TIMEOUT_EXPIRED or GL_WAIT_FAILED
+		frame.fence = 0;
+		discarded++;
+	};
+
+
+	// Frames still on the GPU
+	int inFlight() {
+		int count = 0;
+		for (int i = 0; i < LATENCY_MAX_FRAMES; i++) {
+			if (frames[i].fence != 0) {
+				count++;
+			}
+		}
+		return count;
+	};
+
+
+	// Oldest frame still on the GPU
+	int oldestInFlight() {
+		int oldest = -1;
+		for (int i = 0; i < LATENCY_MAX_FRAMES; i++) {
+			if (frames[i].fence != 0 && (oldest < 0 || frames[i].swap < frames[oldest].swap)) {
+				oldest = i;
+			}
+		}
+		return oldest;
+	};
+
+
+	// The GPU finished a frame. Record its stages and free its fence
+	void finish(LatencyFrame& frame) {
+		double gpu = now();
+		glDeleteSync(frame.fence);
+		frame.fence = 0;
+
+		add(LATENCY_SAMPLE_TO_SWAP, frame.swap - frame.sample);
+		add(LATENCY_SWAP_TO_GPU, gpu - frame.swap);
+		add(LATENCY_SAMPLE_TO_GPU, gpu - frame.sample);
+		if (frame.event >= 0.0) {
+			add(LATENCY_EVENT_TO_SAMPLE, frame.sample - frame.event);
+			add(LATENCY_EVENT_TO_GPU, gpu - frame.event);
+		}
+	};
+
+
+	// Add a latency to a stage's histogram
+	void add(Latency_Stage stage, double ms) {
+		LatencyHistogram& histogram = histograms[stage];
+		ms = ms > 0.0 ? ms : 0.0;
+		int bin = (int)ms;
+		histogram.counts[bin < LATENCY_BINS ? bin : LATENCY_BINS - 1]++;
+		histogram.total++;
+		histogram.sum += ms;
+		histogram.max = ms > histogram.max ? ms : histogram.max;
+	};
+
+
+	// Latency below which a fraction p of frames fall (ms, to the bin)
+	static double percentile(const LatencyHistogram& histogram, double p) {
+		if (histogram.total == 0) {
+			return 0.0;
+		}
+		long target = (long)(p * (histogram.total - 1));
+		long seen = 0;
+		for (int b = 0; b < LATENCY_BINS; b++) {
+			seen += histogram.counts[b];
+			if (seen > target) {
+				return b + 0.5;  // Bin center
+			}
+		}
+		return LATENCY_BINS;
+	};
+};
+
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+#ifndef LAYOUT_WATCHER_H
+#define LAYOUT_WATCHER_H
+
+#include <SDL.h>
+
+#include "Model.h"
+#include "SensorLayout.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <thread>
+#include <time.h>
+
+
+const int LAYOUT_POLL_MS = 500;		// How often the layout file's modified time is checked (ms)
+const int LAYOUT_SLEEP_MS = 20;		// Longest the watcher sleeps before checking if it should stop (ms)
+
+
+// Layout Watcher
+// Watches a model's sensor layout file from a background thread. When the file changes it is parsed and
+// checked, and the interpolation of the vertices it affects is recomputed on the same thread. The render
+// thread swaps the result in with apply(), which uploads only the changed vertices, all in one frame.
+// Until then the model keeps drawing and picking with the old layout.
+class LayoutWatcher {
+public:
+	// Constructor
+	LayoutWatcher() {
+		model = NULL;
+		lastModified = 0;
+		lastSize = 0;
+		running = false;
+		ready = false;
+	};
+
+	// Destructor
+	~LayoutWatcher() {
+		stop();
+	};
+
+
+	// Start watching a layout file for a model (the model must be loaded)
+	void start(const char* path_p, Model* model_p) {
+		stop();
+		path = path_p;
+		model = model_p;
+		fileInfo(lastModified, lastSize);
+		running = true;
+		watcher = std::thread(&LayoutWatcher::run, this);
+	};
+
+
+	// Swap in a finished layout (render thread, once per frame). Returns true if the layout changed
+	bool apply() {
+		if (!ready.load(std::memory_order_acquire)) {
+			return false;
+		}
+		Uint64 start = SDL_GetPerformanceCounter();
+		model->applyLayout(update);
+		double apply_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+		printf("Sensor layout: %d sensors, %ld vertices re-interpolated, %ld changed in %d buffers (swapped in %.2f ms)\n",
+			update.layout.numSensors(), update.recomputed, update.changed, (int)update.streams.size(), apply_ms);
+		update.streams.clear();
+		ready.store(false, std::memory_order_release);  // The watcher may build the next one
+		return true;
+	};
+
+
+	// Stop watching
+	void stop() {
+		if (running) {
+			running = false;
+			watcher.join();
+		}
+	};
+
+
+private:
+	std::string path;				// Layout file
+	Model* model;					// Model the layout belongs to
+	time_t lastModified;			// Modified time of the file when last read
+	long long lastSize;				// Size of the file when last read (catches saves within the same second)
+	std::thread watcher;			// Watcher thread
+	std::atomic<bool> running;		// Is the watcher running?
+	std::atomic<bool> ready;		// Is update waiting to be applied? (the watcher only touches update while this is false)
+	LayoutUpdate update;			// Layout and interpolation built by the watcher
+
+
+	// Watcher loop
+	void run() {
+		int waited = 0;
+		while (running) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(LAYOUT_SLEEP_MS));
+			waited += LAYOUT_SLEEP_MS;
+			if (waited < LAYOUT_POLL_MS || ready.load(std::memory_order_acquire)) {
+				continue;
+			}
+			waited = 0;
+
+			// Changed since it was last read?
+			time_t modified;
+			long long size;
+			fileInfo(modified, size);
+			if (modified == lastModified && size == lastSize) {
+				continue;
+			}
+			lastModified = modified;
+			lastSize = size;
+			reload();
+		}
+	};
+
+
+	// Read the layout file and work out the interpolation it changes
+	void reload() {
+		SensorLayout next;
+		if (!next.load(path.c_str())) {
+			return;  // Keep the current layout (load printed why)
+		}
+		if (next.channels() > model->numSensors()) {
+			printf("Sensor layout: %s uses channel %d, but the sensor data has %d channels (restart to add channels)\n",
+				path.c_str(), next.channels() - 1, model->numSensors());
+			return;
+		}
+		if (!model->reinterpolate(next, update)) {
+			printf("Sensor layout: the model's meshes don't keep their positions, so %s can't be applied (restart to apply)\n", path.c_str());
+			return;
+		}
+		ready.store(true, std::memory_order_release);
+	};
+
+
+	// Modified time and size of the layout file (0 if it can't be read)
+	void fileInfo(time_t& modified, long long& size) {
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			modified = 0;
+			size = 0;
+			return;
+		}
+		modified = info.st_mtime;
+		size = (long long)info.st_size;
+	};
+};
+
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+#ifndef LINE_CHART_H
+#define LINE_CHART_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+#include <algorithm>
+#include <vector>
+
+
+// Line Chart
+// Scrolling traces (one per channel) for a State to show, newest row at the right edge. Rows go into a ring
+// stored in a texture buffer object. upload() sends only the rows added since the last one (one
+// glBufferSubData, two when they wrap around the end of the ring), once per frame before any view draws it. The GUI vertex shader finds each vertex's
+// row in the ring and scales it into the chart, so every trace is drawn as a line strip by one instanced draw.
+class LineChart {
+public:
+	// Constructor. num_traces = values per row. capacity_p = rows shown
+	// pos, scale = placement like a GUI texture (center and half size, normalized coordinates)
+	// min_value, max_value = values at the bottom and top of a trace. lanes_p = each trace in its own lane (or overlaid)
+	LineChart(int num_traces, int capacity_p, glm::vec2 pos, glm::vec2 scale, float min_value, float max_value, bool lanes_p = true) {
+		numTraces = num_traces;
+		capacity = std::max(capacity_p, 2);
+		rect = glm::vec4(pos.x - scale.x, pos.y - scale.y, 2.0f * scale.x, 2.0f * scale.y);
+		range = glm::vec2(min_value, max_value);
+		lanes = lanes_p;
+		values.assign((size_t)capacity * numTraces, 0.0f);
+		head = 0;
+		count = 0;
+		dirty = 0;
+		setupBuffer();
+	};
+
+
+	// Add a row (the oldest scrolls off once the chart is full)
+	void push(const std::vector<float>& row) {
+		std::copy(row.begin(), row.begin() + std::min((int)row.size(), numTraces), values.begin() + (size_t)head * numTraces);
+		head = (head + 1) % capacity;
+		count = std::min(count + 1, capacity);
+		dirty = std::min(dirty + 1, capacity);
+	};
+
+
+	// Upload the rows added since the last upload (once per frame, before the views are drawn)
+	void upload() {
+		if (dirty == 0) {
+			return;
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, VBO);  // Bind buffer
+		int first = (head - dirty + capacity) % capacity;
+		if (dirty == capacity) {
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, values.size() * sizeof(float), &values[0]);	// Whole ring
+		} else if (first + dirty <= capacity) {
+			uploadRows(first, dirty);
+		} else {
+			uploadRows(first, capacity - first);		// To the end of the ring
+			uploadRows(0, first + dirty - capacity);	// Wrapped part
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);  // Unbind buffer
+		dirty = 0;
+	};
+
+
+	// Draw every trace (called by the render queue, gui shader in use). Rows are uploaded by upload()
+	void draw(Shader& shader) {
+		if (count < 2) {
+			return;
+		}
+
+		// Ring on texture unit 1 (unit 0 is the GUI textures, chartValues is set to 1 when the shader is compiled)
+		GLState::bindTexture(1, GL_TEXTURE_BUFFER, textureID);
+
+		shader.setInt("guiMode", 2);
+		shader.setVec4("chartRect", rect);
+		shader.setVec2("chartRange", range);
+		shader.setInt("chartCapacity", capacity);
+		shader.setInt("chartHead", head);
+		shader.setInt("chartCount", count);
+		shader.setInt("chartTraces", numTraces);
+		shader.setInt("chartLanes", lanes ? 1 : 0);
+
+		// Vertex = row, instance = trace (no vertex attributes, the shader reads the ring)
+		GLState::bindVertexArray(VAO);
+		glDrawArraysInstanced(GL_LINE_STRIP, 0, count, numTraces);
+
+		shader.setInt("guiMode", 0);
+	};
+
+
+	// Drop every row
+	void clearRows() {
+		head = 0;
+		count = 0;
+		dirty = 0;
+	};
+
+
+	// Delete buffers
+	void clearChart() {
+		GLState::deleteTexture(textureID);
+		glDeleteBuffers(1, &VBO);
+		GLState::deleteVertexArray(VAO);
+		values.clear();
+		count = 0;
+	};
+
+
+private:
+	int numTraces;					// Values per row
+	int capacity;					// Rows in the ring
+	glm::vec4 rect;					// x, y = bottom left, width, height (normalized coordinates)
+	glm::vec2 range;				// Values at the bottom and top of a trace
+	bool lanes;						// Each trace in its own lane?
+	std::vector<float> values;		// CPU copy of the ring. [row][trace]
+	int head;						// Ring slot the next row goes in
+	int count;						// Rows held
+	int dirty;						// Rows added since the last upload
+	unsigned int VAO;				// Empty vertex array (core profile needs one bound to draw)
+	unsigned int VBO;				// Buffer holding the ring
+	unsigned int textureID;			// Buffer texture viewing VBO
+
+
+	// Upload rows [first, first + rows) of the ring (buffer bound)
+	void uploadRows(int first, int rows) {
+		size_t offset = (size_t)first * numTraces;
+		glBufferSubData(GL_TEXTURE_BUFFER, offset * sizeof(float), (size_t)rows * numTraces * sizeof(float), &values[offset]);
+	};
+
+
+	// Set up buffer, buffer texture and vertex array
+	void setupBuffer() {
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_TEXTURE_BUFFER, VBO);
+		glBufferData(GL_TEXTURE_BUFFER, values.size() * sizeof(float), &values[0], GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glGenTextures(1, &textureID);
+		GLState::bindTexture(0, GL_TEXTURE_BUFFER, textureID);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, VBO);
+		GLState::bindTexture(0, GL_TEXTURE_BUFFER, 0);
+
+		glGenVertexArrays(1, &VAO);
+	};
+};
+
+#endif
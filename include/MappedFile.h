@@ -0,0 +1,139 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Mapped File
+// Read-only memory mapping of a whole file (mmap on POSIX, file mapping on Windows). Pages are read
+// by the OS on first touch, so nothing is copied into a heap buffer first.
+class MappedFile {
+public:
+	// Constructor
+	MappedFile() {
+		ptr = NULL;
+		length = 0;
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#endif
+	};
+
+	// Destructor
+	~MappedFile() {
+		close();
+	};
+
+
+	// Map a file. Returns false if it doesn't exist or can't be mapped.
+	bool open(const char* path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			close();
+			return false;
+		}
+		ptr = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (ptr == NULL) {
+			close();
+			return false;
+		}
+		length = (size_t)file_size.QuadPart;
+#else
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);  // The mapping stays valid after the descriptor is closed
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		ptr = (const unsigned char*)view;
+		length = (size_t)st.st_size;
+#endif
+		return true;
+	};
+
+
+	// Unmap the file
+	void close() {
+#ifdef _WIN32
+		if (ptr != NULL) {
+			UnmapViewOfFile(ptr);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (ptr != NULL) {
+			munmap((void*)ptr, length);
+		}
+#endif
+		ptr = NULL;
+		length = 0;
+	};
+
+
+	// File contents
+	const unsigned char* data() {
+		return ptr;
+	};
+
+	// File size in bytes
+	size_t size() {
+		return length;
+	};
+
+
+private:
+	const unsigned char* ptr;		// Start of the mapping
+	size_t length;					// Size of the mapping
+#ifdef _WIN32
+	HANDLE file;					// File handle
+	HANDLE mapping;					// File mapping handle
+#endif
+
+	// No copies (the mapping would be unmapped twice)
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -7,9 +7,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Bounds.h"
+#include "GLState.h"
+#include "RenderQueue.h"
 #include "Shader.h"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #define MAX_BONE_INFLUENCE 4
@@ -21,7 +26,12 @@ struct Vertex {
 	glm::vec2 TexCoords;	// Texture coordinates
 	glm::vec3 DiffuseColor; // Diffuse colors
 	glm::vec3 originalPosition;		// Original Position
-	glm::vec4 interp_data;  // Data needed for interpolation. 0, 1 = indices of nearest sensors. 2, 3 = percent contribution from nearest sensors
+};
+
+// Sensor interpolation of a vertex (its own buffer, so a sensor layout change only re-uploads this)
+struct VertexInterp {
+	glm::ivec2 index;		// Indices of the two nearest sensors (-1 = no sensor)
+	glm::vec2 weight;		// Percent contribution from the two nearest sensors
 };
 
 // Texture
@@ -32,144 +42,255 @@ struct Texture {
 };
 
 
+// What a mesh keeps in RAM once its buffers are on the GPU
+enum Mesh_Residency {
+	MESH_KEEP_ALL,			// Keep vertices and indices
+	MESH_KEEP_POSITIONS,	// Keep only positions and indices (enough for picking and re-interpolating sensors)
+	MESH_RELEASE			// Keep nothing
+};
+
+
+// Mesh level of detail (each level has its own buffers)
+struct MeshLOD {
+	unsigned int VAO, VBO, EBO;		// Vertex attribute array, vertex buffer, element indices buffer
+	unsigned int interpVBO;			// Sensor interpolation buffer (attributes 4 and 5)
+	unsigned int numVertices;		// Number of vertices
+	unsigned int numIndices;		// Number of indices
+	GLenum indexType;				// GL_UNSIGNED_SHORT when every index fits in 16 bits, else GL_UNSIGNED_INT
+	float error;					// Geometric error compared to the full mesh (world units)
+	unsigned int instanceBase;		// First instance in the instance buffer the vertex array's instance attributes read
+};
+
+
+// Level of detail waiting for upload (built on a worker thread)
+struct PendingLOD {
+	std::vector<Vertex> vertices;		// Vertices
+	std::vector<unsigned int> indices;	// Indices
+	float error;						// Geometric error compared to the full mesh (world units)
+};
+
+
 // Mesh Class
+// Built on any thread, then upload() creates its buffers on the GL thread
 class Mesh {
 public:
 	// Mesh Data
 	std::vector<Vertex> vertices;		// Vertices vector
 	std::vector<unsigned int> indices;	// Indices vector
 	std::vector<Texture> textures;		// Textures vector
+	std::vector<glm::vec3> positions;	// Vertex positions (only filled when released with MESH_KEEP_POSITIONS)
+	std::vector<MeshLOD> lods;			// Levels of detail. 0 = full mesh (empty until upload)
+	std::vector<PendingLOD> pendingLODs;	// Simplified levels waiting for upload
+	std::vector<std::vector<VertexInterp> > interp;		// Sensor interpolation of each level (filled before upload, kept unless released)
+	std::vector<std::vector<glm::vec3> > lodPositions;	// Vertex positions of levels 1 and up (kept unless released)
+	AABB bounds;						// Bounding box
+	BVH triangleBVH;					// Bounding volume hierarchy over the full detail triangles (for picking)
+	glm::vec3 center;					// Bounding sphere center
+	float radius;						// Bounding sphere radius
+
+	// Empty Mesh (filled in by assignment)
+	Mesh() {
+		center = glm::vec3(0.0f);
+		radius = 0.0f;
+	};
 
-	// Mesh Constructor
+	// Mesh Constructor (no GL calls, buffers are created by upload)
+	// Pass the vectors with std::move to hand them over without copying
 	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures) {
-		this->vertices = vertices;	// Set vertices
-		this->indices = indices;	// Set indices
-		this->textures = textures;	// Set textures
-		setupMesh();				// Set up mesh
-	};
-
-	// Draw
-	void Draw(Shader& shader, std::vector<float> data, int update_bool) {
-
-		if (update_bool) {
-			updateMesh(data);
-		}
-		//printf("after update mesh \n");
-
-		unsigned int diffuseNr = 1;		// Diffuse texture number
-		unsigned int specularNr = 1;	// Specular texture number
-
-		// Bind vertex array
-		glBindVertexArray(VAO);		// Bind vertex attrib array
-
-		// Loop through each texture
-		/*
-		for (unsigned int i = 0; i < textures.size(); i++) {
-			printf("here\n");
-			glActiveTexture(GL_TEXTURE0 + i);	// Activate proper texture unit before binding
-
-			// Put texture name together
-			std::string number;		// Texture number (the N in diffuse_textureN)
-			std::string name = textures[i].type;	// Texture type
-			//printf("texture name: %s\n", name.c_str());
-			// Diffuse texture
-			if (name == "texture_diffuse") {
-				number = std::to_string(diffuseNr++);  // Convert number to string, then increment number
-			// Specular texture
-			} else if (name == "texture_specular") {
-				number = std::to_string(specularNr++); // Convert number to string, then increment
-			}
-
-			shader.setInt((name + number).c_str(), i); // Set shader float uniform for texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
-		}//End for loop
-		*/
+		this->vertices = std::move(vertices);	// Set vertices
+		this->indices = std::move(indices);		// Set indices
+		this->textures = std::move(textures);	// Set textures
+		calcBounds();				// Find bounding box and sphere
+	};
 
-		// Draw Mesh
-		glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);  // Draw elements
 
-		glBindVertexArray(0);		// Unbind vertex attrib array
+	// Add a simplified level of detail (coarser than the last one added). Vectors are moved in
+	void addLOD(std::vector<Vertex>& lod_vertices, std::vector<unsigned int>& lod_indices, float error) {
+		// Simplified vertices can move slightly outside the full mesh
+		for (unsigned int i = 0; i < lod_vertices.size(); i++) {
+			bounds.expand(lod_vertices[i].Position);
+		}
 
-		glActiveTexture(GL_TEXTURE0);  // Reset active texture
+		PendingLOD lod;
+		lod.vertices = std::move(lod_vertices);
+		lod.indices = std::move(lod_indices);
+		lod.error = error;
+		pendingLODs.push_back(std::move(lod));
 	};
 
 
-	// Update Mesh vertices
-	// data = vector of floats for sensor values
-	void updateMesh(std::vector<float> data) {
-		// Find max and min data values
-		float max_value = 1;		// Max value
-		float min_value = -1;	// Min value
-		/*for (int i = 0; i < data.size(); i++) {
-			if (data.at(i) > max_value) {
-				max_value = data.at(i);
-			}
-			if (data.at(i) < min_value) {
-				min_value = data.at(i);
+	// Create buffers for every level of detail (GL thread), then drop CPU copies the app no longer needs
+	void upload(Mesh_Residency residency) {
+		setupMesh();
+		for (unsigned int i = 0; i < pendingLODs.size(); i++) {
+			lods.push_back(setupLOD(pendingLODs[i].vertices, pendingLODs[i].indices, pendingLODs[i].error));
+
+			// Keep positions for re-interpolating sensors
+			if (residency != MESH_RELEASE) {
+				std::vector<glm::vec3> lod_positions(pendingLODs[i].vertices.size());
+				for (unsigned int j = 0; j < lod_positions.size(); j++) {
+					lod_positions[j] = pendingLODs[i].vertices[j].Position;
+				}
+				lodPositions.push_back(std::move(lod_positions));
 			}
-		}*/
-
-		// Go through each vertex and update its position and color
-		for (int i = 0; i < vertices.size(); i++) {
-			Vertex temp_vertex = vertices.at(i);  // Get current vertex
-
-			// Find new displacement
-			float blending1 = temp_vertex.interp_data.z;	// Blending for sensor 1
-			float blending2 = temp_vertex.interp_data.w;	// Blending for sesnor 2
-
-			//for (int i = 0; i < data.size(); i++) {
-			//	printf("data: %f\n", data.at(i));
-			//}
-
-			//printf("interp_data x: %f, %f, %f, %f\n", temp_vertex.interp_data.x, temp_vertex.interp_data.y, temp_vertex.interp_data.z, temp_vertex.interp_data.w);
-			
-			float data1;
-			if (temp_vertex.interp_data.x == -1) {
-				data1 = 0;
-			}else {
-				data1 = data.at(temp_vertex.interp_data.x);  // Data for closest sensor 1
+		}
+		std::vector<PendingLOD>().swap(pendingLODs);
+		releaseCPUData(residency);
+	};
+
+
+	// Pick the coarsest LOD whose error projects to at most max_pixel_error pixels
+	// pixels_per_unit = pixels covered by one world unit at distance 1 (viewport height / (2 tan(fov / 2)))
+	int selectLOD(glm::vec3 camera_pos, float pixels_per_unit, float max_pixel_error) {
+		float distance = std::max(glm::length(center - camera_pos) - radius, 0.001f);  // Distance to the nearest part of the mesh
+		for (int i = (int)lods.size() - 1; i > 0; i--) {
+			if (lods[i].error * pixels_per_unit / distance <= max_pixel_error) {
+				return i;
 			}
-			
-			float data2;
-			if (temp_vertex.interp_data.y == -1) {
-				data2 = 0;
+		}
+		return 0;
+	};
+
+
+	// Index the triangles for picking (any thread)
+	void buildTriangleBVH() {
+		std::vector<AABB> triangle_bounds(indices.size() / 3);
+		for (unsigned int i = 0; i < triangle_bounds.size(); i++) {
+			triangle_bounds[i].expand(vertices[indices[i * 3]].Position);
+			triangle_bounds[i].expand(vertices[indices[i * 3 + 1]].Position);
+			triangle_bounds[i].expand(vertices[indices[i * 3 + 2]].Position);
+		}
+		triangleBVH.build(triangle_bounds, 4);
+	};
+
+
+	// Closest full detail triangle hit by a ray (object space). Needs positions and indices (MESH_KEEP_POSITIONS or MESH_KEEP_ALL).
+	// t = farthest distance to look (in), distance to the hit (out). Returns the triangle hit (-1 = none)
+	int raycast(const Ray& ray, float& t) {
+		if (indices.empty()) {
+			return -1;
+		}
+		return triangleBVH.raycast(ray, t, [&](int triangle, float& closest) {
+			float distance;
+			if (rayTriangle(ray, position(indices[triangle * 3]), position(indices[triangle * 3 + 1]), position(indices[triangle * 3 + 2]), distance)
+				&& distance < closest) {
+				closest = distance;
+				return true;
 			}
-			else {
-				data2 = data.at(temp_vertex.interp_data.y);  // Data for closest sensor 2
+			return false;
+		});
+	};
+
+
+	// Position of a vertex (from whichever copy is kept)
+	const glm::vec3& position(unsigned int index) {
+		return positions.empty() ? vertices[index].Position : positions[index];
+	};
+
+
+	// Position of a vertex of a level of detail (needs positions kept)
+	const glm::vec3& position(int lod, unsigned int index) {
+		return lod == 0 ? position(index) : lodPositions[lod - 1][index];
+	};
+
+
+	// Can sensor interpolation be recomputed (positions and interpolation kept)?
+	bool canReinterpolate() {
+		return !interp.empty() && lodPositions.size() + 1 == lods.size();
+	};
+
+
+	// Replace a level's sensor interpolation (GL thread). stream is swapped in. Only vertices first to last are uploaded
+	void updateInterp(int lod, std::vector<VertexInterp>& stream, unsigned int first, unsigned int last) {
+		interp[lod].swap(stream);
+		glBindBuffer(GL_ARRAY_BUFFER, lods[lod].interpVBO);
+		glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(VertexInterp), (last - first + 1) * sizeof(VertexInterp), &interp[lod][first]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	};
+
+
+	// Attach a per-instance buffer to every level's vertex array
+	// Model matrix goes to attributes 6 to 9 (one column each) and the sensor offset to attribute 10
+	void setInstanceBuffer(unsigned int instance_vbo, unsigned int stride, unsigned int offset_offset) {
+		instanceVBO = instance_vbo;
+		instanceStride = stride;
+		instanceOffsetOffset = offset_offset;
+		for (unsigned int i = 0; i < lods.size(); i++) {
+			GLState::bindVertexArray(lods[i].VAO);		// Bind vertex attrib array
+			for (int a = 6; a <= 10; a++) {
+				glEnableVertexAttribArray(a);  // Enable model matrix column and sensor offset attributes
+				glVertexAttribDivisor(a, 1);  // Advance once per instance
 			}
+			pointInstances(0);
+			lods[i].instanceBase = 0;
+			GLState::bindVertexArray(0);  // Unbind vertex attrib array
+		}
+	};
+
+
+	// Record a draw in the queue (the model pass)
+	// Sensor values are read by the shader from the sensor buffer texture, so nothing is uploaded here
+	// lod = level of detail to draw. first_instance, num_instances = the instances to draw in the instance buffer
+	// (GL 3.3 has no base instance, so the level's instance attributes are pointed at the first one. Each level
+	// is drawn at most once per queue submission, so this holds until the draw is submitted). depth = distance from the camera
+	void addDraw(RenderQueue& queue, Shader& shader, int lod, unsigned int first_instance, int num_instances, float depth) {
+		if (lods[lod].instanceBase != first_instance) {
+			GLState::bindVertexArray(lods[lod].VAO);
+			pointInstances(first_instance);
+			lods[lod].instanceBase = first_instance;
+		}
+		queue.addElements(RENDER_PASS_MODEL, shader, lods[lod].VAO, lods[lod].indexType, (int)lods[lod].numIndices, num_instances, depth);
+	};
+
+
+	// Drop CPU copies that are already on the GPU (vertices and indices are unusable after this unless kept)
+	void releaseCPUData(Mesh_Residency residency) {
+		if (residency == MESH_KEEP_ALL) {
+			return;
+		}
 
-			float delta_displ = blending1 * data1 + blending2 * data2;	// Change in displacement
-			//printf("delta_displ: %f\n", delta_displ);
-			//temp_vertex.Position.y = temp_vertex.originalPosition.y + delta_displ;		// Add in change in displacement
-
-			// Find new color (max = red (0). min = blue(240/360))
-			float hue = (1 - delta_displ / (max_value - min_value)) * 240;  // New hue
-			float C = 1;		// C = V * S = 1 * 1
-			float X = C * (1 - abs(((int)(hue / 60)) % 2 - 1.0f));
-			float m = 1 - C;	// m = V - C = 1 - C
-
-			glm::vec3 new_diff_color;
-			if (hue < 60) {
-				new_diff_color = glm::vec3(C, X, 0);
-			} else if (hue < 120) {
-				new_diff_color = glm::vec3(X, C, 0);
-			} else if (hue < 180) {
-				new_diff_color = glm::vec3(0, C, X);
-			} else {
-				new_diff_color = glm::vec3(0, X, C);
+		// Keep positions for picking and sensor re-interpolation
+		if (residency == MESH_KEEP_POSITIONS) {
+			positions.resize(vertices.size());
+			for (unsigned int i = 0; i < vertices.size(); i++) {
+				positions[i] = vertices[i].Position;
 			}
+		} else {
+			std::vector<unsigned int>().swap(indices);  // Swap with empty to free the memory (clear keeps capacity)
+			triangleBVH = BVH();	// Can't pick without positions
+			std::vector<std::vector<VertexInterp> >().swap(interp);  // Can't re-interpolate either
+		}
+		std::vector<Vertex>().swap(vertices);
+	};
 
-			temp_vertex.DiffuseColor = new_diff_color;
 
-			vertices.erase(vertices.begin() + i);
-			vertices.insert(vertices.begin() + i, temp_vertex);
+	// Bytes held in RAM by the mesh's vectors
+	size_t cpuBytes() {
+		size_t bytes = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int)
+			+ positions.capacity() * sizeof(glm::vec3) + textures.capacity() * sizeof(Texture) + triangleBVH.bytes();
+		for (unsigned int i = 0; i < interp.size(); i++) {
+			bytes += interp[i].capacity() * sizeof(VertexInterp);
 		}
+		for (unsigned int i = 0; i < lodPositions.size(); i++) {
+			bytes += lodPositions[i].capacity() * sizeof(glm::vec3);
+		}
+		return bytes;
+	};
+
 
-		// Update vertex arrays
-		glBindVertexArray(VAO);		// Bind vertex attrib array
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);  // Bind vertex buffer
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_DYNAMIC_DRAW);  // Buffer data
-		glBindVertexArray(0);		// Unbind vertex attrib array
+	// Bytes held in GPU buffers by every level of detail
+	size_t gpuBytes() {
+		size_t bytes = 0;
+		for (unsigned int i = 0; i < lods.size(); i++) {
+			bytes += lods[i].numVertices * (sizeof(Vertex) + sizeof(VertexInterp)) + lods[i].numIndices * indexSize(lods[i].indexType);
+		}
+		return bytes;
+	};
+
+
+	// Bytes per index of an index type
+	static size_t indexSize(GLenum index_type) {
+		return index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
 	};
 
 
@@ -179,32 +300,100 @@ public:
 		vertices.clear();
 		indices.clear();
 		textures.clear();
+		positions.clear();
+		pendingLODs.clear();
+		interp.clear();
+		lodPositions.clear();
+		triangleBVH = BVH();
+
+		// Delete buffers of every level of detail
+		for (unsigned int i = 0; i < lods.size(); i++) {
+			GLState::deleteVertexArray(lods[i].VAO);
+			glDeleteBuffers(1, &lods[i].VBO);
+			glDeleteBuffers(1, &lods[i].EBO);
+			glDeleteBuffers(1, &lods[i].interpVBO);
+		}
+		lods.clear();
 	};
 
 
 
 private:
-	// Render data
-	unsigned int VAO, VBO, EBO;  // Vertex attribute array, vertex buffer, element indices buffer
+	unsigned int instanceVBO = 0;			// Instance buffer (shared by the model's meshes)
+	unsigned int instanceStride = 0;		// Bytes per instance
+	unsigned int instanceOffsetOffset = 0;	// Offset of the sensor offset in an instance
+
 
-	// Set up Mesh
+	// Point the bound vertex array's instance attributes at an instance of the instance buffer
+	void pointInstances(unsigned int first_instance) {
+		size_t base = (size_t)first_instance * instanceStride;
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);  // Bind instance buffer
+
+		// Instance Model Matrix
+		for (int c = 0; c < 4; c++) {
+			glVertexAttribPointer(6 + c, 4, GL_FLOAT, GL_FALSE, instanceStride, (void*)(base + sizeof(glm::vec4) * c));  // Set up attribute pointer
+		}
+
+		// Instance Sensor Offset
+		glVertexAttribIPointer(10, 1, GL_INT, instanceStride, (void*)(base + instanceOffsetOffset));  // Set up attribute pointer
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	};
+
+
+	// Set up Mesh (level of detail 0)
 	void setupMesh() {
-		// Generate buffers and arrays
-		glGenVertexArrays(1, &VAO);		// Generate vertex attrib arrays
-		glGenBuffers(1, &VBO);			// Generate vertex buffer
-		glGenBuffers(1, &EBO);			// Generate element buffer
+		lods.push_back(setupLOD(vertices, indices, 0.0f));
+	};
 
-		//printf("mesh vao: %d\n", VAO);
 
-		// Bind arrays and buffers and populate them with data
-		glBindVertexArray(VAO);		// Bind vertex attrib array
+	// Find bounding box and sphere (center of the bounding box and the farthest vertex from it)
+	void calcBounds() {
+		bounds = AABB();
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			bounds.expand(vertices[i].Position);
+		}
+		center = vertices.empty() ? glm::vec3(0.0f) : bounds.center();
+		radius = 0.0f;
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			radius = std::max(radius, glm::length(vertices[i].Position - center));
+		}
+	};
+
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);  // Bind vertex buffer
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_DYNAMIC_DRAW);  // Buffer data
+	// Set up buffers for one level of detail
+	MeshLOD setupLOD(std::vector<Vertex>& lod_vertices, std::vector<unsigned int>& lod_indices, float error) {
+		MeshLOD lod;
+		lod.numVertices = (unsigned int)lod_vertices.size();
+		lod.numIndices = (unsigned int)lod_indices.size();
+		lod.error = error;
+		lod.instanceBase = 0;
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);  // Bind element buffer
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-			&indices[0], GL_STATIC_DRAW);
+		// Generate buffers and arrays
+		glGenVertexArrays(1, &lod.VAO);		// Generate vertex attrib arrays
+		glGenBuffers(1, &lod.VBO);			// Generate vertex buffer
+		glGenBuffers(1, &lod.EBO);			// Generate element buffer
+		glGenBuffers(1, &lod.interpVBO);	// Generate sensor interpolation buffer
+
+		//printf("mesh vao: %d\n", lod.VAO);
+
+		// Bind arrays and buffers and populate them with data
+		GLState::bindVertexArray(lod.VAO);		// Bind vertex attrib array
+
+		glBindBuffer(GL_ARRAY_BUFFER, lod.VBO);  // Bind vertex buffer
+		glBufferData(GL_ARRAY_BUFFER, lod_vertices.size() * sizeof(Vertex), &lod_vertices[0], GL_STATIC_DRAW);  // Buffer data
+
+		// Element indices. 16 bit when every vertex can be reached with them (half the index bandwidth)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.EBO);  // Bind element buffer
+		if (lod_vertices.size() < 65536) {
+			std::vector<unsigned short> short_indices(lod_indices.begin(), lod_indices.end());
+			lod.indexType = GL_UNSIGNED_SHORT;
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(unsigned short),
+				&short_indices[0], GL_STATIC_DRAW);
+		} else {
+			lod.indexType = GL_UNSIGNED_INT;
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, lod_indices.size() * sizeof(unsigned int),
+				&lod_indices[0], GL_STATIC_DRAW);
+		}
 
 		// Vertex Positions
 		glEnableVertexAttribArray(0);  // Enable vertex positions attribute
@@ -222,8 +411,30 @@ private:
 		glEnableVertexAttribArray(3);  // Enable vertex texture coords attribute
 		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, DiffuseColor));  // Set up attribute pointer
 
+		// Sensor interpolation, in its own buffer (replaced when the sensor layout changes). No sensors if it wasn't filled
+		size_t level = lods.size();
+		if (interp.size() <= level) {
+			interp.resize(level + 1);
+		}
+		if (interp[level].size() != lod_vertices.size()) {
+			VertexInterp none = { glm::ivec2(-1, -1), glm::vec2(0.0f) };
+			interp[level].assign(lod_vertices.size(), none);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, lod.interpVBO);  // Bind sensor interpolation buffer
+		glBufferData(GL_ARRAY_BUFFER, interp[level].size() * sizeof(VertexInterp), &interp[level][0], GL_DYNAMIC_DRAW);  // Buffer data
+
+		// Vertex Nearest Sensor Indices (integer attribute, used to fetch from the sensor buffer texture)
+		glEnableVertexAttribArray(4);  // Enable vertex sensor indices attribute
+		glVertexAttribIPointer(4, 2, GL_INT, sizeof(VertexInterp), (void*)offsetof(VertexInterp, index));  // Set up attribute pointer
+
+		// Vertex Sensor Blending
+		glEnableVertexAttribArray(5);  // Enable vertex sensor blending attribute
+		glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(VertexInterp), (void*)offsetof(VertexInterp, weight));  // Set up attribute pointer
+
 		// Disable and unbind arrays
-		glBindVertexArray(0);  // Unbind vertex attrib array
+		GLState::bindVertexArray(0);  // Unbind vertex attrib array
+
+		return lod;
 	};
 };
 
@@ -0,0 +1,242 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+// Mesh Optimizer
+// Load-time clean up of indexed triangle meshes:
+//   weld          - merge vertices that are identical in every attribute
+//   vertexCache   - reorder triangles for the post-transform vertex cache (Forsyth's linear speed method)
+//   vertexFetch   - reorder vertices in the order triangles first use them, so vertex reads walk memory forward
+//   calcACMR      - average cache miss ratio (vertex shader runs per triangle) with a simulated FIFO cache
+class MeshOptimizer {
+public:
+	// Size of the cache the triangle order is optimized for (recent GPUs hold more, this order still helps)
+	static const int CACHE_SIZE = 32;
+
+	// Size of the FIFO cache used to report ACMR
+	static const int FIFO_SIZE = 16;
+
+
+	// Merge identical vertices and remap indices. Returns the number of vertices removed.
+	static int weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+		int num_vertices = (int)vertices.size();
+		if (num_vertices == 0) {
+			return 0;
+		}
+
+		// Sort vertex ids by their bytes so duplicates end up next to each other
+		std::vector<int> order(num_vertices);
+		for (int i = 0; i < num_vertices; i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) {
+			int diff = memcmp(&vertices[a], &vertices[b], sizeof(Vertex));
+			return diff < 0 || (diff == 0 && a < b);
+		});
+
+		// Keep the first of each run of duplicates (in original order, so the mesh doesn't get shuffled)
+		std::vector<int> remap(num_vertices);
+		for (int i = 0; i < num_vertices; i++) {
+			if (i > 0 && memcmp(&vertices[order[i]], &vertices[order[i - 1]], sizeof(Vertex)) == 0) {
+				remap[order[i]] = remap[order[i - 1]];
+			} else {
+				remap[order[i]] = order[i];
+			}
+		}
+
+		// Compact
+		std::vector<int> new_index(num_vertices, -1);
+		std::vector<Vertex> welded;
+		welded.reserve(num_vertices);
+		for (int i = 0; i < num_vertices; i++) {
+			if (remap[i] == i) {
+				new_index[i] = (int)welded.size();
+				welded.push_back(vertices[i]);
+			}
+		}
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			indices[i] = new_index[remap[indices[i]]];
+		}
+
+		int removed = num_vertices - (int)welded.size();
+		vertices.swap(welded);
+		return removed;
+	};
+
+
+	// Reorder triangles so consecutive triangles reuse recently transformed vertices
+	static void vertexCache(std::vector<unsigned int>& indices, int num_vertices) {
+		int num_triangles = (int)indices.size() / 3;
+		if (num_triangles == 0) {
+			return;
+		}
+
+		// Triangles using each vertex (ranges in adjacency, live = triangles not emitted yet)
+		std::vector<int> offset(num_vertices + 1, 0);
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			offset[indices[i] + 1]++;
+		}
+		for (int v = 0; v < num_vertices; v++) {
+			offset[v + 1] += offset[v];
+		}
+		std::vector<int> live(num_vertices, 0);
+		std::vector<int> adjacency(indices.size());
+		for (int t = 0; t < num_triangles; t++) {
+			for (int k = 0; k < 3; k++) {
+				int v = indices[t * 3 + k];
+				adjacency[offset[v] + live[v]++] = t;
+			}
+		}
+
+		// Initial scores
+		std::vector<int> cache_pos(num_vertices, -1);
+		std::vector<float> vertex_score(num_vertices);
+		for (int v = 0; v < num_vertices; v++) {
+			vertex_score[v] = vertexScore(-1, live[v]);
+		}
+		std::vector<float> triangle_score(num_triangles);
+		std::vector<bool> emitted(num_triangles, false);
+		int best = -1;
+		float best_score = -1.0f;
+		for (int t = 0; t < num_triangles; t++) {
+			triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+			if (triangle_score[t] > best_score) {
+				best_score = triangle_score[t];
+				best = t;
+			}
+		}
+
+		std::vector<unsigned int> result(indices.size());
+		std::vector<int> cache, new_cache;
+		cache.reserve(CACHE_SIZE + 3);
+		new_cache.reserve(CACHE_SIZE + 3);
+		int scan = 0;  // Next triangle to look at when nothing in the cache is left
+		for (int out = 0; out < num_triangles; out++) {
+			// Nothing in the cache has triangles left. Take the next triangle not emitted yet
+			if (best < 0) {
+				while (emitted[scan]) {
+					scan++;
+				}
+				best = scan;
+			}
+
+			// Emit triangle
+			int tri[3] = { (int)indices[best * 3], (int)indices[best * 3 + 1], (int)indices[best * 3 + 2] };
+			for (int k = 0; k < 3; k++) {
+				result[out * 3 + k] = tri[k];
+
+				// Remove it from its vertices' triangle lists
+				int v = tri[k];
+				int* list = &adjacency[offset[v]];
+				for (int j = 0; j < live[v]; j++) {
+					if (list[j] == best) {
+						list[j] = list[live[v] - 1];
+						break;
+					}
+				}
+				live[v]--;
+			}
+			emitted[best] = true;
+
+			// Move the triangle's vertices to the front of the cache
+			new_cache.assign(tri, tri + 3);
+			for (unsigned int i = 0; i < cache.size(); i++) {
+				if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2]) {
+					new_cache.push_back(cache[i]);
+				}
+			}
+			cache.swap(new_cache);
+
+			// Update scores of cached (and just evicted) vertices and their remaining triangles
+			best = -1;
+			best_score = -1.0f;
+			for (unsigned int i = 0; i < cache.size(); i++) {
+				int v = cache[i];
+				cache_pos[v] = (i < (unsigned int)CACHE_SIZE) ? (int)i : -1;
+				vertex_score[v] = vertexScore(cache_pos[v], live[v]);
+			}
+			for (unsigned int i = 0; i < cache.size(); i++) {
+				int v = cache[i];
+				for (int j = 0; j < live[v]; j++) {
+					int t = adjacency[offset[v] + j];
+					triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+					if (triangle_score[t] > best_score) {
+						best_score = triangle_score[t];
+						best = t;
+					}
+				}
+			}
+			if (cache.size() > (unsigned int)CACHE_SIZE) {
+				cache.resize(CACHE_SIZE);
+			}
+		}
+
+		indices.swap(result);
+	};
+
+
+	// Reorder vertices by first use. Vertices no triangle uses are dropped.
+	static void vertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+		std::vector<int> new_index(vertices.size(), -1);
+		std::vector<Vertex> ordered;
+		ordered.reserve(vertices.size());
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			unsigned int v = indices[i];
+			if (new_index[v] < 0) {
+				new_index[v] = (int)ordered.size();
+				ordered.push_back(vertices[v]);
+			}
+			indices[i] = new_index[v];
+		}
+		vertices.swap(ordered);
+	};
+
+
+	// Average cache miss ratio (vertices transformed per triangle) with a FIFO cache
+	// 3 = no reuse, 0.5 = ideal for a large regular grid
+	static float calcACMR(const std::vector<unsigned int>& indices, int num_vertices) {
+		if (indices.size() < 3) {
+			return 0.0f;
+		}
+		std::vector<int> time_stamp(num_vertices, -FIFO_SIZE - 1);	// Miss count when each vertex entered the cache
+		int misses = 0;
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			unsigned int v = indices[i];
+			// In a FIFO a vertex is evicted after FIFO_SIZE more misses
+			if (misses - time_stamp[v] > FIFO_SIZE) {
+				time_stamp[v] = misses;
+				misses++;
+			}
+		}
+		return (float)misses / (indices.size() / 3);
+	};
+
+
+private:
+	// Forsyth's vertex score. Recently used vertices and vertices with few triangles left score higher
+	static float vertexScore(int cache_pos, int remaining) {
+		if (remaining == 0) {
+			return -1.0f;  // No triangles left
+		}
+		float score = 0.0f;
+		if (cache_pos >= 0) {
+			if (cache_pos < 3) {
+				score = 0.75f;  // Used by the last triangle. Fixed score so it doesn't favor strips too much
+			} else {
+				score = powf(1.0f - (cache_pos - 3) / (float)(CACHE_SIZE - 3), 1.5f);
+			}
+		}
+		score += 2.0f * powf((float)remaining, -0.5f);  // Valence boost (finish off vertices with few triangles)
+		return score;
+	};
+};
+
+#endif
@@ -0,0 +1,341 @@
+#pragma once
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <queue>
+#include <vector>
+
+
+// Symmetric 4x4 error quadric (Garland & Heckbert). Stored as the 10 unique coefficients
+struct Quadric {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	double weight;		// Total weight (area) of the planes
+
+	Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), weight(0) {};
+
+	// Quadric of the plane ax + by + cz + d = 0, scaled by weight
+	Quadric(double a, double b, double c, double d, double weight) : weight(weight) {
+		a2 = a * a * weight; ab = a * b * weight; ac = a * c * weight; ad = a * d * weight;
+		b2 = b * b * weight; bc = b * c * weight; bd = b * d * weight;
+		c2 = c * c * weight; cd = c * d * weight;
+		d2 = d * d * weight;
+	};
+
+	// Add another quadric
+	void add(const Quadric& q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+		weight += q.weight;
+	};
+
+	// Squared distance error of a point
+	double error(const glm::vec3& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+			+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+			+ c2 * z * z + 2 * cd * z
+			+ d2;
+	};
+
+	// Point with the least error. Returns false if the system is singular
+	bool optimal(glm::vec3& p) const {
+		double det = a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) + ac * (ab * bc - b2 * ac);
+		if (fabs(det) < 1e-12) {
+			return false;
+		}
+		// Solve A p = -b with Cramer's rule
+		double bx = -ad, by = -bd, bz = -cd;
+		p.x = (float)((bx * (b2 * c2 - bc * bc) - ab * (by * c2 - bc * bz) + ac * (by * bc - b2 * bz)) / det);
+		p.y = (float)((a2 * (by * c2 - bz * bc) - bx * (ab * c2 - bc * ac) + ac * (ab * bz - by * ac)) / det);
+		p.z = (float)((a2 * (b2 * bz - bc * by) - ab * (ab * bz - by * ac) + bx * (ab * bc - b2 * ac)) / det);
+		return true;
+	};
+};
+
+
+// Mesh Simplifier
+// Edge collapse simplification driven by quadric error metrics. Works on positions only. Vertices are
+// welded by position first so unwelded OBJ faces can collapse across each other, open boundaries are
+// protected with penalty planes, and collapses that would flip a triangle are rejected.
+class MeshSimplifier {
+public:
+	// Simplify a triangle list down to about target_triangles
+	// out_positions / out_indices = simplified mesh. out_source = for each output vertex, an input vertex it came from
+	// (for normals and texture coords). Returns the largest collapse error as a world-space distance.
+	static float simplify(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, int target_triangles,
+		std::vector<glm::vec3>& out_positions, std::vector<unsigned int>& out_indices, std::vector<int>& out_source) {
+
+		// Weld vertices by position
+		std::vector<int> weld(positions.size());			// Input vertex -> welded vertex
+		std::vector<glm::vec3> pos;							// Welded positions
+		std::vector<int> source;							// Welded vertex -> first input vertex
+		std::map<glm::vec3, int, PositionOrder> lookup;		// Position -> welded vertex
+		for (int i = 0; i < (int)positions.size(); i++) {
+			const glm::vec3& key = positions[i];
+			std::map<glm::vec3, int, PositionOrder>::iterator it = lookup.find(key);
+			if (it == lookup.end()) {
+				weld[i] = (int)pos.size();
+				lookup[key] = weld[i];
+				pos.push_back(positions[i]);
+				source.push_back(i);
+			} else {
+				weld[i] = it->second;
+			}
+		}
+
+		// Triangles over welded vertices (drop ones that are already degenerate)
+		std::vector<int> tris;
+		for (int i = 0; i + 2 < (int)indices.size(); i += 3) {
+			int a = weld[indices[i]], b = weld[indices[i + 1]], c = weld[indices[i + 2]];
+			if (a != b && b != c && a != c) {
+				tris.push_back(a);
+				tris.push_back(b);
+				tris.push_back(c);
+			}
+		}
+		int num_tris = (int)tris.size() / 3;
+		std::vector<bool> removed(num_tris, false);
+
+		// Vertex -> triangles
+		std::vector<std::vector<int>> vertex_tris(pos.size());
+		for (int t = 0; t < num_tris; t++) {
+			for (int k = 0; k < 3; k++) {
+				vertex_tris[tris[3 * t + k]].push_back(t);
+			}
+		}
+
+		// Plane quadrics (area weighted)
+		std::vector<Quadric> quadrics(pos.size());
+		for (int t = 0; t < num_tris; t++) {
+			glm::vec3 p0 = pos[tris[3 * t]], p1 = pos[tris[3 * t + 1]], p2 = pos[tris[3 * t + 2]];
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float area2 = glm::length(n);
+			if (area2 <= 0.0f) {
+				continue;
+			}
+			n = n / area2;
+			Quadric q(n.x, n.y, n.z, -glm::dot(n, p0), area2 * 0.5f);
+			for (int k = 0; k < 3; k++) {
+				quadrics[tris[3 * t + k]].add(q);
+			}
+		}
+
+		// Boundary edges (used by one triangle) get a perpendicular penalty plane so outlines stay put
+		std::map<std::pair<int, int>, int> edge_count;
+		for (int t = 0; t < num_tris; t++) {
+			for (int k = 0; k < 3; k++) {
+				int a = tris[3 * t + k], b = tris[3 * t + (k + 1) % 3];
+				edge_count[std::make_pair(std::min(a, b), std::max(a, b))]++;
+			}
+		}
+		for (int t = 0; t < num_tris; t++) {
+			glm::vec3 p0 = pos[tris[3 * t]], p1 = pos[tris[3 * t + 1]], p2 = pos[tris[3 * t + 2]];
+			glm::vec3 face_n = glm::cross(p1 - p0, p2 - p0);
+			if (glm::length(face_n) <= 0.0f) {
+				continue;
+			}
+			face_n = glm::normalize(face_n);
+			for (int k = 0; k < 3; k++) {
+				int a = tris[3 * t + k], b = tris[3 * t + (k + 1) % 3];
+				if (edge_count[std::make_pair(std::min(a, b), std::max(a, b))] != 1) {
+					continue;
+				}
+				glm::vec3 edge = pos[b] - pos[a];
+				float edge_len = glm::length(edge);
+				if (edge_len <= 0.0f) {
+					continue;
+				}
+				glm::vec3 n = glm::normalize(glm::cross(edge, face_n));
+				Quadric q(n.x, n.y, n.z, -glm::dot(n, pos[a]), BOUNDARY_WEIGHT * edge_len * edge_len);
+				quadrics[a].add(q);
+				quadrics[b].add(q);
+			}
+		}
+
+		// Priority queue of edge collapses
+		std::vector<int> version(pos.size(), 0);		// Bumped whenever a vertex changes (invalidates queued edges)
+		std::priority_queue<Collapse, std::vector<Collapse>, CollapseOrder> heap;
+		for (std::map<std::pair<int, int>, int>::iterator it = edge_count.begin(); it != edge_count.end(); ++it) {
+			heap.push(makeCollapse(it->first.first, it->first.second, pos, quadrics, version));
+		}
+
+		// Collapse until the target is reached
+		int live_tris = num_tris;
+		float max_error = 0.0f;
+		while (live_tris > target_triangles && !heap.empty()) {
+			Collapse c = heap.top();
+			heap.pop();
+
+			// Skip stale entries
+			if (version[c.v0] != c.version0 || version[c.v1] != c.version1) {
+				continue;
+			}
+
+			// Reject collapses that flip a triangle
+			if (flips(c.v0, c.v1, c.target, tris, removed, vertex_tris, pos) || flips(c.v1, c.v0, c.target, tris, removed, vertex_tris, pos)) {
+				continue;
+			}
+
+			// Collapse v1 into v0
+			pos[c.v0] = c.target;
+			quadrics[c.v0].add(quadrics[c.v1]);
+			for (int i = 0; i < (int)vertex_tris[c.v1].size(); i++) {
+				int t = vertex_tris[c.v1][i];
+				if (removed[t]) {
+					continue;
+				}
+				bool has_v0 = false;
+				for (int k = 0; k < 3; k++) {
+					if (tris[3 * t + k] == c.v0) {
+						has_v0 = true;
+					}
+				}
+				if (has_v0) {
+					removed[t] = true;		// Triangle on the collapsed edge
+					live_tris--;
+				} else {
+					for (int k = 0; k < 3; k++) {
+						if (tris[3 * t + k] == c.v1) {
+							tris[3 * t + k] = c.v0;
+						}
+					}
+					vertex_tris[c.v0].push_back(t);
+				}
+			}
+			vertex_tris[c.v1].clear();
+			version[c.v0]++;
+			version[c.v1]++;
+			max_error = std::max(max_error, c.distance);
+
+			// Requeue edges around v0
+			for (int i = 0; i < (int)vertex_tris[c.v0].size(); i++) {
+				int t = vertex_tris[c.v0][i];
+				if (removed[t]) {
+					continue;
+				}
+				for (int k = 0; k < 3; k++) {
+					int other = tris[3 * t + k];
+					if (other != c.v0) {
+						heap.push(makeCollapse(c.v0, other, pos, quadrics, version));
+					}
+				}
+			}
+		}
+
+		// Compact the surviving vertices and triangles
+		std::vector<int> remap(pos.size(), -1);
+		out_positions.clear();
+		out_indices.clear();
+		out_source.clear();
+		for (int t = 0; t < num_tris; t++) {
+			if (removed[t]) {
+				continue;
+			}
+			for (int k = 0; k < 3; k++) {
+				int v = tris[3 * t + k];
+				if (remap[v] == -1) {
+					remap[v] = (int)out_positions.size();
+					out_positions.push_back(pos[v]);
+					out_source.push_back(source[v]);
+				}
+				out_indices.push_back(remap[v]);
+			}
+		}
+
+		return max_error;
+	};
+
+
+private:
+	// Boundary penalty plane weight
+	static constexpr float BOUNDARY_WEIGHT = 100.0f;
+
+	// Candidate edge collapse (v1 merges into v0 at target)
+	struct Collapse {
+		double cost;			// Quadric error of the collapse
+		float distance;			// Error as an RMS distance from the merged planes
+		int v0, v1;				// Edge vertices
+		int version0, version1;	// Vertex versions when queued
+		glm::vec3 target;		// Position after collapse
+	};
+
+	// Lexicographic position order (for welding)
+	struct PositionOrder {
+		bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+			if (a.x != b.x) return a.x < b.x;
+			if (a.y != b.y) return a.y < b.y;
+			return a.z < b.z;
+		};
+	};
+
+	// Cheapest collapse first
+	struct CollapseOrder {
+		bool operator()(const Collapse& a, const Collapse& b) const {
+			return a.cost > b.cost;
+		};
+	};
+
+
+	// Best collapse position for an edge (optimal point, either end, or midpoint)
+	static Collapse makeCollapse(int v0, int v1, const std::vector<glm::vec3>& pos, const std::vector<Quadric>& quadrics, const std::vector<int>& version) {
+		Quadric q = quadrics[v0];
+		q.add(quadrics[v1]);
+
+		glm::vec3 candidates[4] = { pos[v0], pos[v1], (pos[v0] + pos[v1]) * 0.5f, glm::vec3(0.0f) };
+		int num_candidates = 3;
+		if (q.optimal(candidates[3])) {
+			num_candidates = 4;
+		}
+
+		Collapse c;
+		c.v0 = v0;
+		c.v1 = v1;
+		c.version0 = version[v0];
+		c.version1 = version[v1];
+		c.cost = -1.0;
+		for (int i = 0; i < num_candidates; i++) {
+			double e = q.error(candidates[i]);
+			if (c.cost < 0.0 || e < c.cost) {
+				c.cost = e;
+				c.target = candidates[i];
+			}
+		}
+		c.cost = std::max(c.cost, 0.0);
+		c.distance = (q.weight > 0.0) ? (float)sqrt(c.cost / q.weight) : 0.0f;
+		return c;
+	};
+
+
+	// Would moving v (and merging other into it) to target flip any of v's remaining triangles?
+	static bool flips(int v, int other, glm::vec3 target, const std::vector<int>& tris, const std::vector<bool>& removed,
+		const std::vector<std::vector<int>>& vertex_tris, const std::vector<glm::vec3>& pos) {
+		for (int i = 0; i < (int)vertex_tris[v].size(); i++) {
+			int t = vertex_tris[v][i];
+			if (removed[t]) {
+				continue;
+			}
+			int a = tris[3 * t], b = tris[3 * t + 1], c = tris[3 * t + 2];
+			if (a == other || b == other || c == other) {
+				continue;		// Removed by the collapse
+			}
+			glm::vec3 before = glm::cross(pos[b] - pos[a], pos[c] - pos[a]);
+			glm::vec3 pa = (a == v) ? target : pos[a];
+			glm::vec3 pb = (b == v) ? target : pos[b];
+			glm::vec3 pc = (c == v) ? target : pos[c];
+			glm::vec3 after = glm::cross(pb - pa, pc - pa);
+			if (glm::dot(before, after) <= 0.0f) {
+				return true;
+			}
+		}
+		return false;
+	};
+};
+
+#endif
@@ -0,0 +1,388 @@
+#pragma once
+#ifndef MODAL_ANALYSIS_H
+#define MODAL_ANALYSIS_H
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <math.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const float OMA_PI = 3.14159265358979f;
+
+// Identified mode shape
+struct ModeShape {
+	float frequency;				// Natural frequency (Hz)
+	float singularValue;			// First singular value at the peak (mode strength)
+	std::vector<float> amplitude;	// Per-sensor amplitude (normalized so the largest is 1)
+	std::vector<float> phase;		// Per-sensor phase (radians, relative to the largest sensor)
+};
+
+
+// Operational Modal Analysis
+// Runs frequency domain decomposition (FDD) on a background thread. Sensor frames are pushed from the
+// render loop, the worker windows them into overlapping blocks, FFTs each channel and updates the
+// cross-spectral density (CSD) matrix incrementally. The CSD is only kept against a few reference channels
+// spread over the sensors (channels x references per line), which still holds every mode the references
+// see, so memory and the decomposition grow linearly with the number of sensors. The first left singular
+// vector of the CSD matrix at each peak of the first singular value is published as a mode shape.
+class ModalAnalysis {
+public:
+	// Constructor
+	// num_channels = number of sensors, sample_rate = sensor rate (Hz), block_size = FFT length (power of 2)
+	// num_references = reference channels the CSD is kept against
+	ModalAnalysis(int num_channels, float sample_rate, int block_size = 256, int num_averages = 16, int max_modes = 4, int num_references = 4) {
+		numChannels = num_channels;
+		numReferences = std::max(1, std::min(num_references, num_channels));
+		sampleRate = sample_rate;
+		blockSize = block_size;
+		hopSize = block_size / 2;		// 50% overlap
+		numAverages = num_averages;
+		maxModes = max_modes;
+		numLines = block_size / 2 + 1;	// One sided spectrum
+		minFrequency = 2.0f * sample_rate / block_size;  // Skip DC and the first line
+		numBlocks = 0;
+
+		// Hann window
+		window.resize(blockSize);
+		float window_power = 0.0f;
+		for (int i = 0; i < blockSize; i++) {
+			window[i] = 0.5f - 0.5f * cos(2.0f * OMA_PI * i / blockSize);
+			window_power += window[i] * window[i];
+		}
+		csdScale = 2.0f / (sampleRate * window_power);  // One sided PSD scaling
+
+		// Reference channels, evenly spread (the middle of each of numReferences groups)
+		references.resize(numReferences);
+		for (int j = 0; j < numReferences; j++) {
+			references[j] = ((2 * j + 1) * numChannels) / (2 * numReferences);
+		}
+
+		// Work buffers
+		spectra.resize(numChannels * numLines);
+		csd.assign(numLines * numChannels * numReferences, std::complex<float>(0.0f, 0.0f));
+		fftBuffer.resize(blockSize);
+		powerBuffer.resize(numReferences);
+		firstSingular.resize(numLines);
+		firstVectors.resize(numLines * numChannels);
+		rightVectors.resize(numLines * numReferences);
+
+		// Start worker
+		running = true;
+		worker = std::thread(&ModalAnalysis::run, this);
+	};
+
+	// Destructor
+	~ModalAnalysis() {
+		stop();
+	};
+
+
+	// Push one frame of samples (one value per sensor). Called from the render loop.
+	void pushSamples(const std::vector<float>& frame) {
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			pending.insert(pending.end(), frame.begin(), frame.begin() + numChannels);
+		}
+		pendingCond.notify_one();
+	};
+
+
+	// Hand the latest mode shapes to modes if they changed since version. Returns true if modes were updated.
+	// Swaps instead of copying so the caller never allocates (the old storage is freed on the worker). One caller only.
+	bool getModes(std::vector<ModeShape>& modes, unsigned int& version) {
+		std::lock_guard<std::mutex> lock(resultMutex);
+		if (version == resultVersion) {
+			return false;
+		}
+		modes.swap(results);
+		version = resultVersion;
+		return true;
+	};
+
+
+	// Stop the worker thread
+	void stop() {
+		if (!running) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			running = false;
+		}
+		pendingCond.notify_one();
+		if (worker.joinable()) {
+			worker.join();
+		}
+	};
+
+
+private:
+	// Settings
+	int numChannels;		// Number of sensors
+	int numReferences;		// Number of reference channels
+	float sampleRate;		// Sample rate (Hz)
+	int blockSize;			// FFT length
+	int hopSize;			// Samples between blocks
+	int numAverages;		// Number of blocks in the running CSD average
+	int maxModes;			// Max number of modes to publish
+	int numLines;			// Number of frequency lines
+	float minFrequency;		// Lowest frequency considered for peaks
+	float csdScale;			// PSD scaling
+	long numBlocks;			// Number of blocks averaged so far
+
+	// Thread data
+	std::thread worker;							// Worker thread
+	std::atomic<bool> running;					// Is the worker running?
+	std::mutex pendingMutex;					// Guards pending
+	std::condition_variable pendingCond;		// Signals new samples
+	std::vector<float> pending;					// Frames pushed by the render loop (interleaved)
+	std::mutex resultMutex;						// Guards results
+	std::vector<ModeShape> results;				// Published mode shapes
+	unsigned int resultVersion = 0;				// Incremented every publish
+
+	// Worker data
+	std::vector<float> samples;							// Frames waiting to be processed (interleaved)
+	std::vector<float> window;							// Hann window
+	std::vector<int> references;						// Reference channels
+	std::vector<std::complex<float>> fftBuffer;			// FFT scratch
+	std::vector<std::complex<float>> powerBuffer;		// Power iteration scratch
+	std::vector<std::complex<float>> spectra;			// Windowed spectra. [channel][line]
+	std::vector<std::complex<float>> csd;				// CSD matrices against the references. [line][channel][reference]
+	std::vector<float> firstSingular;					// First singular value per line
+	std::vector<std::complex<float>> firstVectors;		// First left singular vector per line (the mode shape). [line][channel]
+	std::vector<std::complex<float>> rightVectors;		// First right singular vector per line. [line][reference]
+
+
+	// Worker loop
+	void run() {
+		std::vector<float> incoming;  // Frames taken from pending
+		while (true) {
+			// Wait for new samples
+			{
+				std::unique_lock<std::mutex> lock(pendingMutex);
+				pendingCond.wait(lock, [this] { return !running || !pending.empty(); });
+				if (!running) {
+					return;
+				}
+				incoming.swap(pending);
+			}
+			samples.insert(samples.end(), incoming.begin(), incoming.end());
+			incoming.clear();
+
+			// Process every full block, then decompose
+			bool updated = false;
+			while ((int)samples.size() >= blockSize * numChannels) {
+				processBlock();
+				samples.erase(samples.begin(), samples.begin() + hopSize * numChannels);
+				updated = true;
+			}
+			if (updated) {
+				decompose();
+			}
+		}
+	};
+
+
+	// Window and FFT the oldest block, then fold it into the running CSD average
+	void processBlock() {
+		// Spectrum of each channel
+		for (int c = 0; c < numChannels; c++) {
+			// Remove mean so DC does not leak into the low lines
+			float mean = 0.0f;
+			for (int i = 0; i < blockSize; i++) {
+				mean += samples[i * numChannels + c];
+			}
+			mean /= blockSize;
+
+			for (int i = 0; i < blockSize; i++) {
+				fftBuffer[i] = std::complex<float>((samples[i * numChannels + c] - mean) * window[i], 0.0f);
+			}
+			fft(fftBuffer);
+			for (int k = 0; k < numLines; k++) {
+				spectra[c * numLines + k] = fftBuffer[k];
+			}
+		}
+
+		// Incremental CSD update. G += (X X^H - G) / n, capped at numAverages so old blocks fade out
+		numBlocks++;
+		float weight = 1.0f / (float)std::min(numBlocks, (long)numAverages);
+		for (int k = 0; k < numLines; k++) {
+			std::complex<float>* G = &csd[k * numChannels * numReferences];
+			for (int r = 0; r < numChannels; r++) {
+				std::complex<float> xr = spectra[r * numLines + k] * csdScale;
+				for (int j = 0; j < numReferences; j++) {
+					std::complex<float> value = xr * std::conj(spectra[references[j] * numLines + k]);
+					G[r * numReferences + j] += (value - G[r * numReferences + j]) * weight;
+				}
+			}
+		}
+	};
+
+
+	// Frequency domain decomposition. Finds the first singular value / vector per line, picks peaks, and publishes mode shapes
+	void decompose() {
+		// First singular value and vector of each CSD matrix
+		for (int k = 0; k < numLines; k++) {
+			firstSingular[k] = firstSingularVector(&csd[k * numChannels * numReferences], &firstVectors[k * numChannels], &rightVectors[k * numReferences]);
+		}
+
+		// Peak picking. Local maxima of the first singular value above a fraction of the global max
+		int first_line = std::max(1, (int)ceil(minFrequency * blockSize / sampleRate));
+		float max_value = 0.0f;
+		for (int k = first_line; k < numLines; k++) {
+			max_value = std::max(max_value, firstSingular[k]);
+		}
+		std::vector<int> peaks;
+		for (int k = first_line; k < numLines - 1; k++) {
+			if (firstSingular[k] > firstSingular[k - 1] && firstSingular[k] >= firstSingular[k + 1] && firstSingular[k] > 0.01f * max_value) {
+				peaks.push_back(k);
+			}
+		}
+		std::sort(peaks.begin(), peaks.end(), [this](int a, int b) { return firstSingular[a] > firstSingular[b]; });
+		if ((int)peaks.size() > maxModes) {
+			peaks.resize(maxModes);
+		}
+
+		// Extract mode shapes
+		std::vector<ModeShape> modes;
+		for (int p = 0; p < (int)peaks.size(); p++) {
+			int k = peaks[p];
+			ModeShape mode;
+
+			// Parabolic interpolation for a frequency between lines
+			float left = firstSingular[k - 1];
+			float center = firstSingular[k];
+			float right = firstSingular[k + 1];
+			float denom = left - 2.0f * center + right;
+			float offset = (denom != 0.0f) ? 0.5f * (left - right) / denom : 0.0f;
+			mode.frequency = (k + offset) * sampleRate / blockSize;
+			mode.singularValue = center;
+
+			// Normalize so the largest component has amplitude 1 and phase 0
+			const std::complex<float>* u = &firstVectors[k * numChannels];
+			int ref = 0;
+			for (int c = 1; c < numChannels; c++) {
+				if (std::abs(u[c]) > std::abs(u[ref])) {
+					ref = c;
+				}
+			}
+			float ref_amp = std::max(std::abs(u[ref]), 1e-20f);
+			float ref_phase = std::arg(u[ref]);
+			mode.amplitude.resize(numChannels);
+			mode.phase.resize(numChannels);
+			for (int c = 0; c < numChannels; c++) {
+				mode.amplitude[c] = std::abs(u[c]) / ref_amp;
+				mode.phase[c] = std::arg(u[c]) - ref_phase;
+			}
+			modes.push_back(mode);
+		}
+
+		// Publish
+		std::lock_guard<std::mutex> lock(resultMutex);
+		results.swap(modes);
+		resultVersion++;
+	};
+
+
+	// First singular value and left / right vectors of a channels x references matrix (power iteration, O(channels x references) per step)
+	float firstSingularVector(const std::complex<float>* G, std::complex<float>* u, std::complex<float>* v) {
+		// Start from the previous right vector for this line (converges in a few iterations once settled)
+		float norm = 0.0f;
+		for (int j = 0; j < numReferences; j++) {
+			norm += std::norm(v[j]);
+		}
+		if (norm < 1e-20f) {
+			for (int j = 0; j < numReferences; j++) {
+				v[j] = std::complex<float>(1.0f, 0.0f);
+			}
+		}
+
+		float sigma = 0.0f;
+		for (int iter = 0; iter < 32; iter++) {
+			// u = G v / |G v|
+			float length = 0.0f;
+			for (int r = 0; r < numChannels; r++) {
+				std::complex<float> sum(0.0f, 0.0f);
+				for (int j = 0; j < numReferences; j++) {
+					sum += G[r * numReferences + j] * v[j];
+				}
+				u[r] = sum;
+				length += std::norm(sum);
+			}
+			length = sqrt(length);
+			if (length < 1e-30f) {
+				return 0.0f;
+			}
+			for (int r = 0; r < numChannels; r++) {
+				u[r] /= length;
+			}
+
+			// v = G^H u / |G^H u|. The length is the singular value
+			length = 0.0f;
+			float change = 0.0f;
+			std::vector<std::complex<float>>& w = powerBuffer;
+			for (int j = 0; j < numReferences; j++) {
+				std::complex<float> sum(0.0f, 0.0f);
+				for (int r = 0; r < numChannels; r++) {
+					sum += std::conj(G[r * numReferences + j]) * u[r];
+				}
+				w[j] = sum;
+				length += std::norm(sum);
+			}
+			length = sqrt(length);
+			if (length < 1e-30f) {
+				return 0.0f;
+			}
+			for (int j = 0; j < numReferences; j++) {
+				std::complex<float> unit = w[j] / length;
+				change += std::norm(unit - v[j]);
+				v[j] = unit;
+			}
+			sigma = length;
+			if (change < 1e-10f) {
+				break;
+			}
+		}
+		return sigma;
+	};
+
+
+	// In-place iterative radix-2 FFT
+	void fft(std::vector<std::complex<float>>& a) {
+		int n = blockSize;
+
+		// Bit reversal permutation
+		for (int i = 1, j = 0; i < n; i++) {
+			int bit = n >> 1;
+			for (; j & bit; bit >>= 1) {
+				j ^= bit;
+			}
+			j ^= bit;
+			if (i < j) {
+				std::swap(a[i], a[j]);
+			}
+		}
+
+		// Butterflies
+		for (int len = 2; len <= n; len <<= 1) {
+			float angle = -2.0f * OMA_PI / len;
+			std::complex<float> wlen(cos(angle), sin(angle));
+			for (int i = 0; i < n; i += len) {
+				std::complex<float> w(1.0f, 0.0f);
+				for (int j = 0; j < len / 2; j++) {
+					std::complex<float> u = a[i + j];
+					std::complex<float> v = a[i + j + len / 2] * w;
+					a[i + j] = u + v;
+					a[i + j + len / 2] = u - v;
+					w *= wlen;
+				}
+			}
+		}
+	};
+};
+
+#endif
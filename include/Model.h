@@ -12,10 +12,17 @@
 #include <assimp/postprocess.h>
 #include "stb_image.h"
 
+#include "FrameArena.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "SensorLayout.h"
 #include "Shader.h"
+#include "TaskGraph.h"
 
 #include <algorithm>    // std::max
+#include <cstddef>      // offsetof
+#include <float.h>      // FLT_MAX
 #include <stdio.h>
 #include <string>
 #include <fstream>
@@ -25,21 +32,358 @@
 #include <vector>
 using namespace std;
 
+// Level of detail settings
+const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.1f };	// Triangle count of each simplified level compared to the full mesh
+const int LOD_MIN_TRIANGLES = 64;					// Don't simplify below this many triangles
+const float LOD_PIXEL_ERROR = 1.0f;				// Largest allowed on-screen error of a level (pixels)
+const int LOD_MAX_LEVELS = 1 + sizeof(LOD_RATIOS) / sizeof(LOD_RATIOS[0]);	// Full mesh plus simplified levels
+
+// Culling counters for the last addDraws
+struct CullStats {
+	int meshesDrawn;			// Mesh draw calls submitted
+	int meshesCulled;			// Meshes outside the frustum (counted per instance)
+	long trianglesDrawn;		// Triangles submitted (at the chosen level of detail, all instances)
+	long trianglesCulled;		// Full detail triangles of the culled meshes (counted per instance)
+};
+
+// One placement of a model
+struct ModelInstance {
+	glm::mat4 transform;			// Model matrix (object to world)
+	glm::mat4 inverseTransform;		// World to object
+	int sensorOffset;				// Index of this instance's first sensor in the sensor buffer
+};
+
+// Per-instance data for instanced draws (model_vshader.vs attributes 6 to 10)
+struct InstanceData {
+	glm::mat4 transform;			// Model matrix
+	int sensorOffset;				// Added to the vertex sensor indices
+};
+
+// Closest ray hit on a model
+struct PickHit {
+	int model;					// Model index in the scene (-1 = nothing hit)
+	int instance;				// Instance of the model
+	int mesh;					// Mesh hit
+	int triangle;				// Full detail triangle hit
+	float distance;				// Distance along the ray
+	glm::vec3 position;			// Hit point (world)
+	glm::vec3 objectPosition;	// Hit point in the model's space (where its sensor layout is defined)
+	int sensorOffset;			// Index of the instance's first sensor
+};
+
+// New sensor interpolation for one level of one mesh
+struct LayoutStream {
+	int mesh;							// Mesh
+	int lod;							// Level of detail
+	unsigned int first, last;			// Vertices that changed
+	std::vector<VertexInterp> interp;	// Whole level (swapped in)
+};
+
+// Sensor layout and the interpolation that changed with it (built on any thread, applied on the GL thread)
+struct LayoutUpdate {
+	SensorLayout layout;				// New layout
+	std::vector<LayoutStream> streams;	// Levels whose interpolation changed
+	long recomputed;					// Vertices re-interpolated (in changed ranges)
+	long changed;						// Vertices whose interpolation changed
+};
+
 class Model {
 public:
-	// Constructor
-	Model(string path, vector<glm::vec3> sensor_pos_p) {
-		sensor_pos = sensor_pos_p;	// Set sensor position vector
-		loadModel(path);			// Load model
+	CullStats stats;			// Culling counters for the last addDraws
+
+	// Constructor (loads and uploads on this thread)
+	// residency = what each mesh keeps in RAM after upload
+	Model(string path, SensorLayout layout_p, Mesh_Residency residency_p = MESH_KEEP_POSITIONS) {
+		layout = std::move(layout_p);			// Set sensor layout
+		numChannels = layout.channels();		// Sensor data size (layout changes keep it)
+		residency = residency_p;				// Set CPU copy policy
+		loadModel(path, NULL);		// Load model
+		upload();					// Create buffers and textures
+	};
+
+	// Constructor for loading in two steps: load() on a worker thread, then upload() on the GL thread
+	Model(SensorLayout layout_p, Mesh_Residency residency_p = MESH_KEEP_POSITIONS) {
+		layout = std::move(layout_p);			// Set sensor layout
+		numChannels = layout.channels();		// Sensor data size (layout changes keep it)
+		residency = residency_p;				// Set CPU copy policy
+	};
+
+
+	// Import and process the model (no GL calls). Meshes are processed in parallel on graph's workers (if given)
+	void load(string path, TaskGraph* graph) {
+		loadModel(path, graph);
 	};
 
-	// Draw Meshes
-	void Draw(Shader& shader, vector<float> data, int update_bool) {
+
+	// Create buffers and textures for the loaded model (GL thread)
+	void upload() {
+		// Textures (found by path when the meshes were processed)
+		for (unsigned int i = 0; i < textures_loaded.size(); i++) {
+			textures_loaded[i].id = TextureFromFile(textures_loaded[i].path.c_str(), directory);
+		}
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			for (unsigned int j = 0; j < meshes[i].textures.size(); j++) {
+				for (unsigned int k = 0; k < textures_loaded.size(); k++) {
+					if (meshes[i].textures[j].path == textures_loaded[k].path) {
+						meshes[i].textures[j].id = textures_loaded[k].id;
+					}
+				}
+			}
+		}
+
+		// Mesh buffers
 		for (unsigned int i = 0; i < meshes.size(); i++) {
-			meshes[i].Draw(shader, data, update_bool);
+			meshes[i].upload(residency);
+		}
+		setupInstanceBuffer();		// Set up per-instance attributes
+		printMemory();				// Report resident memory
+	};
+
+	// Record every instance's meshes in the queue, one instanced draw per mesh over the instances that can see it
+	// (uploads the visible instances, grouped by mesh)
+	// view_projection = projection * view. Instances and meshes outside its frustum are culled (meshes through the BVH)
+	// camera_pos and pixels_per_unit (viewport height / (2 tan(fov / 2))) pick each mesh's level of detail
+	// Per-frame scratch comes from arena, so recording doesn't allocate
+	void addDraws(RenderQueue& queue, Shader& shader, const glm::mat4& view_projection, glm::vec3 camera_pos, float pixels_per_unit, Span<const ModelInstance> instances, FrameArena& arena) {
+		stats.meshesDrawn = 0;
+		stats.meshesCulled = 0;
+		stats.trianglesDrawn = 0;
+		stats.trianglesCulled = 0;
+
+		// Level of detail to draw each mesh at (finest over the instances that see it)
+		Span<int> meshLOD = arena.alloc<int>(meshes.size());
+		std::fill(meshLOD.begin(), meshLOD.end(), LOD_MAX_LEVELS);
+
+		// Distance from the camera to each mesh's center in the nearest instance (the queue sorts front to back)
+		Span<float> meshDepth = arena.alloc<float>(meshes.size());
+		std::fill(meshDepth.begin(), meshDepth.end(), FLT_MAX);
+
+		// Instances that see each mesh
+		Span<unsigned int> meshInstances = arena.alloc<unsigned int>(meshes.size());
+		std::fill(meshInstances.begin(), meshInstances.end(), 0u);
+
+		// Visible meshes of each instance, as (mesh, instance) pairs
+		Span<glm::ivec2> pairs = arena.alloc<glm::ivec2>(meshes.size() * instances.size());
+		unsigned int num_pairs = 0;
+
+		// Cull instances, then meshes within each instance (frustum moved into object space)
+		for (unsigned int i = 0; i < instances.size(); i++) {
+			Frustum frustum(view_projection * instances[i].transform);
+			if (frustum.test(bounds) == FRUSTUM_OUTSIDE) {
+				stats.meshesCulled += (int)meshes.size();
+				stats.trianglesCulled += totalTriangles;
+				continue;
+			}
+			bvh.query(frustum, visible);
+			stats.meshesCulled += (int)meshes.size() - (int)visible.size();
+			stats.trianglesCulled += totalTriangles;  // Visible meshes are taken back off below
+
+			glm::vec3 object_camera = glm::vec3(instances[i].inverseTransform * glm::vec4(camera_pos, 1.0f));
+			for (unsigned int j = 0; j < visible.size(); j++) {
+				int m = visible[j];
+				meshLOD[m] = std::min(meshLOD[m], meshes[m].selectLOD(object_camera, pixels_per_unit, LOD_PIXEL_ERROR));
+				meshDepth[m] = std::min(meshDepth[m], glm::length(meshes[m].bounds.center() - object_camera));
+				meshInstances[m]++;
+				pairs[num_pairs++] = glm::ivec2(m, (int)i);
+				stats.trianglesCulled -= (long)(meshes[m].lods[0].numIndices / 3);
+			}
+		}
+		if (num_pairs == 0) {
+			return;
+		}
+
+		// Each mesh's instances are a contiguous run of the instance buffer
+		Span<unsigned int> meshFirst = arena.alloc<unsigned int>(meshes.size());
+		unsigned int next = 0;
+		for (unsigned int m = 0; m < meshes.size(); m++) {
+			meshFirst[m] = next;
+			next += meshInstances[m];
+		}
+		Span<InstanceData> instanceData = arena.alloc<InstanceData>(num_pairs);
+		std::fill(meshInstances.begin(), meshInstances.end(), 0u);  // Now counts the instances placed
+		for (unsigned int p = 0; p < num_pairs; p++) {
+			int m = pairs[p].x;
+			const ModelInstance& instance = instances[pairs[p].y];
+			InstanceData& data = instanceData[meshFirst[m] + meshInstances[m]++];
+			data.transform = instance.transform;
+			data.sensorOffset = instance.sensorOffset;
+		}
+
+		// Upload (orphan the old storage so the driver doesn't wait on last frame's draws)
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		if (num_pairs > instanceCapacity) {
+			instanceCapacity = num_pairs;
+		}
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, num_pairs * sizeof(InstanceData), instanceData.ptr);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// One instanced draw per mesh that any instance can see (submitted by the queue, after the upload above)
+		for (unsigned int m = 0; m < meshes.size(); m++) {
+			if (meshInstances[m] == 0) {
+				continue;
+			}
+			meshes[m].addDraw(queue, shader, meshLOD[m], meshFirst[m], (int)meshInstances[m], meshDepth[m]);
+			stats.meshesDrawn++;
+			stats.trianglesDrawn += (long)(meshes[m].lods[meshLOD[m]].numIndices / 3) * meshInstances[m];
 		}
 	};
 
+
+	// Print resident CPU and GPU bytes per mesh and in total
+	void printMemory() {
+		size_t cpu_total = 0;
+		size_t gpu_total = 0;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			size_t cpu = meshes[i].cpuBytes();
+			size_t gpu = meshes[i].gpuBytes();
+			printf("Mesh %u memory: CPU %.1f KB, GPU %.1f KB (%u LODs)\n", i, cpu / 1024.0, gpu / 1024.0, (unsigned int)meshes[i].lods.size());
+			cpu_total += cpu;
+			gpu_total += gpu;
+		}
+		cpu_total += meshes.capacity() * sizeof(Mesh);
+		gpu_total += instanceCapacity * sizeof(InstanceData);
+		printf("Model memory: CPU %.1f KB, GPU %.1f KB (%u meshes)\n", cpu_total / 1024.0, gpu_total / 1024.0, (unsigned int)meshes.size());
+	};
+
+
+	// Number of sensor channels (the layout's when loaded. Later layouts may not use more)
+	int numSensors() {
+		return numChannels;
+	};
+
+
+	// Sensor layout in use
+	const SensorLayout& sensorLayout() {
+		return layout;
+	};
+
+
+	// Interpolation of every vertex that a new layout changes (any thread, one call at a time).
+	// Only vertices in the ranges of the layout that changed are recomputed. Returns false if the
+	// meshes don't keep the positions and interpolation needed (MESH_RELEASE)
+	bool reinterpolate(const SensorLayout& next, LayoutUpdate& update) {
+		update.layout = next;
+		update.streams.clear();
+		update.recomputed = 0;
+		update.changed = 0;
+		LayoutChange change = layout.diff(next);
+		for (unsigned int m = 0; m < meshes.size(); m++) {
+			if (!meshes[m].canReinterpolate()) {
+				return false;
+			}
+			for (unsigned int l = 0; l < meshes[m].lods.size(); l++) {
+				LayoutStream stream;
+				stream.mesh = (int)m;
+				stream.lod = (int)l;
+				stream.first = meshes[m].lods[l].numVertices;
+				stream.last = 0;
+				stream.interp = meshes[m].interp[l];
+				for (unsigned int v = 0; v < stream.interp.size(); v++) {
+					glm::vec3 pos = meshes[m].position((int)l, v);
+					if (!layout.changed(change, pos)) {
+						continue;
+					}
+					VertexInterp vertex;
+					next.interp(pos, vertex.index, vertex.weight);
+					update.recomputed++;
+					VertexInterp& old = stream.interp[v];
+					if (vertex.index.x != old.index.x || vertex.index.y != old.index.y || vertex.weight.x != old.weight.x || vertex.weight.y != old.weight.y) {
+						stream.interp[v] = vertex;
+						stream.first = std::min(stream.first, v);
+						stream.last = std::max(stream.last, v);
+						update.changed++;
+					}
+				}
+				if (stream.first <= stream.last) {
+					update.streams.push_back(std::move(stream));
+				}
+			}
+		}
+		return true;
+	};
+
+
+	// Switch to an updated layout (GL thread). Uploads the changed vertices of each level, all before the next draw
+	void applyLayout(LayoutUpdate& update) {
+		for (unsigned int i = 0; i < update.streams.size(); i++) {
+			LayoutStream& stream = update.streams[i];
+			meshes[stream.mesh].updateInterp(stream.lod, stream.interp, stream.first, stream.last);
+		}
+		layout = update.layout;
+	};
+
+
+	// Cast a ray (world space) against every instance. Updates hit if something is closer than hit.distance.
+	// Tests the rest geometry (mode shape animation is only applied in the shader). Returns true if hit was updated
+	bool pick(const Ray& ray, Span<const ModelInstance> instances, PickHit& hit) {
+		bool found = false;
+		for (unsigned int i = 0; i < instances.size(); i++) {
+			// Move the ray into object space (t is the same in both)
+			Ray object_ray = ray.transformed(instances[i].inverseTransform);
+			float t = hit.distance;
+			int triangle = -1;
+			int mesh = bvh.raycast(object_ray, t, [&](int m, float& closest) {
+				int hit_triangle = meshes[m].raycast(object_ray, closest);
+				if (hit_triangle >= 0) {
+					triangle = hit_triangle;
+					return true;
+				}
+				return false;
+			});
+			if (mesh < 0) {
+				continue;
+			}
+
+			hit.instance = (int)i;
+			hit.mesh = mesh;
+			hit.triangle = triangle;
+			hit.distance = t;
+			hit.position = ray.origin + ray.direction * t;
+			hit.objectPosition = object_ray.origin + object_ray.direction * t;
+			hit.sensorOffset = instances[i].sensorOffset;
+			found = true;
+		}
+		return found;
+	};
+
+
+	// Interpolation of the sensor values at a point (object space). Same as the heatmap uses for vertices
+	// interp_index = the two sensors blended (-1 = none). interp_weight = their weights
+	void sensorInterp(glm::vec3 pos, glm::ivec2& interp_index, glm::vec2& interp_weight) {
+		layout.interp(pos, interp_index, interp_weight);
+	};
+
+
+	// Sensors closest to a point (object space), nearest first. Returns how many were written to nearest
+	int nearestSensors(glm::vec3 pos, int* nearest, int count) {
+		int found = 0;
+		for (int i = 0; i < layout.channels(); i++) {
+			if (!layout.hasSensor(i)) {
+				continue;
+			}
+			// Insertion sort into the closest found so far
+			float distance = glm::length(layout.position(i) - pos);
+			int j = found < count ? found++ : count;
+			while (j > 0 && glm::length(layout.position(nearest[j - 1]) - pos) > distance) {
+				if (j < count) {
+					nearest[j] = nearest[j - 1];
+				}
+				j--;
+			}
+			if (j < count) {
+				nearest[j] = i;
+			}
+		}
+		return found;
+	};
+
+
+	// Position of a sensor (object space)
+	glm::vec3 sensorPosition(int sensor) {
+		return layout.position(sensor);
+	};
+
 	// Clear Model
 	void clearModel() {
 		// Clear Meshes
@@ -67,6 +411,8 @@ public:
 		}*/
 		textures_loaded.clear();
 		//printf("textures loaded: %lu\n", textures_loaded.size());
+
+		glDeleteBuffers(1, &instanceVBO);  // Delete instance buffer
 	};
 
 
@@ -75,10 +421,21 @@ private:
 	vector<Mesh> meshes;	// Meshes
 	string directory;		// Directory
 	vector<Texture> textures_loaded;  // Textures we've already loaded
-	vector<glm::vec3> sensor_pos;		// Sensor position
-
-	// Load Model
-	void loadModel(string path) {
+	SensorLayout layout;				// Sensor positions and how vertices blend them
+	int numChannels;					// Sensor channels (size of each instance's range of the sensor data)
+	Mesh_Residency residency;			// What meshes keep in RAM after upload
+	AABB bounds;						// Bounding box of the whole model
+	BVH bvh;							// Bounding volume hierarchy over the meshes' bounding boxes
+	long totalTriangles = 0;			// Full detail triangles in the model
+
+	// Instancing
+	unsigned int instanceVBO;				// Per-instance data buffer (shared by every mesh's VAOs)
+	unsigned int instanceCapacity = 1;		// Instances the buffer has room for
+	vector<int> visible;					// Meshes that passed culling for one instance (keeps its capacity between frames)
+
+	// Load Model (no GL calls)
+	// graph = task graph whose workers process the meshes (NULL = process them on this thread)
+	void loadModel(string path, TaskGraph* graph) {
 		Assimp::Importer import;	// Load Assimp importer
 		// Import scene. (Triangulate makes sure mesh is triangles. FlipUVs makes the textures flipped correctly)
 		const aiScene* scene = import.ReadFile(path.c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
@@ -91,106 +448,69 @@ private:
 
 		// If successful, then save directory and process nodes
 		directory = path.substr(0, path.find_last_of('/'));
-		processNode(scene->mRootNode, scene);	// Start by processing root node
-	};
-
+		vector<aiMesh*> node_meshes;
+		processNode(scene->mRootNode, scene, node_meshes);	// Start by processing root node
+
+		// Materials first (they share textures_loaded)
+		vector<vector<Texture>> mesh_textures(node_meshes.size());
+		vector<glm::vec4> mesh_colors(node_meshes.size());
+		for (unsigned int i = 0; i < node_meshes.size(); i++) {
+			processMaterial(node_meshes[i], scene, mesh_textures[i], mesh_colors[i]);
+		}
 
-	// Process Node
-	void processNode(aiNode* node, const aiScene* scene) {
-		// Process all the node's meshes (if any)
-		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];  // Get mesh
-			meshes.push_back(processMesh(mesh, scene));		 // Push processed mesh into mesh vector
+		// Then meshes, each on its own (interpolation, optimization and LODs are the slow part of startup)
+		meshes.resize(node_meshes.size());
+		std::function<void(int)> process = [&](int i) {
+			meshes[i] = processMesh(node_meshes[i], std::move(mesh_textures[i]), mesh_colors[i]);
+		};
+		if (graph != NULL) {
+			graph->parallelFor((int)node_meshes.size(), process);
+		} else {
+			for (int i = 0; i < (int)node_meshes.size(); i++) {
+				process(i);
+			}
 		}
-		// Then, do the same for each of its children
-		for (unsigned int i = 0; i < node->mNumChildren; i++) {
-			processNode(node->mChildren[i], scene);		// Process children nodes
+
+		// Build BVH over the mesh bounds for frustum culling
+		vector<AABB> mesh_bounds(meshes.size());
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			mesh_bounds[i] = meshes[i].bounds;
+			bounds.expand(meshes[i].bounds);
+			totalTriangles += meshes[i].indices.size() / 3;
 		}
+		bvh.build(mesh_bounds, 1);
 	};
 
 
-	// Process interpolation data for a vertex given sensor_pos and vertex pos
-	glm::vec4 calcVertexInterp(glm::vec3 vertex_pos) {
-		// Initialize Data
-		glm::vec4 interp_data = glm::vec4(-1.0f, -1.0f, -1.0f, -1.0f);  // Initialize interp_data
-		float west_num = 8;  // Number of sensor positions on the west side
-		float roof_num = 8;  // Number of sensor positions on the roof
-		float east_num = 9;  // Number of sensor poisitons on the east side
-		float num = 0;		// Total number of sensors on the side
-
-		// Go through each sensor positions. (in decreasing x order)
-		for (int i = 0; i < (int)sensor_pos.size(); i++) {
-			glm::vec3 temp_pos = sensor_pos.at(i);  // Get temp sensor pos
-
-			// If vertex pos y is less than -1, then it's on the West side
-			if (vertex_pos.y < -1) {
-				num = west_num;
-				if (vertex_pos.x > temp_pos.x) {	// When vertex x pos > a sensor x pos, 
-					interp_data.x = i - 1;			// Set larger index to i - 1
-					interp_data.y = i;				// Set smaller index to i
-					break;
-				}
+	// Set up instance buffer and attach it to every mesh's vertex arrays
+	void setupInstanceBuffer() {
+		glGenBuffers(1, &instanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-			// If vertex pos y is between -1 and 1, then it's on the roof
-			} else if (vertex_pos.y > -1 && vertex_pos.y < 1) {
-				num = west_num + roof_num;
-				if (vertex_pos.x > temp_pos.x) {	// When vertex x pos > a sensor x pos, 
-					interp_data.x = i - 1;			// Set larger index to i - 1
-					interp_data.y = i;				// Set smaller index to i
-					break;
-				}
-
-			// Else, it's > 1 and on the East side
-			} else {
-				num = west_num + roof_num + east_num;
-				if (vertex_pos.x > temp_pos.x) {	// When vertex x pos > a sensor x pos, 
-					interp_data.x = i - 1;			// Set larger index to i - 1
-					interp_data.y = i;				// Set smaller index to i
-					break;
-				}
-			}//End if statement
-
-			// If nothing was found, then it's between -9.4 and -11
-			if (interp_data.x == -1 && interp_data.y == -1) {
-				interp_data.x = num - 1.0f;		// Find index of largest one, which is in this case is 
-			}
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			meshes[i].setInstanceBuffer(instanceVBO, sizeof(InstanceData), offsetof(InstanceData, sensorOffset));
+		}
+	};
 
-		}//End for loop
 
-		// Find x points for interpolation
-		float point_x1;
-		if (interp_data.x == -1) {
-			point_x1 = 12.0f;
-		} else {
-			point_x1 = sensor_pos.at((int)interp_data.x).x;  // x pos of sensor 1
-		}
-		float point_x2;
-		if (interp_data.y == -1) {
-			point_x2 = -12.0f;
+	// Process Node (collects the meshes of the node and its children, in order)
+	void processNode(aiNode* node, const aiScene* scene, vector<aiMesh*>& node_meshes) {
+		// Process all the node's meshes (if any)
+		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+			node_meshes.push_back(scene->mMeshes[node->mMeshes[i]]);  // Get mesh
 		}
-		else {
-			point_x2 = sensor_pos.at((int)interp_data.y).x;  // x pos of sensor 2
+		// Then, do the same for each of its children
+		for (unsigned int i = 0; i < node->mNumChildren; i++) {
+			processNode(node->mChildren[i], scene, node_meshes);		// Process children nodes
 		}
-
-		// Find interpolations
-		//printf("interp_data x: %f, %f, %f, %f\n", interp_data.x, interp_data.y, interp_data.z, interp_data.w);
-		//printf("vertex pos x: %f, x1: %f, x2: %f\n", vertex_pos.x, point_x1, point_x2);
-		interp_data.z = (point_x1 - vertex_pos.x) / (point_x1 - point_x2);	// Calculate blending for sensor 1
-		interp_data.w = (vertex_pos.x - point_x2) / (point_x1 - point_x2);	// Calculate blending for sensor 2
-
-		//printf("interp_data x: %f, %f, %f, %f\n", interp_data.x, interp_data.y, interp_data.z, interp_data.w);
-
-		return interp_data;
 	};
 
 
-	// Process Mesh
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
-		vector<Vertex> vertices;  // Vertices for mesh
-		vector<unsigned int> indices;  // Element indices for mesh
-		vector<Texture> textures;	// Textures for mesh
-
-		glm::vec4 diffuse_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);  // Diffuse color
+	// Process a mesh's material (textures and diffuse color)
+	void processMaterial(aiMesh* mesh, const aiScene* scene, vector<Texture>& textures, glm::vec4& diffuse_color) {
+		diffuse_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);  // Diffuse color
 
 		// Process materials
 		// Check if material exists and if so, then process and add it to textures vector
@@ -217,6 +537,15 @@ private:
 			//diffuseMaps.clear();
 			//specularMaps.clear();
 		}
+	};
+
+
+	// Process Mesh (no GL calls and no shared state, so meshes can be processed in parallel)
+	Mesh processMesh(aiMesh* mesh, vector<Texture> textures, glm::vec4 diffuse_color) {
+		vector<Vertex> vertices;  // Vertices for mesh
+		vector<unsigned int> indices;  // Element indices for mesh
+		vertices.reserve(mesh->mNumVertices);		// Pre-size (faces are triangles after aiProcess_Triangulate)
+		indices.reserve(mesh->mNumFaces * 3);
 
 		// Loop through vertices and process them
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -246,10 +575,6 @@ private:
 			// Process Diffuse Color
 			vertex.DiffuseColor = diffuse_color;
 
-			// Process interpolation data
-			vertex.interp_data = calcVertexInterp(vertex.Position);
-			//printf("interp_data x: %f, %f, %f, %f\n", vertex.interp_data.x, vertex.interp_data.y, vertex.interp_data.z, vertex.interp_data.w);
-
 			// Push vertex into vector of vertices for mesh
 			vertices.push_back(vertex);
 		}
@@ -263,8 +588,111 @@ private:
 			}
 		}
 
-		// Return Mesh
-		return Mesh(vertices, indices, textures);
+		// Weld duplicate vertices and reorder for the vertex cache and vertex fetch
+		optimizeMesh(vertices, indices, true);
+
+		// Create Mesh (vectors are moved in) and its simplified levels of detail (uploaded later)
+		Mesh result(std::move(vertices), std::move(indices), std::move(textures));
+		buildLODs(result, result.vertices, result.indices, diffuse_color);
+
+		// Sensor interpolation of every level, at the final vertex positions and order
+		result.interp.resize(1 + result.pendingLODs.size());
+		interpolate(result.vertices, result.interp[0]);
+		for (unsigned int i = 0; i < result.pendingLODs.size(); i++) {
+			interpolate(result.pendingLODs[i].vertices, result.interp[i + 1]);
+		}
+
+		// Index triangles for picking (only if positions are kept)
+		if (residency != MESH_RELEASE) {
+			result.buildTriangleBVH();
+		}
+
+		// Return Mesh (moved out)
+		return result;
+	};
+
+
+	// Optimize a mesh's buffers (weld = merge identical vertices first) and print the before / after
+	// average cache miss ratio (ACMR, vertices transformed per triangle) and buffer sizes
+	void optimizeMesh(vector<Vertex>& vertices, vector<unsigned int>& indices, bool weld) {
+		float acmr_before = MeshOptimizer::calcACMR(indices, (int)vertices.size());
+		size_t vertex_bytes = vertices.size() * sizeof(Vertex);
+		size_t index_bytes = indices.size() * sizeof(unsigned int);
+
+		if (weld) {
+			MeshOptimizer::weld(vertices, indices);
+		}
+		MeshOptimizer::vertexCache(indices, (int)vertices.size());
+		MeshOptimizer::vertexFetch(vertices, indices);
+
+		float acmr_after = MeshOptimizer::calcACMR(indices, (int)vertices.size());
+		size_t index_size = vertices.size() < 65536 ? sizeof(unsigned short) : sizeof(unsigned int);  // Matches Mesh::setupLOD
+		printf("Mesh optimized: ACMR %.3f -> %.3f, vertex buffer %.1f -> %.1f KB, index buffer %.1f -> %.1f KB\n",
+			acmr_before, acmr_after, vertex_bytes / 1024.0, vertices.size() * sizeof(Vertex) / 1024.0,
+			index_bytes / 1024.0, indices.size() * index_size / 1024.0);
+	};
+
+
+	// Sensor interpolation of each vertex (kept apart from the vertices, it has its own buffer)
+	void interpolate(const vector<Vertex>& vertices, vector<VertexInterp>& interp) {
+		interp.resize(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			layout.interp(vertices[i].Position, interp[i].index, interp[i].weight);
+		}
+	};
+
+
+	// Build simplified levels of detail for a mesh with quadric error simplification
+	// Each level keeps the material color (sensor interpolation is computed for its vertex positions afterwards)
+	void buildLODs(Mesh& mesh, vector<Vertex>& vertices, vector<unsigned int>& indices, glm::vec4 diffuse_color) {
+		// Positions for the simplifier
+		vector<glm::vec3> positions(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			positions[i] = vertices[i].Position;
+		}
+
+		int full_tris = (int)indices.size() / 3;	// Triangles in the full mesh
+		int prev_tris = full_tris;					// Triangles in the last level
+		for (int l = 0; l < LOD_MAX_LEVELS - 1; l++) {
+			int target = (int)(full_tris * LOD_RATIOS[l]);
+			if (target < LOD_MIN_TRIANGLES) {
+				break;
+			}
+
+			// Simplify from the full mesh so errors don't stack up
+			vector<glm::vec3> lod_positions;
+			vector<unsigned int> lod_indices;
+			vector<int> lod_source;
+			float error = MeshSimplifier::simplify(positions, indices, target, lod_positions, lod_indices, lod_source);
+
+			// Stop if the mesh couldn't be simplified much more (boundaries and flips block collapses)
+			int lod_tris = (int)lod_indices.size() / 3;
+			if (lod_tris == 0 || lod_tris > prev_tris * 0.8f) {
+				break;
+			}
+
+			// Build vertices
+			vector<Vertex> lod_vertices(lod_positions.size());
+			for (unsigned int i = 0; i < lod_positions.size(); i++) {
+				Vertex vertex = vertices[lod_source[i]];	// Normal and texture coords from the source vertex
+				vertex.Position = lod_positions[i];
+				vertex.originalPosition = lod_positions[i];
+				vertex.DiffuseColor = diffuse_color;		// Material color
+				lod_vertices[i] = vertex;
+			}
+			optimizeMesh(lod_vertices, lod_indices, false);
+
+			mesh.addLOD(lod_vertices, lod_indices, error);
+			prev_tris = lod_tris;
+		}
+
+		// Print level of detail triangle counts (one printf, so lines of meshes processed in parallel don't interleave)
+		char line[256];
+		int length = snprintf(line, sizeof(line), "Mesh LODs: %d", full_tris);
+		for (unsigned int i = 0; i < mesh.pendingLODs.size() && length < (int)sizeof(line); i++) {
+			length += snprintf(line + length, sizeof(line) - length, " %u", (unsigned int)mesh.pendingLODs[i].indices.size() / 3);
+		}
+		printf("%s triangles\n", line);
 	};
 
 
@@ -288,10 +716,10 @@ private:
 				}
 			}
 
-			// If the texture isn't already loaded, then we need to load it
+			// If the texture isn't already loaded, then we need to load it (on upload)
 			if (!skip) {
 				Texture texture;					// Create new texture to push onto vector
-				texture.id = TextureFromFile(str.C_Str(), directory);  // Load texture from directory
+				texture.id = 0;						// Loaded from directory by upload()
 				texture.type = typeName;		// Texture type name
 				texture.path = str.C_Str();				// Texture file path
 				textures.push_back(texture);	// Push texture onto textures vector
@@ -330,7 +758,7 @@ private:
 				format = GL_RGBA;
 			}
 			
-			glBindTexture(GL_TEXTURE_2D, textureID);  // Bind texture
+			GLState::bindTexture(0, GL_TEXTURE_2D, textureID);  // Bind texture
 			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);  // Attach texture image to texture
 			glGenerateMipmap(GL_TEXTURE_2D);	// Generate mipmap
 
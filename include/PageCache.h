@@ -0,0 +1,376 @@
+#pragma once
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include "stb_image.h"
+
+#include "GLState.h"
+#include "KTXTexture.h"
+#include "MappedFile.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Page texture residency
+struct PageTexture {
+	unsigned int id;			// Texture id (0 = not resident)
+	size_t bytes;				// Texture memory (with mips)
+	unsigned long lastUsed;		// Frame the texture was last drawn (or uploaded)
+	bool queued;				// Waiting for the background loader
+	bool wanted;				// Drawn while not resident (uploaded as soon as it's loaded)
+	bool failed;				// Couldn't be loaded (not retried)
+};
+
+// Page read by the background loader, waiting to be uploaded
+struct DecodedPage {
+	std::string path;			// Image path
+	MappedFile* baked;			// Mapped KTX file (NULL if the image was decoded instead)
+	unsigned char* pixels;		// Decoded image (stb_image)
+	int width, height;			// Image size
+	int channels;				// Image channels
+};
+
+
+// Page Cache
+// GUI page textures, loaded on first use and kept under a GPU memory budget (least recently drawn pages are
+// evicted first). Pages are read by a background thread, which maps the baked KTX file (touching every page
+// so it's read from disk) or decodes the image, and update() uploads finished pages on the GL thread. Pages
+// can be prefetched; one drawn before it's resident is moved to the front of the loader's queue and drawn
+// with a placeholder until it's uploaded, so the render thread never waits on the disk.
+class PageCache {
+public:
+	// Constructor
+	// budget = texture memory pages may use (bytes). uploads_per_frame = prefetched pages uploaded per update
+	PageCache(size_t budget, int uploads_per_frame = 1) {
+		budgetBytes = budget;
+		uploadsPerFrame = uploads_per_frame;
+		residentBytes = 0;
+		frame = 0;
+		placeholder = 0;
+
+		// Start loader
+		running = true;
+		worker = std::thread(&PageCache::run, this);
+	};
+
+	// Destructor
+	~PageCache() {
+		stop();
+	};
+
+
+	// Texture for a page. Marks it used this frame. If it isn't resident it's loaded next and the
+	// placeholder is returned until update() uploads it (GL thread)
+	unsigned int acquire(const std::string& path) {
+		PageTexture& page = pages[path];
+		page.lastUsed = frame;
+		if (page.id != 0) {
+			return page.id;
+		}
+		if (!page.failed && !page.wanted) {
+			page.wanted = true;
+			request(path, page, true);
+		}
+		return placeholderTexture();
+	};
+
+
+	// Queue a page for background loading (does nothing if it's resident or already queued)
+	void prefetch(const std::string& path) {
+		PageTexture& page = pages[path];
+		if (page.id != 0 || page.failed) {
+			return;
+		}
+		request(path, page, false);
+	};
+
+
+	// Once per frame. Uploads the pages being drawn and a few prefetched ones, then evicts down to the budget
+	void update() {
+		frame++;
+
+		// Upload pages the loader has finished (every page waiting to be drawn, prefetched ones up to the limit)
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			ready.insert(ready.end(), finished.begin(), finished.end());
+			finished.clear();
+		}
+		int uploads = 0;
+		for (std::deque<DecodedPage*>::iterator it = ready.begin(); it != ready.end();) {
+			DecodedPage* decoded = *it;
+			PageTexture& page = pages[decoded->path];
+			if (!page.wanted && uploads >= uploadsPerFrame) {
+				++it;
+				continue;
+			}
+			it = ready.erase(it);
+			if (page.id != 0) {
+				freeDecoded(decoded);  // Already resident
+				continue;
+			}
+			if (!page.wanted) {
+				uploads++;
+			}
+			upload(decoded, page);
+			page.lastUsed = frame;
+		}
+
+		evict();
+	};
+
+
+	// Texture memory in use by pages
+	size_t resident() {
+		return residentBytes;
+	};
+
+
+	// Stop the loader thread
+	void stop() {
+		if (!running) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			running = false;
+		}
+		queueCond.notify_one();
+		if (worker.joinable()) {
+			worker.join();
+		}
+	};
+
+
+	// Delete every page texture and anything still waiting
+	void clearPages() {
+		stop();
+		for (std::map<std::string, PageTexture>::iterator it = pages.begin(); it != pages.end(); ++it) {
+			if (it->second.id != 0) {
+				GLState::deleteTexture(it->second.id);
+			}
+		}
+		pages.clear();
+		residentBytes = 0;
+		if (placeholder != 0) {
+			GLState::deleteTexture(placeholder);
+			placeholder = 0;
+		}
+		finished.insert(finished.end(), ready.begin(), ready.end());
+		for (unsigned int i = 0; i < finished.size(); i++) {
+			freeDecoded(finished[i]);
+		}
+		finished.clear();
+		ready.clear();
+	};
+
+
+private:
+	std::map<std::string, PageTexture> pages;	// Every page seen, by path
+	size_t budgetBytes;							// Texture memory budget
+	size_t residentBytes;						// Texture memory in use
+	int uploadsPerFrame;						// Prefetched pages uploaded per update
+	unsigned long frame;						// Frame counter (for LRU)
+	unsigned int placeholder;					// Drawn for pages that aren't resident yet (0 = not created)
+	std::deque<DecodedPage*> ready;				// Loaded pages waiting for upload (GL thread only)
+
+	// Thread data
+	std::thread worker;							// Loader thread
+	std::atomic<bool> running;					// Is the loader running?
+	std::mutex queueMutex;						// Guards requests and finished
+	std::condition_variable queueCond;			// Signals new requests
+	std::deque<std::string> requests;			// Pages to load (pages being drawn first)
+	std::vector<DecodedPage*> finished;			// Pages the loader finished
+
+
+	// Loader loop
+	void run() {
+		while (true) {
+			std::string path;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCond.wait(lock, [this] { return !running || !requests.empty(); });
+				if (!running) {
+					return;
+				}
+				path = requests.front();
+				requests.pop_front();
+			}
+
+			DecodedPage* decoded = decode(path);
+
+			std::lock_guard<std::mutex> lock(queueMutex);
+			finished.push_back(decoded);
+		}
+	};
+
+
+	// Read a page (no GL calls, so it can run on the loader thread)
+	DecodedPage* decode(const std::string& path) {
+		DecodedPage* decoded = new DecodedPage();
+		decoded->path = path;
+		decoded->baked = NULL;
+		decoded->pixels = NULL;
+
+		// Baked texture. Touch every page of the mapping so the upload doesn't wait on the disk
+		MappedFile* baked = new MappedFile();
+		if (baked->open(ktxPath(path).c_str())) {
+			volatile unsigned char sum = 0;
+			for (size_t i = 0; i < baked->size(); i += 4096) {
+				sum += baked->data()[i];
+			}
+			decoded->baked = baked;
+			return decoded;
+		}
+		delete baked;
+
+		// Source image
+		decoded->pixels = stbi_load(path.c_str(), &decoded->width, &decoded->height, &decoded->channels, 0);
+		return decoded;
+	};
+
+
+	// Queue a page for the loader. urgent = it's being drawn, so it goes first (moved up if it's already queued)
+	void request(const std::string& path, PageTexture& page, bool urgent) {
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (page.queued) {
+				if (!urgent) {
+					return;
+				}
+				for (std::deque<std::string>::iterator it = requests.begin(); it != requests.end(); ++it) {
+					if (*it == path) {
+						requests.erase(it);
+						requests.push_front(path);
+						break;
+					}
+				}
+				return;  // Not found = the loader already has it
+			}
+			page.queued = true;
+			if (urgent) {
+				requests.push_front(path);
+			} else {
+				requests.push_back(path);
+			}
+		}
+		queueCond.notify_one();
+	};
+
+
+	// 1x1 grey texture drawn in place of pages that aren't resident yet (created on first use)
+	unsigned int placeholderTexture() {
+		if (placeholder == 0) {
+			const unsigned char grey[4] = { 128, 128, 128, 255 };
+			glGenTextures(1, &placeholder);
+			GLState::bindTexture(0, GL_TEXTURE_2D, placeholder);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);  // No mips
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+		}
+		return placeholder;
+	};
+
+
+	// Create the texture for a loaded page (GL thread), then free the loaded data
+	void upload(DecodedPage* decoded, PageTexture& page) {
+		page.queued = false;
+		page.wanted = false;
+		page.id = 0;
+		page.bytes = 0;
+
+		// Baked texture
+		if (decoded->baked != NULL) {
+			page.id = KTXTexture::upload(decoded->baked->data(), decoded->baked->size(), ktxPath(decoded->path), page.bytes);
+		}
+
+		// Source image (or baked texture that couldn't be used)
+		if (page.id == 0) {
+			if (decoded->baked != NULL && decoded->pixels == NULL) {
+				decoded->pixels = stbi_load(decoded->path.c_str(), &decoded->width, &decoded->height, &decoded->channels, 0);
+			}
+			page.id = textureFromPixels(decoded);
+			if (page.id != 0) {
+				page.bytes = (size_t)decoded->width * decoded->height * decoded->channels * 4 / 3;  // Level 0 plus mips
+			}
+		}
+
+		page.failed = (page.id == 0);
+		residentBytes += page.bytes;
+		freeDecoded(decoded);
+	};
+
+
+	// Texture from decoded pixels (0 if the image didn't load)
+	unsigned int textureFromPixels(DecodedPage* decoded) {
+		if (!decoded->pixels) {
+			printf("Texture failed to load at path: %s\n", decoded->path.c_str());
+			return 0;
+		}
+
+		// Figure out image format based on num channels
+		GLenum format = GL_RGBA;
+		if (decoded->channels == 1) {
+			format = GL_RED;
+		} else if (decoded->channels == 3) {
+			format = GL_RGB;
+		}
+
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		GLState::bindTexture(0, GL_TEXTURE_2D, textureID);  // Bind texture
+		glTexImage2D(GL_TEXTURE_2D, 0, format, decoded->width, decoded->height, 0, format, GL_UNSIGNED_BYTE, decoded->pixels);  // Attach texture image to texture
+		glGenerateMipmap(GL_TEXTURE_2D);	// Generate mipmap
+
+		// Set texture wraping / filtering options
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Texture wrapping for s coord
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  // Texture wrapping for t coord
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);  // Texture filtering when downscaling
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);  // Texture filtering for upscaling
+		GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+		return textureID;
+	};
+
+
+	// Free a loaded page
+	void freeDecoded(DecodedPage* decoded) {
+		if (decoded->pixels) {
+			stbi_image_free(decoded->pixels);
+		}
+		delete decoded->baked;  // Unmaps the file
+		delete decoded;
+	};
+
+
+	// Evict least recently drawn pages until under budget (pages drawn this frame are kept)
+	void evict() {
+		while (residentBytes > budgetBytes) {
+			PageTexture* oldest = NULL;
+			for (std::map<std::string, PageTexture>::iterator it = pages.begin(); it != pages.end(); ++it) {
+				PageTexture& page = it->second;
+				if (page.id != 0 && page.lastUsed + 1 < frame && (oldest == NULL || page.lastUsed < oldest->lastUsed)) {
+					oldest = &page;
+				}
+			}
+			if (oldest == NULL) {
+				return;  // Everything resident is in use
+			}
+			GLState::deleteTexture(oldest->id);
+			oldest->id = 0;
+			residentBytes -= oldest->bytes;
+			oldest->bytes = 0;
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,307 @@
+#pragma once
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "GLState.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+
+const int RENDER_QUEUE_RESERVE = 1024;		// Items allocated up front (the queue only grows past this)
+
+// Passes, submitted in this order
+enum Render_Pass {
+	RENDER_PASS_MODEL,		// 3D model (depth tested, front to back)
+	RENDER_PASS_GUI,		// Page textures (painter's order)
+	RENDER_PASS_OVERLAY,	// Charts over the pages
+	RENDER_PASS_TEXT,		// Text over everything (blended)
+	RENDER_NUM_PASSES
+};
+
+// What an item draws
+enum Render_Draw {
+	RENDER_DRAW_ELEMENTS,	// Instanced indexed triangles from a vertex array
+	RENDER_DRAW_QUAD,		// Textured GUI quad (4 vertex triangle strip, placed by a transformation)
+	RENDER_DRAW_OBJECT		// An object's own draw(shader) (charts, text)
+};
+
+// One recorded draw
+struct RenderItem {
+	Render_Draw type;			// What it draws
+	Shader* shader;				// Program
+	unsigned int vertexArray;	// Vertex array (elements and quads)
+	unsigned int texture;		// 2D texture on unit 0 (0 = none)
+	GLenum indexType;			// Index type (elements)
+	int count;					// Indices (elements)
+	int instances;				// Instances (elements)
+	glm::mat4 transform;		// Transformation (quads)
+	void* object;				// Object drawn by callback (objects)
+	void (*callback)(void* object, Shader& shader);
+};
+
+// Sort key and the item it belongs to (sorted instead of the items, which are much larger)
+struct RenderSortEntry {
+	uint64_t key;
+	uint32_t item;
+};
+
+// Counters for the last submit
+struct RenderQueueStats {
+	int items;				// Items submitted
+	int programChanges;		// Times the program changed between items
+	int textureChanges;		// Times the texture changed between items
+	int vertexArrayChanges;	// Times the vertex array changed between items
+};
+
+
+// Render Queue
+// Draws are recorded with a 64 bit sort key, sorted once per frame with a radix sort, and submitted in key order.
+// Key, from the top bit down:
+//   pass (4) | program (8) | texture (16) | depth (20) | vertex array (16)     for the model pass
+//   pass (4) | layer (20) | program (8) | texture (16) | vertex array (16)     for the GUI passes
+// So the model pass is grouped by program, then texture, and goes front to back within a group (every mesh level
+// has its own vertex array, so vertex array switches can't be saved there and it only breaks ties). GUI items keep
+// their painter's order (layer) and are only grouped where they share a layer. Programs,
+// textures and vertex arrays are keyed by their GL names (masked to the field, so a clash only costs a switch).
+// The sort is stable, so items with equal keys are drawn in the order they were recorded.
+class RenderQueue {
+public:
+	RenderQueueStats stats;		// Counters for the last submit
+
+	// Constructor
+	RenderQueue() {
+		items.reserve(RENDER_QUEUE_RESERVE);
+		entries.reserve(RENDER_QUEUE_RESERVE);
+		scratch.reserve(RENDER_QUEUE_RESERVE);
+		stats = RenderQueueStats();
+	};
+
+
+	// Start recording (keeps capacity)
+	void clear() {
+		items.clear();
+		entries.clear();
+		layer = 0;
+	};
+
+
+	// Start a new GUI layer (items added after it are drawn over the ones before)
+	void nextLayer() {
+		layer++;
+	};
+
+
+	// Record an instanced indexed draw. depth = distance from the camera (model pass draws front to back)
+	void addElements(Render_Pass pass, Shader& shader, unsigned int vertex_array, GLenum index_type, int count, int instances, float depth) {
+		RenderItem item;
+		item.type = RENDER_DRAW_ELEMENTS;
+		item.shader = &shader;
+		item.vertexArray = vertex_array;
+		item.texture = 0;
+		item.indexType = index_type;
+		item.count = count;
+		item.instances = instances;
+		item.object = NULL;
+		item.callback = NULL;
+		add(pass, item, depth);
+	};
+
+
+	// Record a GUI quad
+	void addQuad(Render_Pass pass, Shader& shader, unsigned int vertex_array, unsigned int texture, const glm::mat4& transform) {
+		RenderItem item;
+		item.type = RENDER_DRAW_QUAD;
+		item.shader = &shader;
+		item.vertexArray = vertex_array;
+		item.texture = texture;
+		item.indexType = 0;
+		item.count = 4;
+		item.instances = 1;
+		item.transform = transform;
+		item.object = NULL;
+		item.callback = NULL;
+		add(pass, item, 0.0f);
+	};
+
+
+	// Record an object that draws itself with draw(Shader&) (it sets its own textures and uniforms)
+	template <typename T>
+	void addObject(Render_Pass pass, Shader& shader, T* object) {
+		RenderItem item;
+		item.type = RENDER_DRAW_OBJECT;
+		item.shader = &shader;
+		item.vertexArray = 0;
+		item.texture = 0;
+		item.indexType = 0;
+		item.count = 0;
+		item.instances = 0;
+		item.object = object;
+		item.callback = &drawObject<T>;
+		add(pass, item, 0.0f);
+	};
+
+
+	// Sort by key (LSD radix sort, one byte per pass. Bytes that are the same in every key are skipped)
+	void sort() {
+		size_t n = entries.size();
+		if (n < 2) {
+			return;
+		}
+		scratch.resize(n);
+		RenderSortEntry* src = &entries[0];
+		RenderSortEntry* dst = &scratch[0];
+		bool swapped = false;
+		for (int shift = 0; shift < 64; shift += 8) {
+			size_t counts[256] = { 0 };
+			for (size_t i = 0; i < n; i++) {
+				counts[(src[i].key >> shift) & 0xFF]++;
+			}
+			if (counts[(src[0].key >> shift) & 0xFF] == n) {
+				continue;  // Every key has this byte
+			}
+
+			// Start of each byte value's run, then scatter (in order, so the sort is stable)
+			size_t offset = 0;
+			for (int b = 0; b < 256; b++) {
+				size_t c = counts[b];
+				counts[b] = offset;
+				offset += c;
+			}
+			for (size_t i = 0; i < n; i++) {
+				dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+			}
+			std::swap(src, dst);
+			swapped = !swapped;
+		}
+		if (swapped) {
+			entries.swap(scratch);  // Sorted entries ended up in the scratch buffer
+		}
+	};
+
+
+	// Submit the sorted items of passes first_pass to last_pass. Each pass sets the depth test and blending it needs
+	void submit(Render_Pass first_pass, Render_Pass last_pass) {
+		stats = RenderQueueStats();
+		int pass = -1;
+		Shader* shader = NULL;
+		unsigned int texture = 0;
+		unsigned int vertex_array = 0;
+		for (size_t i = 0; i < entries.size(); i++) {
+			int item_pass = (int)(entries[i].key >> 60);
+			if (item_pass < first_pass || item_pass > last_pass) {
+				continue;
+			}
+			RenderItem& item = items[entries[i].item];
+			if (item_pass != pass) {
+				beginPass((Render_Pass)item_pass);
+				pass = item_pass;
+			}
+
+			// Program (GLState drops it if it's already in use)
+			if (shader == NULL || item.shader->programID != shader->programID) {
+				stats.programChanges++;
+			}
+			shader = item.shader;
+			shader->use();
+
+			stats.items++;
+			switch (item.type) {
+			case RENDER_DRAW_ELEMENTS:
+				countBinds(item, texture, vertex_array);
+				GLState::bindVertexArray(item.vertexArray);
+				glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)item.count, item.indexType, 0, item.instances);
+				break;
+			case RENDER_DRAW_QUAD:
+				countBinds(item, texture, vertex_array);
+				shader->setInt("texture0", 0);
+				shader->setMat4("transformation", item.transform);
+				GLState::bindTexture(0, GL_TEXTURE_2D, item.texture);
+				GLState::bindVertexArray(item.vertexArray);
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, item.count);
+				break;
+			case RENDER_DRAW_OBJECT:
+				item.callback(item.object, *shader);
+				texture = vertex_array = 0;  // Unknown after the object's draw
+				break;
+			}
+		}
+	};
+
+
+	// Items recorded
+	int size() {
+		return (int)items.size();
+	};
+
+
+private:
+	std::vector<RenderItem> items;			// Recorded draws
+	std::vector<RenderSortEntry> entries;	// Keys (sorted by sort())
+	std::vector<RenderSortEntry> scratch;	// Radix sort buffer
+	uint64_t layer;							// Current GUI layer
+
+
+	// Build the item's key and record it
+	void add(Render_Pass pass, const RenderItem& item, float depth) {
+		uint64_t program = item.shader->programID & 0xFF;
+		uint64_t texture = item.texture & 0xFFFF;
+		uint64_t vertex_array = item.vertexArray & 0xFFFF;
+		uint64_t key = (uint64_t)pass << 60;
+		if (pass == RENDER_PASS_MODEL) {
+			float d = std::min(std::max(depth / FAR_PLANE, 0.0f), 1.0f);
+			key |= program << 52 | texture << 36 | (uint64_t)(d * 0xFFFFF) << 16 | vertex_array;
+		} else {
+			key |= (layer & 0xFFFFF) << 40 | program << 32 | texture << 16 | vertex_array;
+		}
+
+		RenderSortEntry entry;
+		entry.key = key;
+		entry.item = (uint32_t)items.size();
+		entries.push_back(entry);
+		items.push_back(item);
+	};
+
+
+	// State a pass draws with
+	void beginPass(Render_Pass pass) {
+		if (pass == RENDER_PASS_MODEL) {
+			GLState::enable(GL_DEPTH_TEST);
+			GLState::disable(GL_BLEND);
+		} else if (pass == RENDER_PASS_TEXT) {
+			GLState::disable(GL_DEPTH_TEST);  // The text renderer turns blending on
+		} else {
+			GLState::disable(GL_DEPTH_TEST);
+			GLState::disable(GL_BLEND);		// Pages are opaque
+		}
+	};
+
+
+	// Count texture and vertex array changes
+	void countBinds(const RenderItem& item, unsigned int& texture, unsigned int& vertex_array) {
+		if (item.type == RENDER_DRAW_QUAD && item.texture != texture) {
+			stats.textureChanges++;
+			texture = item.texture;
+		}
+		if (item.vertexArray != vertex_array) {
+			stats.vertexArrayChanges++;
+			vertex_array = item.vertexArray;
+		}
+	};
+
+
+	// Callback for addObject
+	template <typename T>
+	static void drawObject(void* object, Shader& shader) {
+		((T*)object)->draw(shader);
+	};
+};
+
+#endif
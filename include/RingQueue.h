@@ -0,0 +1,59 @@
+#pragma once
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+
+// Ring Queue
+// Lock-free single producer / single consumer queue with a fixed capacity (N must be a power of 2).
+// push() and pop() never block or allocate. push() fails when the queue is full.
+template <typename T, int N>
+class RingQueue {
+public:
+	// Constructor
+	RingQueue() : headIndex(0), tailIndex(0) {};
+
+
+	// Add an item (producer thread). Returns false if the queue is full
+	bool push(const T& item) {
+		size_t tail = tailIndex.load(std::memory_order_relaxed);
+		size_t head = headIndex.load(std::memory_order_acquire);
+		if (tail - head >= (size_t)N) {
+			return false;
+		}
+		items[tail & (N - 1)] = item;
+		tailIndex.store(tail + 1, std::memory_order_release);  // Publish the item
+		return true;
+	};
+
+
+	// Take the oldest item (consumer thread). Returns false if the queue is empty
+	bool pop(T& item) {
+		size_t head = headIndex.load(std::memory_order_relaxed);
+		size_t tail = tailIndex.load(std::memory_order_acquire);
+		if (head == tail) {
+			return false;
+		}
+		item = items[head & (N - 1)];
+		headIndex.store(head + 1, std::memory_order_release);  // Free the slot
+		return true;
+	};
+
+
+	// Number of items (approximate while the other thread is working)
+	size_t size() {
+		return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+	};
+
+
+private:
+	static_assert((N & (N - 1)) == 0, "RingQueue size must be a power of 2");
+
+	T items[N];										// Slots
+	alignas(64) std::atomic<size_t> headIndex;		// Next item to pop (written by the consumer)
+	alignas(64) std::atomic<size_t> tailIndex;		// Next slot to push (written by the producer)
+};
+
+#endif
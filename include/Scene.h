@@ -0,0 +1,145 @@
+#pragma once
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "FrameArena.h"
+#include "Model.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+
+#include <float.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Scene
+// Many structures placed in the world. Each model file is loaded (and its geometry uploaded) once and
+// shared by every instance of it. Each instance has its own transform and its own range of the sensor
+// buffers, so every structure is drawn with one instanced draw per mesh but shows its own sensor data.
+class Scene {
+public:
+	CullStats stats;		// Culling counters for the last addDraws (summed over models)
+
+	// Load a model, or return the already loaded one for this path. Returns the model index.
+	// Instances of the same model share its sensor layout, but each has its own sensor values.
+	// residency = what each mesh keeps in RAM after upload
+	int loadModel(std::string path, SensorLayout layout, Mesh_Residency residency = MESH_KEEP_POSITIONS) {
+		std::map<std::string, int>::iterator found = modelIndex.find(path);
+		if (found != modelIndex.end()) {
+			return found->second;
+		}
+
+		return addModel(path, new Model(path, std::move(layout), residency));
+	};
+
+
+	// Add a model that was loaded and uploaded elsewhere (e.g. by startup tasks). The scene takes ownership.
+	// Returns the model index
+	int addModel(std::string path, Model* model) {
+		models.push_back(model);
+		instances.push_back(std::vector<ModelInstance>());
+		modelIndex[path] = (int)models.size() - 1;
+		return (int)models.size() - 1;
+	};
+
+
+	// Place an instance of a model. Its sensors get the next free range of the sensor buffers.
+	// Returns the index of the instance's first sensor.
+	int addInstance(int model, glm::mat4 transform) {
+		ModelInstance instance;
+		instance.transform = transform;
+		instance.inverseTransform = glm::inverse(transform);
+		instance.sensorOffset = totalSensors;
+		instances[model].push_back(instance);
+
+		totalSensors += models[model]->numSensors();
+		return instance.sensorOffset;
+	};
+
+
+	// Loaded model by index
+	Model* getModel(int index) {
+		return models[index];
+	};
+
+
+	// Instances of a model in the scene (transforms and sensor ranges. Empty if the model isn't in the scene)
+	const std::vector<ModelInstance>& instancesOf(const Model* model) {
+		static const std::vector<ModelInstance> none;
+		for (unsigned int i = 0; i < models.size(); i++) {
+			if (models[i] == model) {
+				return instances[i];
+			}
+		}
+		return none;
+	};
+
+
+	// Closest instance hit by a ray (world space), e.g. from Ray::fromScreen. Returns false if nothing is hit
+	bool pick(const Ray& ray, PickHit& hit) {
+		hit.model = -1;
+		hit.distance = FLT_MAX;
+		for (unsigned int i = 0; i < models.size(); i++) {
+			if (!instances[i].empty() && models[i]->pick(ray, instances[i], hit)) {
+				hit.model = (int)i;
+			}
+		}
+		return hit.model >= 0;
+	};
+
+
+	// Total sensors over every instance (size of the sensor buffers)
+	int numSensors() {
+		return totalSensors;
+	};
+
+
+	// Record every instance of every model in the queue (the model pass)
+	// view_projection = projection * view. camera_pos and pixels_per_unit pick levels of detail (see Model::addDraws)
+	// arena = per-frame scratch memory
+	void addDraws(RenderQueue& queue, Shader& shader, const glm::mat4& view_projection, glm::vec3 camera_pos, float pixels_per_unit, FrameArena& arena) {
+		stats.meshesDrawn = 0;
+		stats.meshesCulled = 0;
+		stats.trianglesDrawn = 0;
+		stats.trianglesCulled = 0;
+
+		for (unsigned int i = 0; i < models.size(); i++) {
+			if (instances[i].empty()) {
+				continue;
+			}
+			models[i]->addDraws(queue, shader, view_projection, camera_pos, pixels_per_unit, instances[i], arena);
+			stats.meshesDrawn += models[i]->stats.meshesDrawn;
+			stats.meshesCulled += models[i]->stats.meshesCulled;
+			stats.trianglesDrawn += models[i]->stats.trianglesDrawn;
+			stats.trianglesCulled += models[i]->stats.trianglesCulled;
+		}
+	};
+
+
+	// Clear scene
+	void clearScene() {
+		for (unsigned int i = 0; i < models.size(); i++) {
+			models[i]->clearModel();  // Clear memory in model
+			delete models[i];
+		}
+		models.clear();
+		instances.clear();
+		modelIndex.clear();
+		totalSensors = 0;
+	};
+
+
+private:
+	std::vector<Model*> models;								// Loaded models (shared geometry)
+	std::vector<std::vector<ModelInstance>> instances;		// Instances of each model
+	std::map<std::string, int> modelIndex;					// Model index by path
+	int totalSensors = 0;									// Sensors over every instance
+};
+
+#endif
@@ -0,0 +1,128 @@
+#pragma once
+#ifndef SENSOR_BUFFER_H
+#define SENSOR_BUFFER_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include "GLState.h"
+
+#include <algorithm>
+#include <vector>
+
+
+// Sensor Buffer
+// Per-sensor values stored in a texture buffer object so shaders can look up any channel with texelFetch.
+// Values are shadowed on the CPU and only the range of channels that changed is uploaded, with one
+// glBufferSubData per frame. Size is only limited by GL_MAX_TEXTURE_BUFFER_SIZE (at least 65536).
+class SensorBuffer {
+public:
+	// Constructor
+	// num_values = number of sensors, num_components = floats per sensor (1 = R32F, 2 = RG32F, 4 = RGBA32F)
+	SensorBuffer(int num_values, int num_components = 1) {
+		numComponents = num_components;
+		values.assign(num_values * num_components, 0.0f);
+		dirtyMin = (int)values.size();		// Nothing dirty
+		dirtyMax = 0;
+		setupBuffer();
+	};
+
+
+	// Set one sensor's value(s). Only marks it dirty if it changed.
+	void set(int index, const float* value) {
+		int start = index * numComponents;
+		for (int c = 0; c < numComponents; c++) {
+			if (values[start + c] != value[c]) {
+				values[start + c] = value[c];
+				markDirty(start + c);
+			}
+		}
+	};
+
+	// Set one single component sensor value
+	void set(int index, float value) {
+		set(index, &value);
+	};
+
+	// Set every sensor from a vector (num_values * num_components floats). Only changed channels are marked dirty.
+	void setAll(const std::vector<float>& new_values) {
+		int count = std::min((int)new_values.size(), (int)values.size());
+		for (int i = 0; i < count; i++) {
+			if (values[i] != new_values[i]) {
+				values[i] = new_values[i];
+				markDirty(i);
+			}
+		}
+	};
+
+
+	// Upload the changed range to the GPU (one sub-upload, or none if nothing changed)
+	void upload() {
+		if (dirtyMin > dirtyMax) {
+			return;
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, VBO);  // Bind buffer
+		glBufferSubData(GL_TEXTURE_BUFFER, dirtyMin * sizeof(float), (dirtyMax - dirtyMin + 1) * sizeof(float), &values[dirtyMin]);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);  // Unbind buffer
+		dirtyMin = (int)values.size();
+		dirtyMax = 0;
+	};
+
+
+	// Bind the buffer texture to a texture unit (skipped if it's still bound there)
+	void bind(int unit) {
+		GLState::bindTexture(unit, GL_TEXTURE_BUFFER, textureID);  // Bind buffer texture
+	};
+
+
+	// Number of sensors
+	int size() {
+		return (int)values.size() / numComponents;
+	};
+
+
+	// Clear buffer
+	void clearBuffer() {
+		GLState::deleteTexture(textureID);
+		glDeleteBuffers(1, &VBO);
+		values.clear();
+	};
+
+
+private:
+	std::vector<float> values;		// CPU copy of the values
+	int numComponents;				// Floats per sensor
+	int dirtyMin, dirtyMax;			// Range of floats changed since the last upload
+	unsigned int VBO;				// Buffer holding the values
+	unsigned int textureID;			// Buffer texture viewing VBO
+
+
+	// Extend the dirty range
+	void markDirty(int i) {
+		dirtyMin = std::min(dirtyMin, i);
+		dirtyMax = std::max(dirtyMax, i);
+	};
+
+
+	// Set up buffer and buffer texture
+	void setupBuffer() {
+		// Buffer
+		glGenBuffers(1, &VBO);
+		glBindBuffer(GL_TEXTURE_BUFFER, VBO);
+		glBufferData(GL_TEXTURE_BUFFER, values.size() * sizeof(float), values.empty() ? NULL : &values[0], GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		// Buffer texture
+		GLenum format = GL_R32F;
+		if (numComponents == 2) {
+			format = GL_RG32F;
+		} else if (numComponents == 4) {
+			format = GL_RGBA32F;
+		}
+		glGenTextures(1, &textureID);
+		GLState::bindTexture(0, GL_TEXTURE_BUFFER, textureID);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, VBO);
+		GLState::bindTexture(0, GL_TEXTURE_BUFFER, 0);
+	};
+};
+
+#endif
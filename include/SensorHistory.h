@@ -0,0 +1,70 @@
+#pragma once
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <algorithm>
+#include <vector>
+
+
+// Sensor History
+// The last few seconds of sensor frames in a fixed ring (allocated once), for looking up recent values of any sensor.
+class SensorHistory {
+public:
+	// Constructor. num_sensors = floats per frame. capacity = frames kept
+	SensorHistory(int num_sensors, int capacity) {
+		numSensors = num_sensors;
+		maxFrames = capacity;
+		values.resize((size_t)num_sensors * capacity);
+		newest = -1;
+		numFrames = 0;
+	};
+
+
+	// Add a frame (the oldest is overwritten once full)
+	void push(const std::vector<float>& frame) {
+		newest = (newest + 1) % maxFrames;
+		std::copy(frame.begin(), frame.begin() + std::min((int)frame.size(), numSensors), values.begin() + (size_t)newest * numSensors);
+		numFrames = std::min(numFrames + 1, maxFrames);
+	};
+
+
+	// Number of frames held
+	int size() {
+		return numFrames;
+	};
+
+
+	// Value of a sensor age frames ago (0 = newest)
+	float value(int sensor, int age) {
+		int frame = (newest - age + maxFrames) % maxFrames;
+		return values[(size_t)frame * numSensors + sensor];
+	};
+
+
+	// Min, max and mean of a sensor over the frames held
+	void stats(int sensor, float& min, float& max, float& mean) {
+		min = max = mean = 0.0f;
+		if (numFrames == 0) {
+			return;
+		}
+		min = max = value(sensor, 0);
+		double sum = 0.0;
+		for (int age = 0; age < numFrames; age++) {
+			float v = value(sensor, age);
+			min = std::min(min, v);
+			max = std::max(max, v);
+			sum += v;
+		}
+		mean = (float)(sum / numFrames);
+	};
+
+
+private:
+	int numSensors;					// Floats per frame
+	int maxFrames;					// Frames the ring holds
+	std::vector<float> values;		// Frames. [frame][sensor]
+	int newest;						// Ring slot of the newest frame
+	int numFrames;					// Frames held
+};
+
+#endif
@@ -0,0 +1,290 @@
+#pragma once
+#ifndef SENSOR_LAYOUT_H
+#define SENSOR_LAYOUT_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <float.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+const int LAYOUT_MAX_CHANNELS = 4096;	// Highest channel + 1 a layout file may use
+const float LAYOUT_SPAN = 12.0f;		// Default x where the end sensors' values fade out (half the bridge span)
+
+// Sensor on the structure
+struct LayoutSensor {
+	int channel;			// Index in the sensor data
+	glm::vec3 position;		// Object space
+};
+
+// Sensors along one side of the structure. Vertices blend the two sensors on their side that bracket their x
+struct LayoutGroup {
+	std::string name;					// Side name (only used in messages)
+	float maxY;							// Vertices with y below this (and not in an earlier group) are on this side
+	std::vector<LayoutSensor> sensors;	// In decreasing x
+};
+
+// What changed between two layouts, for re-interpolating only the affected vertices
+struct LayoutChange {
+	bool full;							// Sides or span changed (every vertex)
+	std::vector<glm::vec2> ranges;		// Per group, vertices with x in (x, y] (empty when x >= y)
+};
+
+
+// Sensor Layout
+// Where each sensor channel sits on the structure and how vertices blend them for the heatmap and mode shapes.
+// Loaded from a text file:
+//   span <min x> <max x>            x where the end sensors' values fade to zero
+//   group <name> <max y>            starts a side: vertices below max y that aren't on an earlier side
+//   sensor <channel> <x> <y> <z>    sensor on the current side (channel = index in the sensor data)
+// Lines starting with # are comments. Vertices on a side blend the two sensors bracketing their x, linearly.
+class SensorLayout {
+public:
+	// Constructor (empty layout)
+	SensorLayout() {
+		spanMin = -LAYOUT_SPAN;
+		spanMax = LAYOUT_SPAN;
+	};
+
+
+	// Load a layout file. Prints the problem and leaves the layout as it was if the file isn't valid
+	bool load(const char* path) {
+		FILE* file = fopen(path, "r");
+		if (!file) {
+			printf("Sensor layout: can't open %s\n", path);
+			return false;
+		}
+
+		SensorLayout next;
+		char line[256];
+		int line_num = 0;
+		bool ok = true;
+		while (ok && fgets(line, sizeof(line), file)) {
+			line_num++;
+			char name[64];
+			float a, b, c;
+			int channel;
+			if (sscanf(line, " %63s", name) != 1 || name[0] == '#') {
+				continue;  // Blank or comment
+			}
+			if (sscanf(line, " span %f %f", &a, &b) == 2 && a < b) {
+				next.spanMin = a;
+				next.spanMax = b;
+			} else if (sscanf(line, " group %63s %f", name, &a) == 2) {
+				LayoutGroup group;
+				group.name = name;
+				group.maxY = a;
+				next.groups.push_back(group);
+			} else if (sscanf(line, " sensor %d %f %f %f", &channel, &a, &b, &c) == 4 && channel >= 0 && channel < LAYOUT_MAX_CHANNELS
+				&& !next.groups.empty() && !next.hasSensor(channel)) {
+				LayoutSensor sensor;
+				sensor.channel = channel;
+				sensor.position = glm::vec3(a, b, c);
+				next.groups.back().sensors.push_back(sensor);
+				if (channel >= (int)next.channelPositions.size()) {
+					next.channelPositions.resize(channel + 1, glm::vec3(0.0f));
+					next.present.resize(channel + 1, 0);
+				}
+				next.channelPositions[channel] = sensor.position;
+				next.present[channel] = 1;
+			} else {
+				printf("Sensor layout: %s line %d isn't a span, a group or a new sensor on a group: %s", path, line_num, line);
+				ok = false;
+			}
+		}
+		fclose(file);
+		if (!ok) {
+			return false;
+		}
+
+		// Sensors of each side in decreasing x (the order vertices search them in)
+		for (unsigned int i = 0; i < next.groups.size(); i++) {
+			std::sort(next.groups[i].sensors.begin(), next.groups[i].sensors.end(), [](const LayoutSensor& a, const LayoutSensor& b) {
+				return a.position.x > b.position.x || (a.position.x == b.position.x && a.channel < b.channel);
+			});
+		}
+		*this = next;
+		return true;
+	};
+
+
+	// Built-in layout of the demo bridge (used when the layout file can't be loaded)
+	void loadDefault() {
+		static const char* names[3] = { "west", "roof", "east" };
+		static const float max_y[3] = { -1.0f, 1.0f, 1000.0f };
+		static const int counts[3] = { 8, 8, 9 };
+		static const float sensor_x[25] = {
+			7.3316f, 5.215f, 3.1434f, 1.0121f, -1.0337f, -3.1213f, -5.2075f, -9.3968f,					// West
+			7.3032f, 5.1952f, 3.1156f, 1.0298f, -1.0592f, -3.15f, -5.2528f, -7.3376f,					// Roof
+			9.5568f, 7.2941f, 5.1225f, 2.9113f, 0.98272f, -1.0439f, -3.1877f, -5.3186f, -7.4455f };	// East
+		static const glm::vec2 sensor_yz[3] = { glm::vec2(-2.2241f, -0.2f), glm::vec2(0.16036f, 3.70f), glm::vec2(2.3272f, -0.2f) };
+
+		SensorLayout next;
+		int channel = 0;
+		for (int g = 0; g < 3; g++) {
+			LayoutGroup group;
+			group.name = names[g];
+			group.maxY = max_y[g];
+			for (int i = 0; i < counts[g]; i++, channel++) {
+				LayoutSensor sensor;
+				sensor.channel = channel;
+				sensor.position = glm::vec3(sensor_x[channel], sensor_yz[g].x, sensor_yz[g].y);
+				group.sensors.push_back(sensor);  // Already in decreasing x
+				next.channelPositions.push_back(sensor.position);
+				next.present.push_back(1);
+			}
+			next.groups.push_back(group);
+		}
+		*this = next;
+	};
+
+
+	// Channels (highest channel in the layout + 1)
+	int channels() const {
+		return (int)channelPositions.size();
+	};
+
+
+	// Does a channel have a sensor?
+	bool hasSensor(int channel) const {
+		return channel >= 0 && channel < (int)present.size() && present[channel] != 0;
+	};
+
+
+	// Position of a channel's sensor (origin if it has none)
+	glm::vec3 position(int channel) const {
+		return channelPositions[channel];
+	};
+
+
+	// Position of every channel's sensor (origin for channels without one)
+	const std::vector<glm::vec3>& positions() const {
+		return channelPositions;
+	};
+
+
+	// Side a vertex is on (-1 = no sides)
+	int groupOf(float y) const {
+		for (unsigned int i = 0; i < groups.size(); i++) {
+			if (y < groups[i].maxY) {
+				return (int)i;
+			}
+		}
+		return (int)groups.size() - 1;  // Above every limit: last side
+	};
+
+
+	// Sensors blended at a point (object space)
+	// interp_index = channels of the two sensors bracketing x on its side (-1 = none). interp_weight = blending for those sensors
+	void interp(glm::vec3 pos, glm::ivec2& interp_index, glm::vec2& interp_weight) const {
+		interp_index = glm::ivec2(-1, -1);
+		interp_weight = glm::vec2(0.0f);
+		int g = groupOf(pos.y);
+		if (g < 0 || groups[g].sensors.empty()) {
+			return;
+		}
+
+		// First sensor (in decreasing x) the vertex is past
+		const std::vector<LayoutSensor>& sensors = groups[g].sensors;
+		int k = 0;
+		while (k < (int)sensors.size() && pos.x <= sensors[k].position.x) {
+			k++;
+		}
+		float x1 = spanMax;		// x of sensor 1 (span end past the first sensor)
+		float x2 = spanMin;		// x of sensor 2 (span end past the last sensor)
+		if (k > 0) {
+			interp_index.x = sensors[k - 1].channel;
+			x1 = sensors[k - 1].position.x;
+		}
+		if (k < (int)sensors.size()) {
+			interp_index.y = sensors[k].channel;
+			x2 = sensors[k].position.x;
+		}
+
+		// Linear blend between them. All on one sensor if they're at the same x (or the vertex is past a span end)
+		if (x1 - x2 <= 1e-6f) {
+			interp_weight = interp_index.x >= 0 ? glm::vec2(1.0f, 0.0f) : glm::vec2(0.0f, 1.0f);
+			return;
+		}
+		interp_weight.x = (x1 - pos.x) / (x1 - x2);
+		interp_weight.y = (pos.x - x2) / (x1 - x2);
+	};
+
+
+	// Vertices whose interpolation can differ under another layout. A side's vertices only depend on the
+	// sensors bracketing their x, so only the x range between the first and last sensors that differ changes
+	LayoutChange diff(const SensorLayout& next) const {
+		LayoutChange change;
+		change.full = spanMin != next.spanMin || spanMax != next.spanMax || groups.size() != next.groups.size();
+		for (unsigned int i = 0; i < groups.size() && !change.full; i++) {
+			change.full = groups[i].maxY != next.groups[i].maxY;
+		}
+		if (change.full) {
+			return change;
+		}
+
+		for (unsigned int i = 0; i < groups.size(); i++) {
+			const std::vector<LayoutSensor>& a = groups[i].sensors;
+			const std::vector<LayoutSensor>& b = next.groups[i].sensors;
+
+			// Sensors that match from the start and from the end (same channel and x)
+			size_t shortest = std::min(a.size(), b.size());
+			size_t prefix = 0;
+			while (prefix < shortest && same(a[prefix], b[prefix])) {
+				prefix++;
+			}
+			size_t suffix = 0;
+			while (suffix < shortest - prefix && same(a[a.size() - 1 - suffix], b[b.size() - 1 - suffix])) {
+				suffix++;
+			}
+			if (prefix == a.size() && prefix == b.size()) {
+				change.ranges.push_back(glm::vec2(0.0f));  // Unchanged
+				continue;
+			}
+
+			// Vertices past the matching start, and not below the matching end
+			float upper = prefix > 0 ? a[prefix - 1].position.x : FLT_MAX;
+			float lower = suffix > 0 ? a[a.size() - suffix].position.x : -FLT_MAX;
+			change.ranges.push_back(glm::vec2(lower, upper));
+		}
+		return change;
+	};
+
+
+	// Is a vertex at pos in a changed range?
+	bool changed(const LayoutChange& change, glm::vec3 pos) const {
+		if (change.full) {
+			return true;
+		}
+		int g = groupOf(pos.y);
+		return g >= 0 && pos.x > change.ranges[g].x && pos.x <= change.ranges[g].y;
+	};
+
+
+	// Sensors in the layout
+	int numSensors() const {
+		int count = 0;
+		for (unsigned int i = 0; i < groups.size(); i++) {
+			count += (int)groups[i].sensors.size();
+		}
+		return count;
+	};
+
+
+private:
+	std::vector<LayoutGroup> groups;			// Sides, in the order vertices are tested against their max y
+	float spanMin, spanMax;						// x where the end sensors' values fade out
+	std::vector<glm::vec3> channelPositions;	// Sensor position per channel
+	std::vector<char> present;					// Does the channel have a sensor?
+
+
+	// Same sensor at the same place along the side?
+	static bool same(const LayoutSensor& a, const LayoutSensor& b) {
+		return a.channel == b.channel && a.position.x == b.position.x;
+	};
+};
+
+#endif
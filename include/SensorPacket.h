@@ -0,0 +1,24 @@
+#pragma once
+#ifndef SENSOR_PACKET_H
+#define SENSOR_PACKET_H
+
+#include <stdint.h>
+
+
+// Sensor packet format (UDP, little endian), shared by the app and tools/sensor_generator.cpp
+// Header, then numSamples rows of numChannels floats (sample major). Channels firstChannel to
+// firstChannel + numChannels - 1 of the app's sensor list. Sample k was taken at timestamp + k / sample rate.
+const uint32_t SENSOR_PACKET_MAGIC = 0x50535242;	// "BRSP"
+const int SENSOR_PACKET_MAX_BYTES = 1472;			// Largest packet (one Ethernet frame, no IP fragmentation)
+
+struct SensorPacketHeader {
+	uint32_t magic;				// SENSOR_PACKET_MAGIC
+	uint32_t sequence;			// Per source packet counter (gaps = lost packets)
+	uint64_t timestamp;			// Acquisition clock of the first sample (microseconds)
+	uint16_t source;			// Sender (each acquisition node has its own sequence)
+	uint16_t firstChannel;		// Channel of the first value in a row
+	uint16_t numChannels;		// Values per row
+	uint16_t numSamples;		// Rows
+};
+
+#endif
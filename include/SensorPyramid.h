@@ -0,0 +1,416 @@
+#pragma once
+#ifndef SENSOR_PYRAMID_H
+#define SENSOR_PYRAMID_H
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+const int PYRAMID_VERSION = 2;			// File format version
+const int PYRAMID_FANOUT = 8;			// Buckets of a level merged into one of the next
+const int PYRAMID_MAX_LEVELS = 8;		// Levels above the raw samples (a top bucket is 8^8 samples, about 4 days at 50 Hz)
+const int PYRAMID_FINE_ROWS = 8192;		// Rows kept by the raw samples and level 1 (2.7 and 22 minutes at 50 Hz)
+const int PYRAMID_COARSE_ROWS = 512;	// Rows kept by levels 2 and up (11 minutes at level 2, 8 times longer each level up, years at the top)
+const int PYRAMID_FILE_LEVEL = 2;		// Level appended to the history file (buckets of 64 samples)
+
+// Min, max and mean of a run of samples of one channel
+struct PyramidBucket {
+	float min, max, mean;
+};
+
+// One chart pixel of a query
+struct ChartBucket {
+	float min, max, mean;
+	long long samples;		// Samples merged (0 = no data under this pixel)
+};
+
+// Pyramid file header. Followed by the buckets of one level, numChannels per row, appended as they complete
+struct PyramidHeader {
+	char magic[4];			// "BRPY"
+	int version;			// PYRAMID_VERSION
+	int numChannels;		// Buckets per row
+	int fanout;				// PYRAMID_FANOUT
+	float sampleRate;		// Raw rows per second
+	int level;				// Level of the rows (PYRAMID_FILE_LEVEL)
+};
+
+
+// Last rows of a pyramid level. Rows keep the index they were appended with, so row i of
+// level L always covers samples [i * PYRAMID_FANOUT^L, (i + 1) * PYRAMID_FANOUT^L). Allocated once
+template <typename T>
+class PyramidRing {
+public:
+	// Constructor. width = values per row, rows = rows kept
+	PyramidRing(int width_p, int rows_p) : values((size_t)rows_p * width_p) {
+		width = width_p;
+		rows = rows_p;
+		total = 0;
+		start = 0;
+	};
+
+
+	// Rows appended (index of the next row)
+	long long size() const {
+		return total;
+	};
+
+
+	// Oldest row still kept
+	long long oldest() const {
+		return std::max(start, total - rows);
+	};
+
+
+	// Row i (must be kept)
+	T* row(long long i) {
+		return &values[(size_t)(i % rows) * width];
+	};
+
+
+	// Add a row and return it to be filled (overwrites the oldest once the ring is full)
+	T* append() {
+		return row(total++);
+	};
+
+
+	// Drop every row. The next row appended is row count
+	void restart(long long count) {
+		total = count;
+		start = count;
+	};
+
+
+private:
+	int width;					// Values per row
+	int rows;					// Rows kept
+	long long total;			// Rows appended
+	long long start;			// First row appended since the last restart
+	std::vector<T> values;		// rows rows
+};
+
+
+// Sensor Pyramid
+// Sensor history with min, max and mean summaries for drawing history charts at any zoom, from minutes to years.
+// Level 0 is the raw samples. Each bucket of level L summarizes PYRAMID_FANOUT buckets of level L - 1, so
+// PYRAMID_FANOUT^L samples. Every level keeps only its last rows (many for the raw samples and level 1,
+// a few hundred above, which still reach back years at the top), so memory is fixed at startup and pushing
+// never allocates: recent history is kept at full resolution, older history only as coarser summaries. Level PYRAMID_FILE_LEVEL buckets are appended to the history file as they complete,
+// so a crash loses at most the last bucket, and the levels above are rebuilt from them on load.
+// A query for a time range and a pixel width reads the level whose buckets are just smaller than a pixel
+// (or a coarser one where that level no longer has the history), so each pixel merges a handful of buckets
+// however much history there is.
+class SensorPyramid {
+public:
+	// Constructor. num_channels = values per frame. sample_rate = frames per second
+	// fine_rows = rows kept by the raw samples and level 1, coarse_rows = rows kept by each level above
+	SensorPyramid(int num_channels, float sample_rate, int fine_rows = PYRAMID_FINE_ROWS, int coarse_rows = PYRAMID_COARSE_ROWS)
+		: raw(num_channels, std::max(fine_rows, PYRAMID_FANOUT)) {
+		numChannels = num_channels;
+		sampleRate = sample_rate;
+		file = NULL;
+		levels.reserve(PYRAMID_MAX_LEVELS);
+		for (int level = 1; level <= PYRAMID_MAX_LEVELS; level++) {
+			levels.push_back(PyramidRing<PyramidBucket>(numChannels, std::max(level == 1 ? fine_rows : coarse_rows, PYRAMID_FANOUT)));
+		}
+	};
+
+	// Destructor
+	~SensorPyramid() {
+		close();
+	};
+
+
+	// Add a frame. Completes a bucket in each level whose last sample this is
+	void push(const std::vector<float>& frame) {
+		float* values = raw.append();
+		std::copy(frame.begin(), frame.begin() + std::min((int)frame.size(), numChannels), values);
+		cascade(0);
+	};
+
+
+	// Frames pushed (including the history loaded)
+	long long size() const {
+		return raw.size();
+	};
+
+
+	// Seconds of history (frame i is at i / sample rate)
+	double duration() const {
+		return raw.size() / (double)sampleRate;
+	};
+
+
+	// Chart buckets of a channel for times [t0, t1) (seconds since the first frame), one per pixel.
+	// Buckets straddling a pixel edge count toward both pixels, so spikes are never lost between pixels.
+	void query(int channel, double t0, double t1, int pixels, ChartBucket* out) {
+		if (pixels <= 0) {
+			return;
+		}
+		double per_pixel = std::max((t1 - t0) * sampleRate / pixels, 1e-9);  // Samples per pixel
+
+		// Level with the largest buckets that still fit in a pixel
+		int base = 0;
+		long long base_size = 1;
+		while (base < PYRAMID_MAX_LEVELS && base_size * PYRAMID_FANOUT <= per_pixel) {
+			base++;
+			base_size *= PYRAMID_FANOUT;
+		}
+
+		// Samples after the last complete bucket of each level (worked out the first time a pixel needs them)
+		ChartBucket tails[PYRAMID_MAX_LEVELS + 1];
+		bool have_tail[PYRAMID_MAX_LEVELS + 1] = { false };
+
+		double start = t0 * sampleRate;
+		long long total = raw.size();
+		for (int p = 0; p < pixels; p++) {
+			ChartBucket& pixel = out[p];
+			pixel.min = pixel.max = pixel.mean = 0.0f;
+			pixel.samples = 0;
+			double a = std::max(start + p * per_pixel, 0.0);
+			double e = std::min(start + (p + 1) * per_pixel, (double)total);
+			if (a >= e) {
+				continue;
+			}
+
+			// Coarser levels where this level's ring no longer reaches back to the pixel
+			int level = base;
+			long long bucket_size = base_size;
+			while (level < PYRAMID_MAX_LEVELS && (long long)floor(a / bucket_size) < levelOldest(level)) {
+				level++;
+				bucket_size *= PYRAMID_FANOUT;
+			}
+			long long first = std::max((long long)floor(a / bucket_size), levelOldest(level));
+			long long end = (long long)ceil(e / bucket_size);
+			long long full = levelSize(level);  // Complete buckets
+			double sum = 0.0;
+			for (long long i = first; i < std::min(end, full); i++) {
+				PyramidBucket b = bucketAt(level, i, channel);
+				merge(pixel, b.min, b.max, sum, b.mean * (double)bucket_size, bucket_size);
+			}
+			if (end > full) {
+				if (!have_tail[level]) {
+					tails[level] = tailBucket(level, channel);
+					have_tail[level] = true;
+				}
+				const ChartBucket& tail = tails[level];
+				if (tail.samples > 0) {
+					merge(pixel, tail.min, tail.max, sum, tail.mean * (double)tail.samples, tail.samples);
+				}
+			}
+			pixel.mean = pixel.samples > 0 ? (float)(sum / pixel.samples) : 0.0f;
+		}
+	};
+
+
+	// Keep history in a file. keep = load the history already in it and append to it (otherwise start it over).
+	// A file that isn't a history of the same channels and sample rate is left alone
+	bool open(const char* path, bool keep) {
+		close();
+		clearPyramid();
+
+		// Existing history
+		if (keep) {
+			file = fopen(path, "r+b");
+			if (file != NULL && !load(path)) {
+				fclose(file);
+				file = NULL;
+				return false;
+			}
+		}
+
+		// New file
+		if (file == NULL) {
+			file = fopen(path, "w+b");
+			if (!file) {
+				printf("Sensor pyramid: can't create %s\n", path);
+				return false;
+			}
+			PyramidHeader header = fileHeader();
+			if (fwrite(&header, sizeof(header), 1, file) != 1) {
+				printf("Sensor pyramid: can't write %s\n", path);
+				close();
+				return false;
+			}
+		}
+
+		// Append from here (after the last complete row. Also switches the file from reading to writing)
+		fseek(file, 0, SEEK_CUR);
+		return true;
+	};
+
+
+	// Stop appending to the history file
+	void close() {
+		if (file != NULL) {
+			fclose(file);
+			file = NULL;
+		}
+	};
+
+
+	// Drop all history (the file is left as it is)
+	void clearPyramid() {
+		raw.restart(0);
+		for (int level = 0; level < (int)levels.size(); level++) {
+			levels[level].restart(0);
+		}
+	};
+
+
+private:
+	int numChannels;								// Values per frame
+	float sampleRate;								// Frames per second
+	PyramidRing<float> raw;							// Level 0. [frame][channel]
+	std::vector<PyramidRing<PyramidBucket> > levels;	// Levels 1 and up. [bucket][channel]
+	FILE* file;										// History file PYRAMID_FILE_LEVEL rows are appended to (NULL = none)
+
+
+	// A row was added to a level. Merge the last PYRAMID_FANOUT rows of each level that just filled into the level above
+	void cascade(int level) {
+		long long below = levelSize(level);
+		for (int above = level + 1; above <= PYRAMID_MAX_LEVELS && below % PYRAMID_FANOUT == 0; above++) {
+			PyramidBucket* bucket = levels[above - 1].append();
+			long long first = below - PYRAMID_FANOUT;
+			for (int c = 0; c < numChannels; c++) {
+				PyramidBucket merged = bucketAt(above - 1, first, c);
+				double sum = merged.mean;
+				for (long long i = first + 1; i < below; i++) {
+					PyramidBucket child = bucketAt(above - 1, i, c);
+					merged.min = std::min(merged.min, child.min);
+					merged.max = std::max(merged.max, child.max);
+					sum += child.mean;
+				}
+				merged.mean = (float)(sum / PYRAMID_FANOUT);  // Children are the same size
+				bucket[c] = merged;
+			}
+
+			// Saved as soon as it's complete (stdio doesn't allocate after the first write)
+			if (above == PYRAMID_FILE_LEVEL && file != NULL) {
+				fwrite(bucket, sizeof(PyramidBucket), numChannels, file);
+				fflush(file);
+			}
+			below = levels[above - 1].size();
+		}
+	};
+
+
+	// Read the history file (open, position at the start). Leaves the position after the last complete row,
+	// so a row cut short by a crash is overwritten
+	bool load(const char* path) {
+		PyramidHeader header;
+		PyramidHeader expected = fileHeader();
+		if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(&header, &expected, sizeof(header)) != 0) {
+			printf("Sensor pyramid: %s isn't a version %d history of %d channels at %.0f Hz\n", path, PYRAMID_VERSION, numChannels, sampleRate);
+			return false;
+		}
+
+		// Rows of the file level, and the levels above rebuilt from them
+		PyramidRing<PyramidBucket>& store = levels[PYRAMID_FILE_LEVEL - 1];
+		long long rows = 0;
+		size_t got;
+		while ((got = fread(store.row(store.size()), 1, rowBytes(), file)) == rowBytes()) {
+			store.append();
+			cascade(PYRAMID_FILE_LEVEL);
+			rows++;
+		}
+		if (got > 0) {
+			fseek(file, -(long)got, SEEK_CUR);
+		}
+
+		// The finer levels start empty, after the loaded history
+		long long samples = rows;
+		for (int level = PYRAMID_FILE_LEVEL - 1; level >= 0; level--) {
+			samples *= PYRAMID_FANOUT;
+			if (level == 0) {
+				raw.restart(samples);
+			} else {
+				levels[level - 1].restart(samples);
+			}
+		}
+		printf("Sensor pyramid: loaded %.1f hours of history from %s\n", duration() / 3600.0, path);
+		return true;
+	};
+
+
+	// Header of a history file for this pyramid
+	PyramidHeader fileHeader() {
+		PyramidHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "BRPY", 4);
+		header.version = PYRAMID_VERSION;
+		header.numChannels = numChannels;
+		header.fanout = PYRAMID_FANOUT;
+		header.sampleRate = sampleRate;
+		header.level = PYRAMID_FILE_LEVEL;
+		return header;
+	};
+
+
+	// Bytes per row of the history file
+	size_t rowBytes() {
+		return sizeof(PyramidBucket) * numChannels;
+	};
+
+
+	// Rows appended to a level
+	long long levelSize(int level) {
+		return level == 0 ? raw.size() : levels[level - 1].size();
+	};
+
+
+	// Oldest row a level still keeps
+	long long levelOldest(int level) {
+		return level == 0 ? raw.oldest() : levels[level - 1].oldest();
+	};
+
+
+	// Bucket i of a level (raw samples as buckets)
+	PyramidBucket bucketAt(int level, long long i, int channel) {
+		if (level == 0) {
+			float v = raw.row(i)[channel];
+			PyramidBucket bucket = { v, v, v };
+			return bucket;
+		}
+		return levels[level - 1].row(i)[channel];
+	};
+
+
+	// Add a run of samples to a chart bucket (sum = running sum of the samples)
+	static void merge(ChartBucket& pixel, float min, float max, double& sum, double run_sum, long long count) {
+		if (pixel.samples == 0) {
+			pixel.min = min;
+			pixel.max = max;
+		} else {
+			pixel.min = std::min(pixel.min, min);
+			pixel.max = std::max(pixel.max, max);
+		}
+		sum += run_sum;
+		pixel.samples += count;
+	};
+
+
+	// Summary of the samples after the last complete bucket of a level (at most PYRAMID_FANOUT - 1 buckets per level below,
+	// always still in their rings)
+	ChartBucket tailBucket(int level, int channel) {
+		ChartBucket tail;
+		tail.min = tail.max = tail.mean = 0.0f;
+		tail.samples = 0;
+		double sum = 0.0;
+		long long size = 1;
+		for (int below = 0; below < level; below++) {
+			long long merged = std::max(levelSize(below + 1) * PYRAMID_FANOUT, levelOldest(below));  // Rows already in the level above
+			for (long long i = merged; i < levelSize(below); i++) {
+				PyramidBucket b = bucketAt(below, i, channel);
+				merge(tail, b.min, b.max, sum, b.mean * (double)size, size);
+			}
+			size *= PYRAMID_FANOUT;
+		}
+		tail.mean = tail.samples > 0 ? (float)(sum / tail.samples) : 0.0f;
+		return tail;
+	};
+};
+
+#endif
@@ -0,0 +1,468 @@
+#pragma once
+#ifndef SENSOR_RECEIVER_H
+#define SENSOR_RECEIVER_H
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "RingQueue.h"
+#include "SensorPacket.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+typedef SOCKET ReceiverSocket;
+const ReceiverSocket RECV_NO_SOCKET = INVALID_SOCKET;
+#else
+typedef int ReceiverSocket;
+const ReceiverSocket RECV_NO_SOCKET = -1;
+#endif
+
+
+const int RECV_BATCH = 32;						// Datagrams per read (recvmmsg on Linux)
+const int RECV_SLOTS = 64;						// Frames the jitter buffer can hold at once
+const int RECV_OUTPUT_FRAMES = 256;				// Aligned frames waiting for the render loop (power of 2)
+const int RECV_MAX_SOURCES = 32;				// Senders whose sequence numbers are tracked
+const int RECV_SEQUENCE_WINDOW = 64;			// Recent sequence numbers remembered per sender (to spot duplicates)
+const int RECV_TIMEOUT_MS = 50;					// Socket read timeout. Frames still waiting are sent on when nothing arrives
+const int RECV_RESYNC_FRAMES = 4096;			// A timestamp this far from the buffer restarts alignment (sender restarted)
+const int RECV_SOCKET_BUFFER = 4 * 1024 * 1024;	// Kernel receive buffer (bytes)
+
+// Sequence tracking for one sender
+struct ReceiverSource {
+	int id;					// Packet source field (-1 = unused)
+	uint32_t first;			// First sequence number seen (earlier ones were never counted as lost)
+	uint32_t expected;		// Next sequence number expected
+	uint64_t seen;			// Bit i set = sequence expected - 1 - i arrived
+};
+
+// Receiver counters
+struct ReceiverStats {
+	long packets;			// Packets accepted
+	long frames;			// Aligned frames sent on
+	long lost;				// Packets missing from the sequences
+	long reordered;			// Packets that arrived after a later one
+	long duplicates;		// Packets dropped because they'd already arrived
+	long latePackets;		// Packets dropped because they were too old to check
+	long lateSamples;		// Samples dropped because their frame had already been sent on
+	long incomplete;		// Frames sent on with channels missing (they hold the last value)
+	long dropped;			// Frames dropped because the render loop fell behind
+	long malformed;			// Packets that didn't parse
+};
+
+
+// Sensor Receiver
+// Reads sensor packets (see SensorPacket.h) from a UDP port on its own thread, in batches with recvmmsg on
+// Linux. Values are copied straight from the receive buffers into a jitter buffer of frames on a common
+// sample grid: each packet's rows go to the frames their timestamps fall on, so channels from different
+// senders line up even when packets arrive late or out of order. A frame is sent on once every channel has
+// arrived, or once it's jitter_frames behind the newest frame (missing channels hold their last value).
+// Sequence numbers are tracked per sender to count lost, reordered and duplicate packets.
+// Frames reach the render loop through a lock-free queue of preallocated frames, so nothing allocates while running.
+class SensorReceiver {
+public:
+	// Constructor. num_channels = sensors per frame. sample_rate = sender sample rate (Hz)
+	// jitter_frames = how long (in frames) an incomplete frame waits for late packets
+	SensorReceiver(int num_channels, float sample_rate, int jitter_frames = 4) {
+		numChannels = num_channels;
+		sampleRate = sample_rate;
+		jitterFrames = std::min(std::max(jitter_frames, 0), RECV_SLOTS - 1);
+		sock = RECV_NO_SOCKET;
+		running = false;
+		aligned = false;
+		baseTime = 0;
+		oldestFrame = 0;
+		newestFrame = -1;
+
+		// Buffers (all allocated here)
+		buffers.resize((size_t)RECV_BATCH * SENSOR_PACKET_MAX_BYTES);
+		slotValues.assign((size_t)RECV_SLOTS * numChannels, 0.0f);
+		slotStamps.assign((size_t)RECV_SLOTS * numChannels, -1);
+		slotCounts.assign(RECV_SLOTS, 0);
+		lastValues.assign(numChannels, 0.0f);
+		for (int i = 0; i < RECV_OUTPUT_FRAMES; i++) {
+			outputs[i].assign(numChannels, 0.0f);
+			freeQueue.push(i);
+		}
+		for (int i = 0; i < RECV_MAX_SOURCES; i++) {
+			sources[i].id = -1;
+		}
+		packets = frames = lost = reordered = duplicates = latePackets = lateSamples = incomplete = dropped = malformed = 0;
+	};
+
+	// Destructor
+	~SensorReceiver() {
+		stop();
+	};
+
+
+	// Listen on a UDP port (any interface) and start the receive thread
+	bool start(int port) {
+#ifdef _WIN32
+		WSADATA wsa;
+		if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+			printf("Sensor receiver: WSAStartup failed\n");
+			return false;
+		}
+#endif
+		sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (sock == RECV_NO_SOCKET) {
+			printf("Sensor receiver: can't create socket\n");
+			return false;
+		}
+
+		// Large kernel buffer (bursts queue there while the thread is busy) and a read timeout (so the thread can stop)
+		int reuse = 1;
+		int buffer_size = RECV_SOCKET_BUFFER;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+		setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&buffer_size, sizeof(buffer_size));
+#ifdef _WIN32
+		DWORD timeout = RECV_TIMEOUT_MS;
+#else
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = RECV_TIMEOUT_MS * 1000;
+#endif
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons((unsigned short)port);
+		if (bind(sock, (sockaddr*)&address, sizeof(address)) != 0) {
+			printf("Sensor receiver: can't listen on UDP port %d\n", port);
+			closeSocket();
+			return false;
+		}
+
+		printf("Sensor receiver: listening on UDP port %d (%d channels at %.1f Hz)\n", port, numChannels, sampleRate);
+		running = true;
+		receiver = std::thread(&SensorReceiver::run, this);
+		return true;
+	};
+
+
+	// Is the receive thread running?
+	bool isRunning() {
+		return running;
+	};
+
+
+	// Take the oldest aligned frame (render thread). frame must hold num_channels values. Returns false if there's none
+	bool pop(std::vector<float>& frame) {
+		int index;
+		if (!readyQueue.pop(index)) {
+			return false;
+		}
+		std::copy(outputs[index].begin(), outputs[index].end(), frame.begin());
+		freeQueue.push(index);
+		return true;
+	};
+
+
+	// Counters so far
+	ReceiverStats stats() {
+		ReceiverStats result;
+		result.packets = packets;
+		result.frames = frames;
+		result.lost = lost;
+		result.reordered = reordered;
+		result.duplicates = duplicates;
+		result.latePackets = latePackets;
+		result.lateSamples = lateSamples;
+		result.incomplete = incomplete;
+		result.dropped = dropped;
+		result.malformed = malformed;
+		return result;
+	};
+
+
+	// Print the counters
+	void printStats() {
+		ReceiverStats s = stats();
+		printf("Sensor receiver: %ld packets, %ld frames, %ld lost, %ld reordered, %ld duplicate, %ld too late, %ld late samples, %ld incomplete frames, %ld frames dropped, %ld malformed\n",
+			s.packets, s.frames, s.lost, s.reordered, s.duplicates, s.latePackets, s.lateSamples, s.incomplete, s.dropped, s.malformed);
+	};
+
+
+	// Stop the receive thread and close the socket
+	void stop() {
+		if (running) {
+			running = false;
+			receiver.join();
+		}
+		closeSocket();
+	};
+
+
+private:
+	int numChannels;						// Values per frame
+	float sampleRate;						// Frames per second
+	int jitterFrames;						// Frames an incomplete frame waits
+	ReceiverSocket sock;					// UDP socket
+	std::thread receiver;					// Receive thread
+	std::atomic<bool> running;				// Is the thread running?
+	std::vector<unsigned char> buffers;		// Receive buffers (RECV_BATCH packets)
+
+	// Jitter buffer (receive thread only). Frame f lives in slot f % RECV_SLOTS
+	bool aligned;							// Has the sample grid been set by a first packet?
+	uint64_t baseTime;						// Timestamp of frame 0 (microseconds)
+	int64_t oldestFrame;					// Oldest frame not sent on yet
+	int64_t newestFrame;					// Newest frame any value arrived for
+	std::vector<float> slotValues;			// Values. [slot][channel]
+	std::vector<int64_t> slotStamps;		// Frame each value was written for. [slot][channel]
+	std::vector<int> slotCounts;			// Channels arrived per slot
+	std::vector<float> lastValues;			// Last value sent on per channel (held for missing channels)
+	ReceiverSource sources[RECV_MAX_SOURCES];	// Sequence tracking per sender
+
+	// Output (receive thread -> render thread)
+	std::vector<float> outputs[RECV_OUTPUT_FRAMES];		// Frames (preallocated)
+	RingQueue<int, RECV_OUTPUT_FRAMES> readyQueue;		// Frames to read
+	RingQueue<int, RECV_OUTPUT_FRAMES> freeQueue;		// Frames read
+
+	// Counters (written by the receive thread)
+	std::atomic<long> packets, frames, lost, reordered, duplicates, latePackets, lateSamples, incomplete, dropped, malformed;
+
+
+	// Receive loop
+	void run() {
+#ifdef __linux__
+		// Batch of receive buffers for recvmmsg
+		mmsghdr messages[RECV_BATCH];
+		iovec vectors[RECV_BATCH];
+		memset(messages, 0, sizeof(messages));
+		for (int i = 0; i < RECV_BATCH; i++) {
+			vectors[i].iov_base = &buffers[(size_t)i * SENSOR_PACKET_MAX_BYTES];
+			vectors[i].iov_len = SENSOR_PACKET_MAX_BYTES;
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+#endif
+		while (running) {
+#ifdef __linux__
+			// Waits for the first packet, then takes whatever else is queued (up to the batch)
+			int count = recvmmsg(sock, messages, RECV_BATCH, MSG_WAITFORONE, NULL);
+			for (int i = 0; i < count; i++) {
+				handlePacket(&buffers[(size_t)i * SENSOR_PACKET_MAX_BYTES], (int)messages[i].msg_len);
+			}
+#else
+			// One packet per read
+			int count = recv(sock, (char*)&buffers[0], SENSOR_PACKET_MAX_BYTES, 0);
+			if (count > 0) {
+				handlePacket(&buffers[0], count);
+			}
+#endif
+			// Timed out: nothing else is coming for the frames still waiting
+			if (count <= 0) {
+				flush();
+			}
+		}
+	};
+
+
+	// Parse a packet in place and put its rows into the jitter buffer
+	void handlePacket(const unsigned char* data, int bytes) {
+		SensorPacketHeader header;
+		if (bytes < (int)sizeof(header)) {
+			malformed++;
+			return;
+		}
+		memcpy(&header, data, sizeof(header));
+		size_t row_bytes = (size_t)header.numChannels * sizeof(float);
+		if (header.magic != SENSOR_PACKET_MAGIC || (size_t)bytes < sizeof(header) + row_bytes * header.numSamples) {
+			malformed++;
+			return;
+		}
+		if (!checkSequence(header)) {
+			return;
+		}
+		packets++;
+
+		// Channels of this app's frame the packet covers
+		int first = header.firstChannel;
+		int count = std::min((int)header.numChannels, numChannels - first);
+		if (count <= 0) {
+			return;
+		}
+
+		// First packet sets the sample grid
+		if (!aligned) {
+			restart(header.timestamp);
+		}
+		int64_t frame = frameOf(header.timestamp);
+		if (frame < oldestFrame - RECV_RESYNC_FRAMES || frame >= oldestFrame + RECV_RESYNC_FRAMES) {
+			restart(header.timestamp);
+			frame = 0;
+		}
+
+		const unsigned char* values = data + sizeof(header);
+		for (int row = 0; row < header.numSamples; row++, frame++) {
+			if (frame < oldestFrame) {
+				lateSamples += count;
+				continue;
+			}
+
+			// Make room (frames too far behind go out incomplete)
+			while (frame >= oldestFrame + RECV_SLOTS) {
+				releaseOldest();
+			}
+
+			// Copy the row straight into its frame
+			size_t slot = (size_t)(frame % RECV_SLOTS) * numChannels;
+			memcpy(&slotValues[slot + first], values + row * row_bytes, count * sizeof(float));
+			for (int c = first; c < first + count; c++) {
+				if (slotStamps[slot + c] != frame) {
+					slotStamps[slot + c] = frame;
+					slotCounts[frame % RECV_SLOTS]++;
+				}
+			}
+			newestFrame = std::max(newestFrame, frame);
+		}
+
+		// Send on frames that are complete or have waited long enough (in order)
+		while (oldestFrame <= newestFrame && (slotCounts[oldestFrame % RECV_SLOTS] == numChannels || newestFrame - oldestFrame >= jitterFrames)) {
+			releaseOldest();
+		}
+	};
+
+
+	// Track a sender's sequence numbers. Returns false if the packet should be dropped (duplicate or too old)
+	bool checkSequence(const SensorPacketHeader& header) {
+		// Sender's entry (a new sender takes a free one, or shares the last if there are too many)
+		ReceiverSource* source = &sources[RECV_MAX_SOURCES - 1];
+		for (int i = 0; i < RECV_MAX_SOURCES; i++) {
+			if (sources[i].id == header.source) {
+				source = &sources[i];
+				break;
+			}
+			if (sources[i].id < 0) {
+				source = &sources[i];
+				source->id = header.source;
+				source->first = header.sequence;
+				source->expected = header.sequence;
+				source->seen = 0;
+				break;
+			}
+		}
+
+		// Newer than expected: anything skipped is lost (until it turns up)
+		int32_t difference = (int32_t)(header.sequence - source->expected);
+		if (difference >= 0) {
+			lost += difference;
+			int shift = difference + 1;
+			source->seen = shift >= RECV_SEQUENCE_WINDOW ? 0 : source->seen << shift;
+			source->seen |= 1;
+			source->expected = header.sequence + 1;
+			return true;
+		}
+
+		// Older: a reordered packet, unless it already arrived
+		int age = -difference - 1;
+		if (age >= RECV_SEQUENCE_WINDOW) {
+			latePackets++;
+			return false;
+		}
+		uint64_t bit = (uint64_t)1 << age;
+		if (source->seen & bit) {
+			duplicates++;
+			return false;
+		}
+		source->seen |= bit;
+		reordered++;
+		if ((int32_t)(header.sequence - source->first) > 0) {
+			lost--;  // Was counted as lost when a later one arrived
+		}
+		return true;
+	};
+
+
+	// Frame a timestamp falls on
+	int64_t frameOf(uint64_t timestamp) {
+		double offset = (double)(int64_t)(timestamp - baseTime);	// Microseconds (negative if before frame 0)
+		return (int64_t)std::floor(offset * sampleRate / 1000000.0 + 0.5);
+	};
+
+
+	// Start a new sample grid at a timestamp (first packet, or the sender's clock jumped)
+	void restart(uint64_t timestamp) {
+		flush();
+		std::fill(slotStamps.begin(), slotStamps.end(), -1);
+		std::fill(slotCounts.begin(), slotCounts.end(), 0);
+		baseTime = timestamp;
+		oldestFrame = 0;
+		newestFrame = -1;
+		aligned = true;
+	};
+
+
+	// Send on every frame that has values
+	void flush() {
+		while (oldestFrame <= newestFrame) {
+			releaseOldest();
+		}
+	};
+
+
+	// Send the oldest frame to the render loop and free its slot
+	void releaseOldest() {
+		size_t slot = (size_t)(oldestFrame % RECV_SLOTS) * numChannels;
+		if (slotCounts[oldestFrame % RECV_SLOTS] < numChannels) {
+			incomplete++;
+		}
+		for (int c = 0; c < numChannels; c++) {
+			if (slotStamps[slot + c] == oldestFrame) {
+				lastValues[c] = slotValues[slot + c];
+			}
+		}
+		slotCounts[oldestFrame % RECV_SLOTS] = 0;
+		oldestFrame++;
+
+		int index;
+		if (!freeQueue.pop(index)) {
+			dropped++;
+			return;
+		}
+		std::copy(lastValues.begin(), lastValues.end(), outputs[index].begin());
+		readyQueue.push(index);
+		frames++;
+	};
+
+
+	// Close the socket
+	void closeSocket() {
+		if (sock == RECV_NO_SOCKET) {
+			return;
+		}
+#ifdef _WIN32
+		closesocket(sock);
+		WSACleanup();
+#else
+		close(sock);
+#endif
+		sock = RECV_NO_SOCKET;
+	};
+};
+
+#endif
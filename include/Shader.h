@@ -4,6 +4,8 @@
 
 #include "GL/glew.h"
 
+#include "GLState.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -13,6 +15,11 @@ class Shader {
 public:
 	unsigned int programID;	// The program ID
 
+	// Empty shader (assigned a built one later)
+	Shader() {
+		programID = 0;
+	};
+
 	// Constructor reads and builds the shader
 	Shader(const char* vertexPath, const char* fragmentPath) {
 		// 1.) Retrieve the vertex / fragment source code from filePath
@@ -80,32 +87,44 @@ public:
 
 	// Use / activate the shader
 	void use() {
-		glUseProgram(programID);
+		GLState::useProgram(programID);  // Skipped if already in use
 	};
 
 
 	// Delete shader program
 	void deleteProgram() {
-		glDeleteProgram(programID); // Delete shader program
+		GLState::deleteProgram(programID); // Delete shader program
 	};
 
 
-	// Utility uniform functions
+	// Utility uniform functions (names are C strings so setting uniforms never allocates)
 	// Set Boolean
-	void setBool(const std::string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(programID, name.c_str()), (int)value);
+	void setBool(const char* name, bool value) const {
+		glUniform1i(glGetUniformLocation(programID, name), (int)value);
+	};
+
+	void setInt(const char* name, int value) const {
+		glUniform1i(glGetUniformLocation(programID, name), value);
+	};
+
+	void setFloat(const char* name, float value) const {
+		glUniform1f(glGetUniformLocation(programID, name), value);
+	};
+
+	void setVec2(const char* name, glm::vec2 value) const {
+		glUniform2f(glGetUniformLocation(programID, name), value.x, value.y);
 	};
 
-	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+	void setVec3(const char* name, glm::vec3 value) const {
+		glUniform3f(glGetUniformLocation(programID, name), value.x, value.y, value.z);
 	};
 
-	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+	void setVec4(const char* name, glm::vec4 value) const {
+		glUniform4f(glGetUniformLocation(programID, name), value.x, value.y, value.z, value.w);
 	};
 
-	void setMat4(const std::string& name, glm::mat4 transf) {
-		unsigned int transformLoc = glGetUniformLocation(programID, name.c_str());
+	void setMat4(const char* name, glm::mat4 transf) {
+		unsigned int transformLoc = glGetUniformLocation(programID, name);
 		glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transf));
 	};
 
@@ -8,8 +8,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "stb_image.h"
 
+#include "LineChart.h"
+#include "PageCache.h"
+#include "RenderQueue.h"
 #include "Shader.h"
 
+#include <cmath>
 #include <string>
 #include <vector>
 #include <stdio.h>
@@ -18,10 +22,9 @@
 using namespace std;
 
 
-// Texture
+// Texture (the GL texture lives in the PageCache, looked up by path)
 struct GuiTexture {
-	unsigned int id;		// Texture id
-	string path;			// Path to the texture to compare with other textures
+	string path;			// Path to the texture
 	glm::vec2 position;		// Texture position
 	glm::vec2 scale;		// Texture scale
 };
@@ -44,39 +47,35 @@ public:
 	}
 
 
-	// Load Material Texture
+	// Add a texture to the state. Nothing is loaded until the state is drawn or prefetched
 	void loadMaterialTextures(string filepath, glm::vec2 pos, glm::vec2 scale) {
+		GuiTexture texture;						// Create new texture to push onto vector
+		texture.path = filepath;				// Texture file path
+		texture.position = pos;					// Texture position
+		texture.scale = scale;					// Texture scale
+		textures.push_back(texture);			// Push texture onto textures vector
+	};
 
-		bool skip = false;	// Do we already have the texture and can skip?
-
-		// Loop through loaded textures to see if there's a match
-		for (unsigned int i = 0; i < textures_loaded.size(); i++) {
-			// If there's a match
-			if (textures_loaded[i].path == filepath) {
-				GuiTexture texture = textures_loaded[i];
-				texture.position = pos;		// Update position
-				texture.scale = scale;		// Update scale
 
-				textures.push_back(texture);  // Then push already loaded texture
-				skip = true;	// Set skip to true, so it skips creating a new one
-				break;
-			}
+	// Queue this state's textures for background loading
+	void prefetch(PageCache& pages) {
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			pages.prefetch(textures[i].path);
 		}
+	};
 
-		// If the texture isn't already loaded, then we need to load it
-		if (!skip) {
-			GuiTexture texture;					// Create new texture to push onto vector
-			texture.id = TextureFromFile(filepath);  // Load texture from directory
-			texture.path = filepath;				// Texture file path
-			texture.position = pos;					// Texture position
-			texture.scale = scale;					// Texture scale
-			textures.push_back(texture);	// Push texture onto textures vector
-			textures_loaded.push_back(texture);  // Push texture into already loaded vector
-		}
 
+	// Add a chart to the state (drawn over its textures). The chart is owned by the caller, which feeds it rows
+	void addChart(LineChart* chart) {
+		charts.push_back(chart);
 	};
 
 
+	// Buttons (their state_num are the states reachable from this one)
+	const vector<Button>& getButtons() {
+		return buttons;
+	};
+
 
 	// Add button to state
 	void addButton(int astate_num, glm::vec4 apos) {
@@ -118,41 +117,39 @@ public:
 
 
 
-	// Draw
-	void draw(Shader& shader) {
-
-		glDisable(GL_DEPTH_TEST);  // Disable depth testing with z buffers
-
-		// Set texture uniform in shader
-		shader.setInt("texture0", 0); // Set shader float uniform for texture
-
-		// Activate proper texture unit before binding
-		glBindVertexArray(VAO);		// Bind vertex attrib array
-
-		glActiveTexture(GL_TEXTURE0);
+	// Record the page textures and charts in the queue (textures are loaded through pages if they aren't resident)
+	// Textures that don't overlap share a layer, so the queue can group them by texture. One that overlaps an
+	// earlier texture starts a new layer, so it's still drawn over it
+	void addDraws(RenderQueue& queue, Shader& shader, PageCache& pages) {
 
 		// Loop through each texture
+		queue.nextLayer();
+		unsigned int layer_start = 0;	// First texture in the current layer
 		for (unsigned int i = 0; i < textures.size(); i++) {
 
+			// Overlaps a texture in this layer?
+			for (unsigned int j = layer_start; j < i; j++) {
+				if (overlaps(textures[i], textures[j])) {
+					queue.nextLayer();
+					layer_start = i;
+					break;
+				}
+			}
+
 			// Set transformation matrix
 			glm::mat4 transf = glm::mat4(1.0f); // Start as identity matrix
 			transf = glm::translate(transf, glm::vec3(textures[i].position, 0.0f));  // Translate
 			transf = glm::scale(transf, glm::vec3(textures[i].scale, 1.0));  // Scale
-			shader.setMat4("transformation", transf);	// Set uniform in shader
 
-			// Bind texture and vertex array
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
-
-			// Draw quad
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);  // Draw vertices
+			// Quad with the texture (drawn by the queue)
+			queue.addQuad(RENDER_PASS_GUI, shader, VAO, pages.acquire(textures[i].path), transf);
 			
 		}//End for loop
 
-		// Unbind
-		glBindVertexArray(0);		// Unbind vertex attrib array
-
-		glEnable(GL_DEPTH_TEST);  // Enable depth testing with z buffers
+		// Charts (one draw each, over the pages)
+		for (unsigned int i = 0; i < charts.size(); i++) {
+			queue.addObject(RENDER_PASS_OVERLAY, shader, charts[i]);
+		}
 
 	};
 
@@ -160,11 +157,17 @@ public:
 
 private:
 	vector<GuiTexture> textures;			// Textures
-	vector<GuiTexture> textures_loaded;  // Already loaded textures
 	unsigned int State_num;				// State id number
 	string state_txtname;					// State text file where texture information is
 	unsigned int VAO, VBO;				// Vertex array buffer and vertex buffer
 	vector<Button> buttons;				// Array of buttons
+	vector<LineChart*> charts;			// Charts drawn over the textures
+
+
+	// Do two textures' rectangles overlap? (position = center, scale = half size)
+	static bool overlaps(const GuiTexture& a, const GuiTexture& b) {
+		return std::abs(a.position.x - b.position.x) < a.scale.x + b.scale.x && std::abs(a.position.y - b.position.y) < a.scale.y + b.scale.y;
+	};
 
 
 	// Set up Quad Buffer (since most things we're doing are for gui textures)
@@ -184,7 +187,7 @@ private:
 		//printf("state vao: %d\n", VAO);
 
 		// Bind arrays and buffers and populate them with data
-		glBindVertexArray(VAO);		// Bind vertex attrib array
+		GLState::bindVertexArray(VAO);		// Bind vertex attrib array
 
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);  // Bind vertex buffer
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);  // Buffer data
@@ -193,7 +196,7 @@ private:
 		glEnableVertexAttribArray(0);  // Enable vertex positions attribute
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);  // Set up attribute pointer
 
-		glBindVertexArray(0);  // Unbind vertex attrib array
+		GLState::bindVertexArray(0);  // Unbind vertex attrib array
 	};
 
 
@@ -203,55 +206,5 @@ private:
 	};
 
 
-	// Load texture from file
-	unsigned int TextureFromFile(string path) {
-		// Parse texture file name
-		string filename = path;  // Get full file path
-
-		// Generate texture
-		unsigned int textureID;
-		glGenTextures(1, &textureID);
-
-		// Load a texture
-		int width, height, nrChannels;  // Texture width, height, and num channels
-		unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrChannels, 0);  // Load texture
-
-		// Check if image data loaded okay
-		// If so, then attach texture image to texture and create mipmap
-		if (data) {
-			// Figure out image format based on num channels
-			GLenum format;
-			if (nrChannels == 1) {
-				format = GL_RED;
-			}
-			else if (nrChannels == 3) {
-				format = GL_RGB;
-			}
-			else if (nrChannels == 4) {
-				format = GL_RGBA;
-			}
-
-			glBindTexture(GL_TEXTURE_2D, textureID);  // Bind texture
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);  // Attach texture image to texture
-			glGenerateMipmap(GL_TEXTURE_2D);	// Generate mipmap
-
-			// Set texture wraping / filtering options
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Texture wrapping for s coord
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  // Texture wrapping for t coord
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);  // Texture filtering when downscaling
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);  // Texture filtering for upscaling
-
-		// Otherwise, image did not load correctly, so print error
-		}
-		else {
-			printf("Texture failed to load at path: %s\n", filename.c_str());
-		}
-
-		stbi_image_free(data);  // Free image data
-
-		return textureID;		// Return texture ID
-	};
-
-
 };
 #endif
\ No newline at end of file
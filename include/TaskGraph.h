@@ -0,0 +1,303 @@
+#pragma once
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Where a task runs
+enum Task_Thread {
+	TASK_CPU,		// Worker pool (no GL calls)
+	TASK_GL			// Thread that called run() (owns the GL context)
+};
+
+// Task
+struct Task {
+	std::string name;					// Name in the timeline
+	Task_Thread thread;					// Where it runs
+	std::function<void()> function;		// Work
+	std::vector<int> dependents;		// Tasks waiting on this one
+	int waiting;						// Dependencies not finished yet
+	double start, end;					// Timeline (ms since run() started)
+	int worker;							// Thread it ran on (-1 = GL thread)
+};
+
+
+// Task Graph
+// Runs startup work as a dependency graph. CPU tasks run on a worker pool; GL tasks run on the thread
+// that calls run() (the one with the GL context) as soon as their dependencies finish. Tasks can split
+// loops across the pool with parallelFor. After run(), printTimeline() shows when each task ran.
+class TaskGraph {
+public:
+	// Constructor. num_workers = 0 uses one worker per hardware thread (minus the GL thread)
+	TaskGraph(int num_workers = 0) {
+		numWorkers = num_workers;
+		if (numWorkers <= 0) {
+			numWorkers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+		}
+		remaining = 0;
+		stopping = false;
+		totalTime = 0.0;
+	};
+
+	// Destructor
+	~TaskGraph() {
+		stopWorkers();
+	};
+
+
+	// Add a task (before run). Returns its id for use as a dependency
+	int add(const std::string& name, Task_Thread thread, std::function<void()> function, std::vector<int> dependencies = std::vector<int>()) {
+		Task task;
+		task.name = name;
+		task.thread = thread;
+		task.function = function;
+		task.waiting = (int)dependencies.size();
+		task.start = task.end = 0.0;
+		task.worker = -1;
+		tasks.push_back(task);
+
+		int id = (int)tasks.size() - 1;
+		for (unsigned int i = 0; i < dependencies.size(); i++) {
+			tasks[dependencies[i]].dependents.push_back(id);
+		}
+		return id;
+	};
+
+
+	// Run every task. Call from the GL thread, which runs GL tasks until everything has finished
+	void run() {
+		startTime = std::chrono::steady_clock::now();
+		remaining = (int)tasks.size();
+
+		// Start workers
+		stopping = false;
+		for (int i = 0; i < numWorkers; i++) {
+			workers.push_back(std::thread(&TaskGraph::workerLoop, this, i));
+		}
+
+		// Queue tasks without dependencies
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (int i = 0; i < (int)tasks.size(); i++) {
+				if (tasks[i].waiting == 0) {
+					enqueue(i);
+				}
+			}
+		}
+
+		// Run GL tasks as they become ready
+		std::unique_lock<std::mutex> lock(mutex);
+		while (remaining > 0) {
+			glCond.wait(lock, [this] { return !glReady.empty() || remaining == 0; });
+			if (!glReady.empty()) {
+				int id = glReady.front();
+				glReady.pop_front();
+				lock.unlock();
+				execute(id, -1);
+				lock.lock();
+			}
+		}
+		lock.unlock();
+
+		totalTime = elapsed();
+		stopWorkers();
+	};
+
+
+	// Run fn(0) ... fn(count - 1) across the worker pool and the calling thread. Returns when all are done.
+	// The caller only works on this loop's items (never other queued jobs, which could run whole CPU tasks on
+	// the GL thread), then sleeps until the items other threads took are finished. Every item is either untaken,
+	// so the caller takes it, or running on a thread, so nested loops can't deadlock. Runs serially when called outside run()
+	void parallelFor(int count, std::function<void(int)> fn) {
+		if (workers.empty()) {
+			for (int i = 0; i < count; i++) {
+				fn(i);
+			}
+			return;
+		}
+
+		// Shared by the helper jobs (which may start after this returns, then find nothing left to do)
+		std::shared_ptr<ParallelLoop> loop = std::make_shared<ParallelLoop>();
+		loop->fn = fn;
+		loop->count = count;
+		loop->next = 0;
+		loop->done = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (int i = 0; i < std::min(numWorkers, count); i++) {
+				cpuJobs.push_back([loop] { runLoop(*loop); });
+			}
+		}
+		cpuCond.notify_all();
+
+		// Take items too, then wait for the ones still running elsewhere
+		runLoop(*loop);
+		std::unique_lock<std::mutex> lock(loop->doneMutex);
+		loop->doneCond.wait(lock, [&loop, count] { return loop->done == count; });
+	};
+
+
+	// Print when each task ran (after run)
+	void printTimeline() {
+		std::vector<int> order(tasks.size());
+		for (unsigned int i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [this](int a, int b) { return tasks[a].start < tasks[b].start; });
+
+		const int BAR_WIDTH = 40;
+		printf("Startup timeline (%.1f ms, %d workers + GL thread)\n", totalTime, numWorkers);
+		for (unsigned int i = 0; i < order.size(); i++) {
+			Task& task = tasks[order[i]];
+			char bar[BAR_WIDTH + 1];
+			int from = totalTime > 0.0 ? (int)(task.start / totalTime * BAR_WIDTH) : 0;
+			int to = totalTime > 0.0 ? (int)(task.end / totalTime * BAR_WIDTH) : 0;
+			for (int c = 0; c < BAR_WIDTH; c++) {
+				bar[c] = (c >= from && c <= std::max(from, to - 1)) ? '#' : '.';
+			}
+			bar[BAR_WIDTH] = '\0';
+
+			char thread_name[16];
+			if (task.worker < 0) {
+				snprintf(thread_name, sizeof(thread_name), "GL");
+			} else {
+				snprintf(thread_name, sizeof(thread_name), "cpu%d", task.worker);
+			}
+			printf("  %-24s %-5s %8.1f ms %8.1f ms  |%s|\n", task.name.c_str(), thread_name, task.start, task.end - task.start, bar);
+		}
+	};
+
+
+private:
+	// Loop split by parallelFor
+	struct ParallelLoop {
+		std::function<void(int)> fn;		// Body
+		int count;							// Number of items
+		std::atomic<int> next;				// Next item to take
+		std::atomic<int> done;				// Items finished
+		std::mutex doneMutex;				// Guards the wait for the last item
+		std::condition_variable doneCond;	// Signals the last item finished
+	};
+
+	std::vector<Task> tasks;							// Tasks
+	int numWorkers;										// Worker pool size
+	std::vector<std::thread> workers;					// Worker pool
+	std::mutex mutex;									// Guards the queues, waiting counts and remaining
+	std::condition_variable cpuCond;					// Signals CPU jobs (or stopping)
+	std::condition_variable glCond;						// Signals GL tasks (or everything finished)
+	std::deque<std::function<void()>> cpuJobs;			// CPU tasks and parallelFor helpers
+	std::deque<int> glReady;							// GL tasks ready to run
+	int remaining;										// Tasks not finished
+	bool stopping;										// Are the workers stopping?
+	std::chrono::steady_clock::time_point startTime;	// When run() started
+	double totalTime;									// Length of run() (ms)
+
+
+	// Worker loop
+	void workerLoop(int worker) {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cpuCond.wait(lock, [this] { return stopping || !cpuJobs.empty(); });
+				if (cpuJobs.empty()) {
+					return;  // Stopping
+				}
+				job = cpuJobs.front();
+				cpuJobs.pop_front();
+			}
+			workerIndex() = worker;
+			job();
+		}
+	};
+
+
+	// Queue a ready task (mutex held)
+	void enqueue(int id) {
+		if (tasks[id].thread == TASK_GL) {
+			glReady.push_back(id);
+			glCond.notify_one();
+		} else {
+			cpuJobs.push_back([this, id] { execute(id, workerIndex()); });
+			cpuCond.notify_one();
+		}
+	};
+
+
+	// Run a task, then release its dependents
+	void execute(int id, int worker) {
+		Task& task = tasks[id];
+		task.worker = worker;
+		task.start = elapsed();
+		task.function();
+		task.end = elapsed();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (unsigned int i = 0; i < task.dependents.size(); i++) {
+			if (--tasks[task.dependents[i]].waiting == 0) {
+				enqueue(task.dependents[i]);
+			}
+		}
+		remaining--;
+		if (remaining == 0) {
+			glCond.notify_one();
+		}
+	};
+
+
+	// Take and run items of a parallel loop
+	static void runLoop(ParallelLoop& loop) {
+		while (true) {
+			int i = loop.next++;
+			if (i >= loop.count) {
+				return;
+			}
+			loop.fn(i);
+			if (++loop.done == loop.count) {
+				std::lock_guard<std::mutex> lock(loop.doneMutex);
+				loop.doneCond.notify_all();
+			}
+		}
+	};
+
+
+	// Stop and join the workers
+	void stopWorkers() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		cpuCond.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+		workers.clear();
+	};
+
+
+	// Milliseconds since run() started
+	double elapsed() {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	};
+
+
+	// Index of the worker running on this thread (-1 = not a worker)
+	static int& workerIndex() {
+		static thread_local int index = -1;
+		return index;
+	};
+};
+
+#endif
@@ -0,0 +1,346 @@
+#pragma once
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include <glm/glm.hpp>
+
+#include "RenderQueue.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <stdarg.h>
+#include <stdio.h>
+#include <vector>
+
+
+const int TEXT_FIRST_CHAR = 32;			// First character in the atlas (space)
+const int TEXT_LAST_CHAR = 126;			// Last character in the atlas (~)
+const int TEXT_ATLAS_WIDTH = 512;		// Atlas width (pixels). Its height fits the glyphs
+const int TEXT_MAX_GLYPHS = 16384;		// Glyphs drawn per frame. More are dropped
+const int TEXT_MAX_LENGTH = 256;		// Longest formatted string (addf)
+
+// Glyph in the atlas
+struct Glyph {
+	glm::vec4 uv;			// Atlas rectangle (u0, v0 = top left, u1, v1 = bottom right)
+	glm::vec2 size;			// Size (pixels)
+	float advance;			// Distance to the next glyph (pixels)
+};
+
+// Glyph quad for one instanced draw (gui_vshader.vs attributes 1 to 3)
+struct GlyphInstance {
+	glm::vec4 rect;			// Quad (x, y = bottom left, width, height in normalized device coordinates)
+	glm::vec4 uv;			// Atlas rectangle
+	glm::vec4 color;		// Color
+};
+
+
+// Text Renderer
+// Printable ASCII glyphs are rasterized once with SDL_ttf into a single channel atlas texture. Each frame,
+// strings are laid out into a list of glyph quads, which is streamed into an instance buffer and drawn with
+// one instanced draw through the GUI shader. Nothing is rasterized or allocated per frame.
+// load() runs on any thread, upload() on the GL thread (like Model).
+class TextRenderer {
+public:
+	// Constructor
+	TextRenderer() {
+		atlasHeight = 0;
+		lineHeight = 0.0f;
+		atlasTexture = 0;
+		VAO = quadVBO = instanceVBO = 0;
+		instanceCapacity = 0;
+		screenWidth = screenHeight = 1;
+		dropped = 0;
+		loaded = false;
+		instances.reserve(TEXT_MAX_GLYPHS);
+
+		// No glyphs until a font is loaded
+		for (int i = 0; i <= TEXT_LAST_CHAR - TEXT_FIRST_CHAR; i++) {
+			glyphs[i].uv = glm::vec4(0.0f);
+			glyphs[i].size = glm::vec2(0.0f);
+			glyphs[i].advance = 0.0f;
+		}
+	};
+
+
+	// Rasterize the glyphs of a font into the atlas (no GL calls). pixel_size = font size. Returns false if the font can't be opened
+	bool load(const char* font_path, int pixel_size) {
+		if (TTF_Init() != 0) {
+			printf("Text: TTF_Init failed. Error: %s\n", TTF_GetError());
+			return false;
+		}
+		TTF_Font* font = TTF_OpenFont(font_path, pixel_size);
+		if (font == NULL) {
+			printf("Text: can't open font %s. Error: %s\n", font_path, TTF_GetError());
+			TTF_Quit();
+			return false;
+		}
+		lineHeight = (float)TTF_FontLineSkip(font);
+
+		// Render every glyph (white, coverage in alpha)
+		SDL_Color white = { 255, 255, 255, 255 };
+		std::vector<SDL_Surface*> surfaces(TEXT_LAST_CHAR - TEXT_FIRST_CHAR + 1, NULL);
+		for (int c = TEXT_FIRST_CHAR; c <= TEXT_LAST_CHAR; c++) {
+			SDL_Surface* surface = TTF_RenderGlyph_Blended(font, (Uint16)c, white);
+			if (surface != NULL) {
+				surfaces[c - TEXT_FIRST_CHAR] = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+				SDL_FreeSurface(surface);
+			}
+			int min_x, max_x, min_y, max_y, advance;
+			TTF_GlyphMetrics(font, (Uint16)c, &min_x, &max_x, &min_y, &max_y, &advance);
+			glyphs[c - TEXT_FIRST_CHAR].advance = (float)advance;
+		}
+		TTF_CloseFont(font);
+		TTF_Quit();
+
+		// Place glyphs in rows (1 pixel apart so linear filtering doesn't bleed)
+		int x = 0, y = 0, row_height = 0;
+		std::vector<glm::ivec2> places(surfaces.size());
+		for (unsigned int i = 0; i < surfaces.size(); i++) {
+			if (surfaces[i] == NULL) {
+				continue;
+			}
+			if (x + surfaces[i]->w > TEXT_ATLAS_WIDTH) {
+				x = 0;
+				y += row_height + 1;
+				row_height = 0;
+			}
+			places[i] = glm::ivec2(x, y);
+			x += surfaces[i]->w + 1;
+			row_height = std::max(row_height, surfaces[i]->h);
+		}
+		atlasHeight = y + row_height;
+
+		// Copy coverage into the atlas
+		atlas.assign((size_t)TEXT_ATLAS_WIDTH * atlasHeight, 0);
+		for (unsigned int i = 0; i < surfaces.size(); i++) {
+			Glyph& glyph = glyphs[i];
+			SDL_Surface* surface = surfaces[i];
+			if (surface == NULL) {
+				glyph.size = glm::vec2(0.0f);
+				glyph.uv = glm::vec4(0.0f);
+				continue;
+			}
+			SDL_LockSurface(surface);
+			for (int row = 0; row < surface->h; row++) {
+				const Uint8* pixels = (const Uint8*)surface->pixels + row * surface->pitch;
+				for (int col = 0; col < surface->w; col++) {
+					atlas[(size_t)(places[i].y + row) * TEXT_ATLAS_WIDTH + places[i].x + col] = pixels[col * 4 + 3];
+				}
+			}
+			SDL_UnlockSurface(surface);
+			glyph.size = glm::vec2((float)surface->w, (float)surface->h);
+			glyph.uv = glm::vec4((float)places[i].x / TEXT_ATLAS_WIDTH, (float)places[i].y / atlasHeight,
+				(float)(places[i].x + surface->w) / TEXT_ATLAS_WIDTH, (float)(places[i].y + surface->h) / atlasHeight);
+			SDL_FreeSurface(surface);
+		}
+		loaded = true;
+		return true;
+	};
+
+
+	// Was a font loaded?
+	bool isLoaded() {
+		return loaded;
+	};
+
+
+	// Create the atlas texture and buffers (GL thread). Nothing to do if no font was loaded
+	void upload() {
+		if (!loaded) {
+			return;
+		}
+
+		// Atlas (one byte per texel)
+		glGenTextures(1, &atlasTexture);
+		GLState::bindTexture(0, GL_TEXTURE_2D, atlasTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TEXT_ATLAS_WIDTH, std::max(atlasHeight, 1), 0, GL_RED, GL_UNSIGNED_BYTE, atlas.empty() ? NULL : &atlas[0]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GLState::bindTexture(0, GL_TEXTURE_2D, 0);
+		std::vector<unsigned char>().swap(atlas);  // On the GPU now
+
+		// Unit quad (same as the GUI pages)
+		float vertices[] = {
+			-1.0f,  1.0f,
+			-1.0f, -1.0f,
+			 1.0f,  1.0f,
+			 1.0f, -1.0f
+		};
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &quadVBO);
+		glGenBuffers(1, &instanceVBO);
+		GLState::bindVertexArray(VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);  // Quad corner
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+		// Glyph quads (one per instance)
+		instanceCapacity = 256;
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(GlyphInstance), NULL, GL_STREAM_DRAW);
+		for (int a = 0; a < 3; a++) {
+			glEnableVertexAttribArray(1 + a);  // Rect, atlas rectangle, color
+			glVertexAttribPointer(1 + a, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)(sizeof(glm::vec4) * a));
+			glVertexAttribDivisor(1 + a, 1);  // Advance once per glyph
+		}
+
+		GLState::bindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	};
+
+
+	// Start a frame's text. width, height = drawable size (pixels)
+	void begin(int width, int height) {
+		instances.clear();  // Keeps capacity
+		screenWidth = std::max(width, 1);
+		screenHeight = std::max(height, 1);
+	};
+
+
+	// Add a string. x, y = top left (pixels from the top left of the drawable). Newlines start a new line
+	void add(const char* text, float x, float y, glm::vec4 color) {
+		if (!loaded) {
+			return;
+		}
+		float pen_x = x;
+		for (const char* c = text; *c != '\0'; c++) {
+			if (*c == '\n') {
+				pen_x = x;
+				y += lineHeight;
+				continue;
+			}
+			if (*c < TEXT_FIRST_CHAR || *c > TEXT_LAST_CHAR) {
+				continue;
+			}
+			const Glyph& glyph = glyphs[*c - TEXT_FIRST_CHAR];
+			if (glyph.size.x > 0.0f) {
+				if ((int)instances.size() >= TEXT_MAX_GLYPHS) {
+					dropped++;
+					return;
+				}
+				GlyphInstance instance;
+				instance.rect = glm::vec4(2.0f * pen_x / screenWidth - 1.0f, 1.0f - 2.0f * (y + glyph.size.y) / screenHeight,
+					2.0f * glyph.size.x / screenWidth, 2.0f * glyph.size.y / screenHeight);
+				instance.uv = glyph.uv;
+				instance.color = color;
+				instances.push_back(instance);
+			}
+			pen_x += glyph.advance;
+		}
+	};
+
+
+	// Add a formatted string (printf style)
+	void addf(float x, float y, glm::vec4 color, const char* format, ...) {
+		char text[TEXT_MAX_LENGTH];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(text, sizeof(text), format, args);
+		va_end(args);
+		add(text, x, y, color);
+	};
+
+
+	// Width of a string (pixels, longest line)
+	float width(const char* text) {
+		float line = 0.0f, widest = 0.0f;
+		for (const char* c = text; *c != '\0'; c++) {
+			if (*c == '\n') {
+				line = 0.0f;
+			} else if (*c >= TEXT_FIRST_CHAR && *c <= TEXT_LAST_CHAR) {
+				line += glyphs[*c - TEXT_FIRST_CHAR].advance;
+			}
+			widest = std::max(widest, line);
+		}
+		return widest;
+	};
+
+
+	// Distance between lines (pixels)
+	float lineSpacing() {
+		return lineHeight;
+	};
+
+
+	// Record the frame's text in the queue (drawn over everything else)
+	void addDraws(RenderQueue& queue, Shader& shader) {
+		if (!instances.empty() && VAO != 0) {
+			queue.addObject(RENDER_PASS_TEXT, shader, this);
+		}
+	};
+
+
+	// Draw the frame's text with one instanced draw (called by the render queue). shader = GUI shader (in use)
+	void draw(Shader& shader) {
+		if (instances.empty() || VAO == 0) {
+			return;
+		}
+
+		// Stream the glyphs (orphan the old storage so the driver doesn't wait on last frame's draw)
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		if (instances.size() > instanceCapacity) {
+			instanceCapacity = (unsigned int)std::min(std::max(instances.size(), (size_t)instanceCapacity * 2), (size_t)TEXT_MAX_GLYPHS);
+		}
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(GlyphInstance), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(GlyphInstance), &instances[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// Blend glyph coverage over the frame (left on, the next pass turns off what it doesn't want)
+		GLState::disable(GL_DEPTH_TEST);
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		shader.setInt("guiMode", 1);
+		shader.setInt("texture0", 0);
+		GLState::bindTexture(0, GL_TEXTURE_2D, atlasTexture);
+
+		GLState::bindVertexArray(VAO);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)instances.size());
+
+		shader.setInt("guiMode", 0);
+	};
+
+
+	// Glyphs dropped over TEXT_MAX_GLYPHS so far
+	long droppedGlyphs() {
+		return dropped;
+	};
+
+
+	// Delete the atlas and buffers
+	void clearText() {
+		if (VAO != 0) {
+			GLState::deleteTexture(atlasTexture);
+			GLState::deleteVertexArray(VAO);
+			glDeleteBuffers(1, &quadVBO);
+			glDeleteBuffers(1, &instanceVBO);
+			atlasTexture = VAO = quadVBO = instanceVBO = 0;
+		}
+		instances.clear();
+	};
+
+
+private:
+	Glyph glyphs[TEXT_LAST_CHAR - TEXT_FIRST_CHAR + 1];		// Glyph metrics and atlas rectangles
+	std::vector<unsigned char> atlas;		// Atlas texels until upload
+	int atlasHeight;						// Atlas height (pixels)
+	float lineHeight;						// Distance between lines (pixels)
+	unsigned int atlasTexture;				// Atlas texture
+	unsigned int VAO, quadVBO, instanceVBO;	// Vertex array, unit quad and glyph instance buffers
+	unsigned int instanceCapacity;			// Glyphs the instance buffer has room for
+	std::vector<GlyphInstance> instances;	// This frame's glyphs (capacity reserved up front)
+	int screenWidth, screenHeight;			// Drawable size (pixels)
+	long dropped;							// Glyphs over the limit
+	bool loaded;							// Was a font loaded? (text is dropped if not)
+};
+
+#endif
@@ -0,0 +1,198 @@
+#pragma once
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <SDL.h>
+#include <GL/glew.h>  // Holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+#include "DynamicResolution.h"
+
+#include <memory>
+#include <stdio.h>
+
+
+// View
+// A window with its own camera, state and model pass target. Every view is drawn with the application's one
+// OpenGL context, made current on each window in turn, so models, textures, shader programs, vertex arrays and
+// sensor buffers exist once and are uploaded once per frame however many windows show them. (Vertex arrays and
+// framebuffers aren't shared between contexts, so one context is simpler and cheaper than a shared group.)
+// Views can be moved (kept in a vector) but not copied, since each owns its model pass target.
+class View {
+public:
+	// Constructor. state = state shown first. display_p = monitor to cover, borderless (-1 = an ordinary window)
+	View(int state = 0, int display_p = -1) : camera(glm::vec3(0.0f, 0.0f, 50.0f)) {
+		window = NULL;
+		currState = state;
+		shownState = state;
+		display = display_p;
+		viewMatrix = glm::mat4(1.0f);
+		projection = glm::mat4(1.0f);
+		width = height = 0;
+		drawableWidth = drawableHeight = 0;
+		shown = false;
+	};
+
+
+	// Open the window (after SDL_Init, before or after the context is created)
+	// Views without a monitor get a resizable width_p x height_p window on the default one
+	bool open(const char* title, int width_p, int height_p) {
+		int x = SDL_WINDOWPOS_UNDEFINED;
+		int y = SDL_WINDOWPOS_UNDEFINED;
+		Uint32 flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI;
+
+		// Cover the monitor with a borderless window (full screen windows minimize when another window takes focus)
+		SDL_Rect bounds;
+		if (display >= 0 && display < SDL_GetNumVideoDisplays() && SDL_GetDisplayBounds(display, &bounds) == 0) {
+			x = bounds.x;
+			y = bounds.y;
+			width_p = bounds.w;
+			height_p = bounds.h;
+			flags |= SDL_WINDOW_BORDERLESS;
+		} else {
+			if (display >= 0) {
+				printf("View: display %d not found (%d connected), opening a window on the default one\n", display, SDL_GetNumVideoDisplays());
+			}
+			flags |= SDL_WINDOW_RESIZABLE;
+		}
+
+		window = SDL_CreateWindow(title, x, y, width_p, height_p, flags);
+		if (window == NULL) {
+			printf("Window failed to init. Error: %s\n", SDL_GetError());
+			return false;
+		}
+		SDL_GetWindowSize(window, &width, &height);
+		SDL_GL_GetDrawableSize(window, &drawableWidth, &drawableHeight);
+		shown = true;
+		return true;
+	};
+
+
+	// Create the model pass target (context created)
+	void createTarget(float target_ms, float min_scale) {
+		sceneTarget.reset(new DynamicResolution(target_ms, min_scale));
+		sceneTarget->resize(drawableWidth, drawableHeight);
+	};
+
+
+	// Window resized. Resize the model pass target (the GUI is in normalized coordinates)
+	void resize() {
+		SDL_GetWindowSize(window, &width, &height);
+		SDL_GL_GetDrawableSize(window, &drawableWidth, &drawableHeight);
+		sceneTarget->resize(drawableWidth, drawableHeight);
+	};
+
+
+	// Draw into this window from here on. swap_interval = vsync for its swaps (only set when it differs from the last view's)
+	void begin(SDL_GLContext context, int swap_interval) {
+		SDL_GL_MakeCurrent(window, context);
+		glViewport(0, 0, drawableWidth, drawableHeight);
+		int& current = contextSwapInterval();
+		if (swap_interval != current) {
+			SDL_GL_SetSwapInterval(swap_interval);
+			current = swap_interval;
+		}
+	};
+
+
+	// Update the view and projection matrices from the camera
+	void updateMatrices() {
+		viewMatrix = camera.GetViewMatrix();
+		projection = glm::perspective(glm::radians(camera.Fov), (float)width / (float)height, NEAR_PLANE, FAR_PLANE);
+	};
+
+
+	// Show the finished frame
+	void swap() {
+		SDL_GL_SwapWindow(window);
+	};
+
+
+	// Is an event for this window?
+	bool owns(const SDL_Event& event) {
+		Uint32 id = eventWindow(event);
+		return id != 0 && id == SDL_GetWindowID(window);
+	};
+
+
+	// Stop drawing this window (closed by the user)
+	void hide() {
+		SDL_HideWindow(window);
+		shown = false;
+	};
+
+
+	// Is the window drawn?
+	bool isShown() {
+		return shown;
+	};
+
+
+	// Delete the model pass target (before the context goes)
+	void clearTarget() {
+		if (sceneTarget) {
+			sceneTarget->clearTarget();
+			sceneTarget.reset();
+		}
+	};
+
+
+	// Destroy the window
+	void closeWindow() {
+		if (window != NULL) {
+			SDL_DestroyWindow(window);
+			window = NULL;
+		}
+		shown = false;
+	};
+
+
+	SDL_Window* window;					// Window
+	Camera camera;						// Camera (moved by the keyboard while this window has focus)
+	glm::mat4 viewMatrix;				// View matrix of the last frame (for picking)
+	glm::mat4 projection;				// Projection matrix of the last frame
+	std::unique_ptr<DynamicResolution> sceneTarget;	// Model pass target (resolution follows its GPU time)
+	int currState;						// Current state. -1 = quit
+	int shownState;						// State whose linked pages were last prefetched
+	int display;						// Monitor covered (-1 = ordinary window)
+	int width, height;					// Window size
+	int drawableWidth, drawableHeight;	// Framebuffer size (larger than the window on high DPI displays)
+
+
+private:
+	bool shown;							// Is the window drawn?
+
+
+	// Swap interval last set on the context (shared by every view, -2 = not set through a view yet)
+	static int& contextSwapInterval() {
+		static int interval = -2;
+		return interval;
+	};
+
+	// Window an event is for (0 = none)
+	static Uint32 eventWindow(const SDL_Event& event) {
+		switch (event.type) {
+		case SDL_WINDOWEVENT:
+			return event.window.windowID;
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			return event.key.windowID;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			return event.button.windowID;
+		case SDL_MOUSEMOTION:
+			return event.motion.windowID;
+		case SDL_MOUSEWHEEL:
+			return event.wheel.windowID;
+		case SDL_TEXTINPUT:
+			return event.text.windowID;
+		default:
+			return 0;
+		}
+	};
+};
+
+#endif
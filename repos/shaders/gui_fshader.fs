@@ -2,10 +2,22 @@
 out vec4 FragColor;
 
 in vec2 TexCoord;
+in vec4 Color;
 
 uniform sampler2D texture0;
+uniform int guiMode;	// 1 = texture0 is the text atlas (coverage in red), 2 = chart traces
 
 void main() {
+	// Text: color with the glyph's coverage as alpha
+	if (guiMode == 1) {
+		FragColor = vec4(Color.rgb, Color.a * texture(texture0, TexCoord).r);
+		return;
+	}
+	// Chart: trace color
+	if (guiMode == 2) {
+		FragColor = Color;
+		return;
+	}
 	// Set fragment color to texture color and diffuse color
 	FragColor = texture(texture0, TexCoord);
-}
\ No newline at end of file
+}
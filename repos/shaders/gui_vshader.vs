@@ -1,11 +1,52 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;  // The position variable has attribute position 0
+layout (location = 1) in vec4 aGlyphRect;	// Text only: glyph quad (x, y = bottom left, width, height)
+layout (location = 2) in vec4 aGlyphUV;		// Text only: glyph in the atlas (u0, v0 = top left, u1, v1 = bottom right)
+layout (location = 3) in vec4 aGlyphColor;	// Text only: color
 
 out vec2 TexCoord;		// Texture coords
+out vec4 Color;			// Text and chart color
 
 uniform mat4 transformation;
+uniform int guiMode;	// 0 = textured quad, 1 = instanced glyphs from the text atlas, 2 = chart traces
+
+// Chart only. Vertex = row, instance = trace. Rows are a ring of [row][trace] values
+uniform samplerBuffer chartValues;	// Ring of values
+uniform vec4 chartRect;		// x, y = bottom left, width, height (normalized coordinates)
+uniform vec2 chartRange;	// Values at the bottom and top of a trace
+uniform int chartCapacity;	// Rows in the ring
+uniform int chartHead;		// Ring slot the next row goes in
+uniform int chartCount;		// Rows held
+uniform int chartTraces;	// Values per row
+uniform int chartLanes;		// 1 = each trace in its own lane, 0 = traces overlaid
 
 void main() {
+	if (guiMode == 1) {
+		vec2 corner = (aPos + 1) / 2;
+		gl_Position = vec4(aGlyphRect.xy + corner * aGlyphRect.zw, 0.0, 1.0);
+		TexCoord = vec2(mix(aGlyphUV.x, aGlyphUV.z, corner.x), mix(aGlyphUV.w, aGlyphUV.y, corner.y));
+		Color = aGlyphColor;
+		return;
+	}
+	if (guiMode == 2) {
+		// Row in the ring (oldest first), newest at the right edge so the traces scroll left
+		int slot = (chartHead - chartCount + gl_VertexID + chartCapacity) % chartCapacity;
+		float value = texelFetch(chartValues, slot * chartTraces + gl_InstanceID).r;
+		float x = chartRect.x + chartRect.z * float(gl_VertexID + chartCapacity - chartCount) / float(chartCapacity - 1);
+
+		// Scale the value into the trace's lane (first trace on top)
+		float lane_height = chartLanes == 1 ? chartRect.w / float(chartTraces) : chartRect.w;
+		float lane_bottom = chartLanes == 1 ? chartRect.y + lane_height * float(chartTraces - 1 - gl_InstanceID) : chartRect.y;
+		float y = lane_bottom + lane_height * clamp((value - chartRange.x) / (chartRange.y - chartRange.x), 0.0, 1.0);
+		gl_Position = vec4(x, y, 0.0, 1.0);
+
+		// Color per trace around the hue circle
+		float hue = float(gl_InstanceID) / float(chartTraces);
+		Color = vec4(clamp(abs(mod(hue * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0), 1.0);
+		TexCoord = vec2(0.0);
+		return;
+	}
 	gl_Position = transformation * vec4(aPos, 0.0, 1.0);
 	TexCoord = vec2((aPos.x + 1)/2, (aPos.y + 1)/2);
-}
\ No newline at end of file
+	Color = vec4(1.0);
+}
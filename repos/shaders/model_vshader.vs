@@ -3,16 +3,78 @@ layout (location = 0) in vec3 aPos;  // The position variable has attribute posi
 layout (location = 1) in vec3 aNormal;  // The normal has attribute position 1
 layout (location = 2) in vec2 aTexCoord;	// Texture coords has attribute position 2
 layout (location = 3) in vec3 aDiffColor;  // Diffuse color has attribute position 3
+layout (location = 4) in ivec2 aSensorIndex;  // Indices of the two nearest sensors (-1 = none) has attribute position 4
+layout (location = 5) in vec2 aSensorWeight;  // Blending of the two nearest sensors has attribute position 5
+layout (location = 6) in mat4 aModel;  // Per-instance model matrix has attribute positions 6 to 9
+layout (location = 10) in int aSensorOffset;  // Per-instance first sensor in the sensor buffers has attribute position 10
 
 out vec2 TexCoord;	// Output texture coordinates to the fragment shader
 out vec3 DiffColor; // Output diffuse color to the fragment shader
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Sensor data
+uniform samplerBuffer sensorValues;		// Latest value per sensor (R32F)
+uniform int showHeatmap;				// Color by sensor value? 0 = no (material color). 1 = yes
+uniform float minValue;					// Sensor value shown as blue
+uniform float maxValue;					// Sensor value shown as red
+
+// Mode shape animation
+uniform samplerBuffer modeShapes;		// Per-sensor amplitude (r) and phase (g) of the animated mode (RG32F)
+uniform int animateMode;				// Animate the mode shape? 0 = no. 1 = yes
+uniform float modePhase;				// Current animation phase (radians)
+uniform float modeScale;				// Displacement at unit amplitude
+uniform vec3 modeAxis;					// Displacement direction
+
+// Value of one sensor (index within the instance's sensor set)
+float sensorValue(int index) {
+	if (index < 0) {
+		return 0.0;
+	}
+	return texelFetch(sensorValues, aSensorOffset + index).r;
+}
+
+// Modal displacement of one sensor at the current phase
+float sensorDispl(int index) {
+	if (index < 0) {
+		return 0.0;
+	}
+	vec2 shape = texelFetch(modeShapes, aSensorOffset + index).rg;
+	return shape.x * cos(modePhase + shape.y);
+}
+
+// Heatmap color (max = red (0). min = blue (240/360)), HSV with S = V = 1
+vec3 heatColor(float value) {
+	float hue = clamp(1.0 - (value - minValue) / (maxValue - minValue), 0.0, 1.0) * 240.0;
+	float X = 1.0 - abs(mod(hue / 60.0, 2.0) - 1.0);
+	if (hue < 60.0) {
+		return vec3(1.0, X, 0.0);
+	} else if (hue < 120.0) {
+		return vec3(X, 1.0, 0.0);
+	} else if (hue < 180.0) {
+		return vec3(0.0, 1.0, X);
+	}
+	return vec3(0.0, X, 1.0);
+}
+
 void main() {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	vec3 pos = aPos;
+
+	// Blend the two nearest sensors' modal displacement
+	if (animateMode == 1) {
+		float displ = aSensorWeight.x * sensorDispl(aSensorIndex.x) + aSensorWeight.y * sensorDispl(aSensorIndex.y);
+		pos += modeAxis * (displ * modeScale);
+	}
+
+	gl_Position = projection * view * aModel * vec4(pos, 1.0);
 	TexCoord = aTexCoord; // Set TexCoord to the input tex coord from vertex data
-	DiffColor = aDiffColor;  // Set DiffColor to the input diffuse color from vertex data
-}
\ No newline at end of file
+
+	// Blend the two nearest sensors' values for the heatmap
+	if (showHeatmap == 1) {
+		float value = aSensorWeight.x * sensorValue(aSensorIndex.x) + aSensorWeight.y * sensorValue(aSensorIndex.y);
+		DiffColor = heatColor(value);
+	} else {
+		DiffColor = aDiffColor;  // Set DiffColor to the input diffuse color from vertex data
+	}
+}
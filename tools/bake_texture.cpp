@@ -0,0 +1,334 @@
+// Texture Baker
+// Offline tool that turns images (PNG, JPG, ...) into KTX files holding every mip level, optionally
+// BC1 / BC3 (S3TC) compressed. The app loads "<image>.ktx" instead of "<image>.png" when it exists,
+// so pages are uploaded straight from the file without decoding or generating mipmaps.
+//
+// Usage: bake_texture [-bc] image1.png [image2.png ...]
+//   -bc   compress (BC1 for RGB images, BC3 for images with alpha)
+// Each image is written next to itself with the .ktx extension.
+//
+// Build (from the repo root): g++ -O2 -I<stb include dir> tools/bake_texture.cpp -o bake_texture
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "../include/KTXFormat.h"
+
+
+// One mip level (tightly packed rows, bottom row first like OpenGL)
+struct Level {
+	int width, height;					// Size
+	std::vector<unsigned char> pixels;	// width * height * channels bytes
+};
+
+
+// Half size level with a 2x2 box filter (edges are clamped for odd sizes)
+Level downsample(const Level& src, int channels) {
+	Level dst;
+	dst.width = std::max(1, src.width / 2);
+	dst.height = std::max(1, src.height / 2);
+	dst.pixels.resize(dst.width * dst.height * channels);
+	for (int y = 0; y < dst.height; y++) {
+		int y0 = std::min(y * 2, src.height - 1);
+		int y1 = std::min(y * 2 + 1, src.height - 1);
+		for (int x = 0; x < dst.width; x++) {
+			int x0 = std::min(x * 2, src.width - 1);
+			int x1 = std::min(x * 2 + 1, src.width - 1);
+			for (int c = 0; c < channels; c++) {
+				int sum = src.pixels[(y0 * src.width + x0) * channels + c] + src.pixels[(y0 * src.width + x1) * channels + c]
+					+ src.pixels[(y1 * src.width + x0) * channels + c] + src.pixels[(y1 * src.width + x1) * channels + c];
+				dst.pixels[(y * dst.width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+
+// 8-bit RGB to 565
+uint16_t packRGB565(const int* rgb) {
+	return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+}
+
+// 565 back to 8-bit RGB (what the GPU decodes)
+void unpackRGB565(uint16_t c, int* rgb) {
+	rgb[0] = ((c >> 11) & 31) * 255 / 31;
+	rgb[1] = ((c >> 5) & 63) * 255 / 63;
+	rgb[2] = (c & 31) * 255 / 31;
+}
+
+
+// BC1 color block from 16 RGBA pixels. Endpoints are the (slightly inset) bounding box of the block's colors
+void encodeColorBlock(const unsigned char block[16][4], unsigned char* out) {
+	int lo[3] = { 255, 255, 255 };
+	int hi[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			lo[c] = std::min(lo[c], (int)block[i][c]);
+			hi[c] = std::max(hi[c], (int)block[i][c]);
+		}
+	}
+	// Inset by 1/16 of the range so the endpoints aren't wasted on outliers
+	for (int c = 0; c < 3; c++) {
+		int inset = (hi[c] - lo[c]) / 16;
+		lo[c] += inset;
+		hi[c] -= inset;
+	}
+
+	uint16_t color0 = packRGB565(hi);
+	uint16_t color1 = packRGB565(lo);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t bits = 0;
+	if (color0 != color1) {
+		// Palette (4 color mode since color0 > color1)
+		int palette[4][3];
+		unpackRGB565(color0, palette[0]);
+		unpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		// Nearest palette entry per pixel
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int best_dist = 1 << 30;
+			for (int p = 0; p < 4; p++) {
+				int dr = block[i][0] - palette[p][0];
+				int dg = block[i][1] - palette[p][1];
+				int db = block[i][2] - palette[p][2];
+				int dist = dr * dr + dg * dg + db * db;
+				if (dist < best_dist) {
+					best_dist = dist;
+					best = p;
+				}
+			}
+			bits |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	out[0] = color0 & 0xFF;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF;
+	out[3] = color1 >> 8;
+	for (int i = 0; i < 4; i++) {
+		out[4 + i] = (bits >> (i * 8)) & 0xFF;
+	}
+}
+
+
+// BC3 alpha block from 16 RGBA pixels (8 alpha mode with the block's min and max)
+void encodeAlphaBlock(const unsigned char block[16][4], unsigned char* out) {
+	int lo = 255;
+	int hi = 0;
+	for (int i = 0; i < 16; i++) {
+		lo = std::min(lo, (int)block[i][3]);
+		hi = std::max(hi, (int)block[i][3]);
+	}
+
+	uint64_t bits = 0;
+	if (hi != lo) {
+		int palette[8];
+		palette[0] = hi;
+		palette[1] = lo;
+		for (int p = 1; p < 7; p++) {
+			palette[p + 1] = ((7 - p) * hi + p * lo) / 7;
+		}
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int best_dist = 1 << 30;
+			for (int p = 0; p < 8; p++) {
+				int dist = abs(block[i][3] - palette[p]);
+				if (dist < best_dist) {
+					best_dist = dist;
+					best = p;
+				}
+			}
+			bits |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	out[0] = (unsigned char)hi;
+	out[1] = (unsigned char)lo;
+	for (int i = 0; i < 6; i++) {
+		out[2 + i] = (bits >> (i * 8)) & 0xFF;
+	}
+}
+
+
+// Compress a level to BC1 (8 bytes per 4x4 block) or BC3 (16 bytes per block)
+std::vector<unsigned char> compressLevel(const Level& level, int channels, bool alpha) {
+	int blocks_x = (level.width + 3) / 4;
+	int blocks_y = (level.height + 3) / 4;
+	int block_bytes = alpha ? 16 : 8;
+	std::vector<unsigned char> out(blocks_x * blocks_y * block_bytes);
+
+	unsigned char block[16][4];
+	for (int by = 0; by < blocks_y; by++) {
+		for (int bx = 0; bx < blocks_x; bx++) {
+			// Gather the block (clamped at the edges)
+			for (int i = 0; i < 16; i++) {
+				int x = std::min(bx * 4 + i % 4, level.width - 1);
+				int y = std::min(by * 4 + i / 4, level.height - 1);
+				const unsigned char* p = &level.pixels[(y * level.width + x) * channels];
+				block[i][0] = p[0];
+				block[i][1] = p[1];
+				block[i][2] = p[2];
+				block[i][3] = (channels == 4) ? p[3] : 255;
+			}
+
+			unsigned char* dst = &out[(by * blocks_x + bx) * block_bytes];
+			if (alpha) {
+				encodeAlphaBlock(block, dst);
+				encodeColorBlock(block, dst + 8);
+			} else {
+				encodeColorBlock(block, dst);
+			}
+		}
+	}
+	return out;
+}
+
+
+// Uncompressed level with rows padded to 4 bytes (KTX / GL_UNPACK_ALIGNMENT 4)
+std::vector<unsigned char> padLevel(const Level& level, int channels) {
+	int row = level.width * channels;
+	int padded_row = (row + 3) & ~3;
+	std::vector<unsigned char> out(padded_row * level.height, 0);
+	for (int y = 0; y < level.height; y++) {
+		memcpy(&out[y * padded_row], &level.pixels[y * row], row);
+	}
+	return out;
+}
+
+
+// Bake one image. Returns false on failure
+bool bake(const std::string& path, bool compress) {
+	// Load (bottom row first, like the app's stbi_set_flip_vertically_on_load(true))
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	if (!data) {
+		printf("Failed to load %s: %s\n", path.c_str(), stbi_failure_reason());
+		return false;
+	}
+
+	// Expand grey images to RGB / RGBA
+	int out_channels = (channels == 2 || channels == 4) ? 4 : 3;
+	Level level;
+	level.width = width;
+	level.height = height;
+	level.pixels.resize(width * height * out_channels);
+	for (int i = 0; i < width * height; i++) {
+		const unsigned char* src = &data[i * channels];
+		unsigned char* dst = &level.pixels[i * out_channels];
+		if (channels <= 2) {
+			dst[0] = dst[1] = dst[2] = src[0];
+		} else {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+		if (out_channels == 4) {
+			dst[3] = src[channels - 1];
+		}
+	}
+	stbi_image_free(data);
+	bool alpha = (out_channels == 4);
+
+	// Header
+	KTXHeader header;
+	memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+	header.endianness = KTX_ENDIANNESS;
+	if (compress) {
+		header.glType = 0;
+		header.glTypeSize = 1;
+		header.glFormat = 0;
+		header.glInternalFormat = alpha ? KTX_GL_COMPRESSED_RGBA_S3TC_DXT5 : KTX_GL_COMPRESSED_RGB_S3TC_DXT1;
+	} else {
+		header.glType = KTX_GL_UNSIGNED_BYTE;
+		header.glTypeSize = 1;
+		header.glFormat = alpha ? KTX_GL_RGBA : KTX_GL_RGB;
+		header.glInternalFormat = alpha ? KTX_GL_RGBA8 : KTX_GL_RGB8;
+	}
+	header.glBaseInternalFormat = alpha ? KTX_GL_RGBA : KTX_GL_RGB;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.pixelDepth = 0;
+	header.numberOfArrayElements = 0;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2) {
+		header.numberOfMipmapLevels++;
+	}
+
+	// Orientation key (rows are stored bottom up)
+	const char key_value[] = "KTXorientation\0S=r,T=u";
+	uint32_t key_value_size = sizeof(key_value);
+	uint32_t key_value_padded = (key_value_size + 3) & ~3u;
+	header.bytesOfKeyValueData = sizeof(uint32_t) + key_value_padded;
+
+	std::string out_path = ktxPath(path);
+	FILE* file = fopen(out_path.c_str(), "wb");
+	if (!file) {
+		printf("Failed to open %s for writing\n", out_path.c_str());
+		return false;
+	}
+	const unsigned char zeros[4] = { 0, 0, 0, 0 };
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&key_value_size, sizeof(uint32_t), 1, file);
+	fwrite(key_value, 1, key_value_size, file);
+	fwrite(zeros, 1, key_value_padded - key_value_size, file);
+
+	// Levels
+	size_t total = 0;
+	for (uint32_t l = 0; l < header.numberOfMipmapLevels; l++) {
+		if (l > 0) {
+			level = downsample(level, out_channels);
+		}
+		std::vector<unsigned char> bytes = compress ? compressLevel(level, out_channels, alpha) : padLevel(level, out_channels);
+		uint32_t image_size = (uint32_t)bytes.size();
+		fwrite(&image_size, sizeof(uint32_t), 1, file);
+		fwrite(&bytes[0], 1, bytes.size(), file);
+		fwrite(zeros, 1, ((image_size + 3) & ~3u) - image_size, file);
+		total += bytes.size();
+	}
+	fclose(file);
+
+	printf("%s -> %s: %dx%d, %u levels, %s, %.1f MB (uncompressed RGBA with mips: %.1f MB)\n", path.c_str(), out_path.c_str(),
+		width, height, header.numberOfMipmapLevels, compress ? (alpha ? "BC3" : "BC1") : (alpha ? "RGBA8" : "RGB8"),
+		total / (1024.0 * 1024.0), width * height * 4 * 4 / 3 / (1024.0 * 1024.0));
+	return true;
+}
+
+
+// Main
+int main(int argc, char* args[]) {
+	bool compress = false;
+	int baked = 0;
+	int failed = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(args[i], "-bc") == 0) {
+			compress = true;
+		} else if (bake(args[i], compress)) {
+			baked++;
+		} else {
+			failed++;
+		}
+	}
+	if (baked + failed == 0) {
+		printf("Usage: bake_texture [-bc] image1.png [image2.png ...]\n");
+		return 1;
+	}
+	return failed > 0 ? 1 : 0;
+}
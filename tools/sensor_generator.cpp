@@ -0,0 +1,273 @@
+// Sensor Generator
+// Sends synthetic sensor packets (see include/SensorPacket.h) over UDP, like the bridge's data acquisition
+// nodes, for feeding the app (run it with -udp <port>) or load testing the receiver. Channels are split
+// into groups, each sent by its own source with its own sequence numbers. Loss, reordering, duplicates
+// and per-source clock skew can be simulated.
+//
+// Usage: sensor_generator [options]
+//   -host <ip>         destination (default 127.0.0.1)
+//   -port <port>       destination port (default 5005)
+//   -channels <n>      channels (default 25, the app's sensor count)
+//   -rate <hz>         samples per second per channel (default 50, the app's SENSOR_RATE)
+//   -group <n>         channels per source (default 5)
+//   -samples <n>       rows per packet (default 1)
+//   -loss <p>          fraction of packets dropped (default 0)
+//   -reorder <p>       fraction of packets swapped with the next one (default 0)
+//   -duplicate <p>     fraction of packets sent twice (default 0)
+//   -skew <us>         largest per-source clock offset (default 0)
+//   -seconds <s>       stop after this long (default 0 = run until killed)
+//   -loopback          also receive on -port in this process and print the receiver's counters every second
+//
+// Load test: sensor_generator -loopback -rate 20000 -group 5 -samples 1 -seconds 10 (100k packets per second)
+//
+// Build (from the repo root): g++ -O2 -pthread tools/sensor_generator.cpp -o sensor_generator
+// (Windows: link ws2_32.lib)
+
+#include "../include/SensorPacket.h"
+#include "../include/SensorReceiver.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+
+// Packet ready to send
+struct Packet {
+	std::vector<unsigned char> bytes;	// Header and values
+	int size;							// Bytes used
+};
+
+
+// Random number in [0, 1)
+float random01() {
+	return rand() / ((float)RAND_MAX + 1.0f);
+}
+
+
+// Synthetic bridge response of a channel at time t (two bending modes plus noise, like the app's built-in sensors)
+float sampleValue(int channel, int channels, double t) {
+	const double PI = 3.14159265358979;
+	double s = channels > 1 ? channel / (double)(channels - 1) : 0.5;	// Position along the span (0 to 1)
+	return (float)(0.6 * sin(2.0 * PI * 1.9 * t) * sin(PI * s) + 0.3 * sin(2.0 * PI * 4.7 * t) * sin(2.0 * PI * s) + 0.2 * (random01() - 0.5));
+}
+
+
+// Fill a packet: rows [first_sample, first_sample + samples) of channels [first_channel, first_channel + count)
+void buildPacket(Packet& packet, uint16_t source, uint32_t sequence, uint64_t timestamp, int first_channel, int count, int channels,
+	long first_sample, int samples, double rate) {
+	SensorPacketHeader header;
+	header.magic = SENSOR_PACKET_MAGIC;
+	header.sequence = sequence;
+	header.timestamp = timestamp;
+	header.source = source;
+	header.firstChannel = (uint16_t)first_channel;
+	header.numChannels = (uint16_t)count;
+	header.numSamples = (uint16_t)samples;
+	memcpy(&packet.bytes[0], &header, sizeof(header));
+
+	float* values = (float*)&packet.bytes[sizeof(header)];
+	for (int row = 0; row < samples; row++) {
+		double t = (first_sample + row) / rate;
+		for (int c = 0; c < count; c++) {
+			values[row * count + c] = sampleValue(first_channel + c, channels, t);
+		}
+	}
+	packet.size = (int)(sizeof(header) + (size_t)samples * count * sizeof(float));
+}
+
+
+int main(int argc, char* argv[]) {
+	const char* host = "127.0.0.1";
+	int port = 5005;
+	int channels = 25;
+	double rate = 50.0;
+	int group = 5;
+	int samples = 1;
+	float loss = 0.0f, reorder = 0.0f, duplicate = 0.0f;
+	int skew = 0;
+	double seconds = 0.0;
+	bool loopback = false;
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "-host") == 0 && has_value) {
+			host = argv[++i];
+		} else if (strcmp(argv[i], "-port") == 0 && has_value) {
+			port = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-channels") == 0 && has_value) {
+			channels = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-rate") == 0 && has_value) {
+			rate = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-group") == 0 && has_value) {
+			group = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-samples") == 0 && has_value) {
+			samples = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-loss") == 0 && has_value) {
+			loss = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "-reorder") == 0 && has_value) {
+			reorder = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "-duplicate") == 0 && has_value) {
+			duplicate = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "-skew") == 0 && has_value) {
+			skew = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-seconds") == 0 && has_value) {
+			seconds = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-loopback") == 0) {
+			loopback = true;
+		} else {
+			printf("Unknown option %s (see the top of tools/sensor_generator.cpp)\n", argv[i]);
+			return 1;
+		}
+	}
+	if (channels <= 0 || rate <= 0.0 || group <= 0 || samples <= 0
+		|| sizeof(SensorPacketHeader) + (size_t)samples * std::min(group, channels) * sizeof(float) > (size_t)SENSOR_PACKET_MAX_BYTES) {
+		printf("Bad settings (a packet must fit in %d bytes)\n", SENSOR_PACKET_MAX_BYTES);
+		return 1;
+	}
+
+	// Receiver in this process (starts Winsock too)
+	SensorReceiver receiver(channels, (float)rate, 4);
+	std::atomic<bool> consuming(false);
+	std::atomic<long> consumed(0);
+	std::thread consumer;
+	if (loopback) {
+		if (!receiver.start(port)) {
+			return 1;
+		}
+		consuming = true;
+		consumer = std::thread([&]() {
+			std::vector<float> frame(channels);
+			while (consuming) {
+				if (receiver.pop(frame)) {
+					consumed++;
+				} else {
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+				}
+			}
+		});
+	}
+#ifdef _WIN32
+	else {
+		WSADATA wsa;
+		WSAStartup(MAKEWORD(2, 2), &wsa);
+	}
+#endif
+
+	// Sending socket
+	ReceiverSocket sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sockaddr_in destination;
+	memset(&destination, 0, sizeof(destination));
+	destination.sin_family = AF_INET;
+	destination.sin_port = htons((unsigned short)port);
+	if (sock == RECV_NO_SOCKET || inet_pton(AF_INET, host, &destination.sin_addr) != 1) {
+		printf("Can't send to %s\n", host);
+		return 1;
+	}
+
+	// Sources (one per group of channels), each with a clock offset
+	int num_sources = (channels + group - 1) / group;
+	std::vector<uint32_t> sequences(num_sources, 0);
+	std::vector<int64_t> offsets(num_sources, 0);
+	for (int s = 0; s < num_sources; s++) {
+		offsets[s] = skew > 0 ? (int64_t)((random01() * 2.0f - 1.0f) * skew) : 0;
+	}
+	printf("Sending %d channels at %.0f Hz to %s:%d: %d sources, %d rows per packet, %.0f packets/s\n",
+		channels, rate, host, port, num_sources, samples, num_sources * rate / samples);
+
+	// Packet being built, and per source a packet held back to go out after that source's next one
+	Packet packet;
+	packet.bytes.resize(SENSOR_PACKET_MAX_BYTES);
+	std::vector<Packet> held(num_sources);
+	std::vector<bool> holding(num_sources, false);
+	for (int s = 0; s < num_sources; s++) {
+		held[s].bytes.resize(SENSOR_PACKET_MAX_BYTES);
+	}
+	long sent = 0, last_sent = 0;
+	long next_sample = 0;
+	uint64_t clock_start = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point last_report = start;
+
+	while (true) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double>(now - start).count();
+		if (seconds > 0.0 && elapsed >= seconds) {
+			break;
+		}
+
+		// Send every packet that's due
+		long due = (long)(elapsed * rate);
+		while (next_sample + samples <= due) {
+			for (int s = 0; s < num_sources; s++) {
+				uint64_t timestamp = clock_start + (uint64_t)(next_sample * 1000000.0 / rate) + offsets[s];
+				int first = s * group;
+				buildPacket(packet, (uint16_t)s, sequences[s]++, timestamp, first, std::min(group, channels - first), channels, next_sample, samples, rate);
+				if (random01() < loss) {
+					continue;
+				}
+				if (!holding[s] && random01() < reorder) {
+					std::swap(packet, held[s]);  // Goes out after this source's next packet
+					holding[s] = true;
+					continue;
+				}
+				int copies = random01() < duplicate ? 2 : 1;
+				for (int c = 0; c < copies; c++) {
+					sendto(sock, (const char*)&packet.bytes[0], packet.size, 0, (sockaddr*)&destination, sizeof(destination));
+					sent++;
+				}
+				if (holding[s]) {
+					sendto(sock, (const char*)&held[s].bytes[0], held[s].size, 0, (sockaddr*)&destination, sizeof(destination));
+					sent++;
+					holding[s] = false;
+				}
+			}
+			next_sample += samples;
+		}
+
+		// Counters once a second
+		double since_report = std::chrono::duration<double>(now - last_report).count();
+		if (since_report >= 1.0) {
+			printf("%.0f packets/s sent", (sent - last_sent) / since_report);
+			if (loopback) {
+				printf(", %ld frames read. ", (long)consumed);
+				receiver.printStats();
+			} else {
+				printf("\n");
+			}
+			last_sent = sent;
+			last_report = now;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+#ifdef _WIN32
+	closesocket(sock);
+#else
+	close(sock);
+#endif
+
+	// Let the receiver finish what's queued
+	if (loopback) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		consuming = false;
+		consumer.join();
+		receiver.stop();
+		printf("Done: %ld packets sent, %ld frames read. ", sent, (long)consumed);
+		receiver.printStats();
+	}
+#ifdef _WIN32
+	else {
+		WSACleanup();
+	}
+#endif
+	return 0;
+}